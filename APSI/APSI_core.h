@@ -16,30 +16,116 @@ typedef struct _APSIParams {
     uint32_t ps_low_degree;
 } APSIParams;
 
+// Presets in the JSON format of Microsoft APSI (APSI/params/*.json).
+// The OpenFHE context keeps p = 65537; the SEAL moduli are kept for reference.
+#ifndef APSI_PARAM_DIR
+#define APSI_PARAM_DIR "APSI/params"
+#endif
+
+typedef struct _APSIPreset {
+    std::string name;
+    uint64_t maxItems;          // sender set size from the file name; 0 if unknown
+    APSIParams params;          // query_powers, felts_per_item, max_items_per_bin, ps_low_degree
+    uint32_t hashFuncCount;
+    uint32_t tableSize;
+    uint32_t polyModulusDegree;
+    uint32_t plainModulusBits;
+    std::vector<uint32_t> coeffModulusBits;
+} APSIPreset;
+
+APSIPreset loadAPSIPreset(const std::string &path);
+
+// Every *.json in dir, by increasing maxItems
+std::vector<APSIPreset> loadAPSIPresets(const std::string &dir = APSI_PARAM_DIR);
+
+// Smallest preset whose set size covers numItems; the largest otherwise
+APSIPreset selectAPSIPreset(uint64_t numItems, const std::string &dir = APSI_PARAM_DIR);
+
+// Depth of the powers DAG, +1 for Paterson-Stockmeyer, +1 for an encrypted DB,
+// and log2(numParties) for the aggregation
+uint32_t computeAPSIDepth(
+    const APSIPreset &preset,
+    bool isEncrypted,
+    uint32_t numParties
+);
+
+// Source-power search. PowersDag only checks a given set of query powers;
+// these pick one: the fewest sources (uploaded ciphertexts) from which every
+// target is reached within maxDepth products. Targets of at most
+// SOURCE_EXHAUSTIVE_TARGETS powers are searched exhaustively, larger ones
+// greedily and then pruned.
+#define SOURCE_EXHAUSTIVE_TARGETS 24
+#define SOURCE_DEPTH_UNREACHABLE 0xFFFFFFFF
+
+// Depth of the powers DAG; SOURCE_DEPTH_UNREACHABLE if a target cannot be reached
+uint32_t computeSourceDepth(
+    const std::set<uint32_t> &sources,
+    const std::set<uint32_t> &targets
+);
+
+// targets must contain 1; maxDepth = 0 returns targets
+std::set<uint32_t> optimizeSourcePowers(
+    const std::set<uint32_t> &targets,
+    uint32_t maxDepth
+);
+
+// Writes the preset in the layout of APSI/params/*.json
+void saveAPSIPreset(const APSIPreset &preset, const std::string &path);
+
 int64_t modPow(int64_t a, int64_t n, int64_t p);
 
+// Powers of the query the sender needs: 1..maxBin for the linear evaluation;
+// 1..L and the multiples of L+1 up to maxBin for Paterson-Stockmeyer
+std::set<uint32_t> computeTargetPowers(
+    const APSIParams &params,
+    bool usePS
+);
+
 void compute_all_powers(
     HE &bfv,
     const PowersDag &dag,
     std::vector<Ciphertext<DCRTPoly>> &powers
 );
 
+// The evaluations only read coeffs and powers, so one set of query powers
+// can serve every chunk and thread
 Ciphertext<DCRTPoly> PolyEvalLinearPtxt(
     HE &bfv,
-    std::vector<Plaintext> coeffs,
-    std::vector<Ciphertext<DCRTPoly>> powers
+    const std::vector<Plaintext> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers
 );
 
 Ciphertext<DCRTPoly> PolyEvalLinearCtxt(
     HE &bfv,
-    std::vector<Ciphertext<DCRTPoly>> coeffs,
-    std::vector<Ciphertext<DCRTPoly>> powers
+    const std::vector<Ciphertext<DCRTPoly>> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers
 );
 
 Ciphertext<DCRTPoly> PolyEvalPS(
     HE &bfv,
-    std::vector<Plaintext> coeffs,
-    std::vector<Ciphertext<DCRTPoly>> powers,
+    const std::vector<Plaintext> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers,
+    uint32_t ps_low_degree
+);
+
+// Encrypted coefficients (encrypted DB); see core.cpp
+Ciphertext<DCRTPoly> PolyEvalPSCtxt(
+    HE &bfv,
+    const std::vector<Ciphertext<DCRTPoly>> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers,
+    uint32_t ps_low_degree
+);
+
+// Per-chunk cost of an encrypted-DB evaluation of the given degree;
+// ps_low_degree = 0 is the linear evaluation
+typedef struct _PolyEvalCost {
+    uint32_t ctxtMults;     // ciphertext-ciphertext products
+    uint32_t relins;        // relinearizations
+    uint32_t numPowers;     // query powers read
+} PolyEvalCost;
+
+PolyEvalCost polyEvalCtxtCost(
+    uint32_t degree,
     uint32_t ps_low_degree
 );
 
@@ -4,6 +4,7 @@
 #include <openfhe.h>
 #include "APSI_core.h"
 #include "../core/hashing.h"
+#include "../core/wire.h"
 #include "HE.h"
 
 using namespace lbcrypto;
@@ -13,16 +14,66 @@ typedef struct _APSIQuery {
     std::vector<uint32_t> pos;
 } APSIQuery;
 
+// Compact wire format of a query (core/wire.h)
+void encodeAPSIQuery(std::string &buf, const APSIQuery &query);
+APSIQuery decodeAPSIQuery(HE &bfv, const std::string &buf, size_t &pos);
+
 APSIQuery constructQuery(
     HE &bfv,
     APSIParams params,
     std::vector<int64_t> items
 );
 
+// Many membership items in one query. The items are cuckoo-placed with
+// computeCuckooHashTableClient (salts 0..h-1) into the bins of the strided
+// slot layout (word k of bin b at slot b + numBins * k), so the DB must be
+// built by computeCuckooHashTableServer with the same h. Empty bins hold -2.
+typedef struct _APSIBatchQuery {
+    APSIQuery query;
+    uint32_t numItems;
+    std::vector<int32_t> binItems;      // item placed in every bin, -1 if empty
+    std::vector<uint32_t> stash;        // items left out; to be sent in another batch
+} APSIBatchQuery;
+
+APSIBatchQuery constructBatchQuery(
+    HE &bfv,
+    const APSIParams &params,
+    const std::vector<std::vector<int64_t>> &items,
+    uint32_t h = 3
+);
+
+// One answer per item of the batch; stashed items are false
+std::vector<bool> findBatchMembership(
+    HE &bfv,
+    const APSIParams &params,
+    const APSIBatchQuery &batch,
+    const std::vector<Ciphertext<DCRTPoly>> &retCtxts
+);
+
+// A bin of a response whose itemLen slots (b + numBins * k) are all zero:
+// the receiver item of that bin is a root of the chunk. item is the index of
+// the item for batch queries, -1 otherwise.
+typedef struct _APSIMatch {
+    uint32_t chunk;
+    uint32_t bin;
+    int32_t item;
+} APSIMatch;
+
+// Decrypts the responses in parallel and scans each one for zero bins
+// (AVX2 when built with it); every match, by chunk and then bin.
+// With binItems, only the bins holding an item are reported.
+std::vector<APSIMatch> decodeIntersection(
+    HE &bfv,
+    const APSIParams &params,
+    const std::vector<Ciphertext<DCRTPoly>> &retCtxts,
+    const std::vector<int32_t> *binItems = nullptr
+);
+
+// First match as {found, bin, chunk}
 std::tuple<bool, int32_t, int32_t> findIntersection(
     HE &bfv,
-    APSIParams params,
-    std::vector<Ciphertext<DCRTPoly>> retCtxts
+    const APSIParams &params,
+    const std::vector<Ciphertext<DCRTPoly>> &retCtxts
 );
 
 APSIQuery constructPSIQuery(
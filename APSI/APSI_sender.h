@@ -7,6 +7,9 @@
 #include "poly.h"
 #include "HE.h"
 #include "powers.h"
+#include "../core/aggtree.h"
+#include <map>
+#include <memory>
 
 using namespace lbcrypto;
 
@@ -31,35 +34,122 @@ typedef struct _APSICtxtDB {
     uint32_t polyDeg;
 } APSICtxtDB;
 
+// A loaded DB is shared read-only by every query thread. A handle keeps it
+// alive for as long as a query runs; updates publish a new DB instead of
+// changing the one in use (see APSIUpdatableDB::flush).
+typedef std::shared_ptr<const APSIPtxtDB> APSIPtxtDBHandle;
+typedef std::shared_ptr<const APSICtxtDB> APSICtxtDBHandle;
+
+APSIPtxtDBHandle shareDB(APSIPtxtDB &&DB);
+APSICtxtDBHandle shareDB(APSICtxtDB &&DB);
+
 APSIPtxtDB constructPtxtDB (
     HE &bfv,
-    NTTContext ctx,
-    std::vector<std::vector<int64_t>> hashTable,
+    NTTContext &ctx,
+    const SimpleHashTable &hashTable,
     uint32_t maxDegree
 );
 
 APSICtxtDB constructCtxtDB (
     HE &bfv,
-    NTTContext ctx,
-    std::vector<std::vector<int64_t>> hashTable,
+    NTTContext &ctx,
+    const SimpleHashTable &hashTable,
     uint32_t maxDegree
 );
 
 
 
+// Sender DB that takes inserts and deletes without a rebuild.
+// The hash table is padded to the capacity of its chunks (numChunks * maxDegree
+// items per bin) and the coefficients of every chunk are kept as rows of slot
+// vectors. An update replaces one root of the slot polynomials of one chunk,
+// dividing by (x - old) and multiplying by (x - new) in O(maxDegree) per word,
+// and marks the chunk. flush() re-packs the plaintexts of the marked chunks,
+// or adds encryptions of the coefficient deltas to an encrypted DB, into a
+// copy of the chunk list: handles taken before keep the previous version.
+// The DB equals constructPtxtDB/constructCtxtDB of the padded table.
+class APSIUpdatableDB {
+public:
+    APSIUpdatableDB(
+        HE &bfv,
+        NTTContext &ctx,
+        const SimpleHashTable &hashTable,
+        uint32_t maxDegree,
+        bool isEncrypted
+    );
+
+    // false when the bin of the item is full; a rebuild with more chunks is due
+    bool insert(const std::vector<int64_t> &item);
+    // false when the item is not in the DB
+    bool erase(const std::vector<int64_t> &item);
+
+    // Re-encodes the chunks updated since the last flush; returns their number
+    uint32_t flush();
+
+    // The references stay valid until the next flush; handles until released
+    const APSIPtxtDB &getPtxtDB() const;
+    const APSICtxtDB &getCtxtDB() const;
+    APSIPtxtDBHandle getPtxtDBHandle() const;
+    APSICtxtDBHandle getCtxtDBHandle() const;
+    const SimpleHashTable &getHashTable() const { return table; }
+    const std::vector<int64_t> &getCoeffs(uint32_t chunk) const { return coeffs[chunk]; }
+    uint32_t getNumChunks() const { return coeffs.size(); }
+    uint64_t getNumItems() const;
+
+private:
+    int64_t &entry(uint32_t k, uint32_t c, uint32_t b) {
+        return table.data[((uint64_t)k * table.maxBin + c) * table.numBins + b];
+    }
+    uint32_t binOf(const std::vector<int64_t> &item) const;
+    // Updated coefficients of one slot; the DB is not touched until setSlot
+    std::vector<int64_t> replaceRoot(uint32_t chunk, uint32_t slot, int64_t oldRoot, int64_t newRoot) const;
+    void setSlot(uint32_t chunk, uint32_t slot, const std::vector<int64_t> &col);
+
+    HE &bfv;
+    bool isEncrypted;
+    uint32_t maxDegree;
+    uint32_t numSlots;
+    SimpleHashTable table;
+    std::vector<uint32_t> load;
+    std::vector<std::vector<int64_t>> coeffs;
+    // Coefficients of the slots touched since the last flush, as they were
+    std::vector<std::map<uint32_t, std::vector<int64_t>>> pending;
+    APSIPtxtDBHandle ptxtDB;
+    APSICtxtDBHandle ctxtDB;
+};
+
+// Nothing of the DB or the query is copied or modified; concurrent queries
+// against one DB are safe
+std::vector<Ciphertext<DCRTPoly>> compInterPtxt(
+    HE &bfv,
+    const APSIParams &params,
+    const APSIPtxtDB &DB,
+    const APSIQuery &query,
+    uint32_t remDepth
+);
+
+std::vector<Ciphertext<DCRTPoly>> compInterCtxt(
+    HE &bfv,
+    const APSIParams &params,
+    const APSICtxtDB &DB,
+    const APSIQuery &query,
+    uint32_t remDepth
+);
+
+// Hold the DB for the duration of the query
 std::vector<Ciphertext<DCRTPoly>> compInterPtxt(
     HE &bfv,
-    APSIParams params,
-    APSIPtxtDB DB,
-    APSIQuery query,
+    const APSIParams &params,
+    const APSIPtxtDBHandle &DB,
+    const APSIQuery &query,
     uint32_t remDepth
 );
 
 std::vector<Ciphertext<DCRTPoly>> compInterCtxt(
     HE &bfv,
-    APSIParams params,
-    APSICtxtDB DB,
-    APSIQuery query,
+    const APSIParams &params,
+    const APSICtxtDBHandle &DB,
+    const APSIQuery &query,
     uint32_t remDepth
 );
 
@@ -68,4 +158,13 @@ std::vector<Ciphertext<DCRTPoly>> compAggResponse(
     std::vector<std::vector<Ciphertext<DCRTPoly>>> responses
 );
 
+// Aggregation tree with an AggOp::PRODUCT plan (core/aggtree.h); every node
+// multiplies the chunks of its children at depth log2(fanOut) and forwards
+// them compressed to the towers of the remaining depth.
+std::vector<Ciphertext<DCRTPoly>> compAggResponse(
+    HE &bfv,
+    const std::vector<std::vector<Ciphertext<DCRTPoly>>> &responses,
+    const AggTreePlan &plan
+);
+
 #endif
\ No newline at end of file
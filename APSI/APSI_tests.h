@@ -14,9 +14,19 @@ void testHashing();
 void testPolyOps();
 void testSender();
 void testFullProtocolTwoParty(int numParties);
-void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted);
-void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted);
+void testBatchQuery(uint32_t numItem, uint32_t maxBatch);
+void testDecode(uint32_t numCtxts);
+// paramPath is a preset of APSI/params; empty selects one by the set size.
+// sourceDepth >= 0 replaces its query powers by optimized ones.
+void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted, const std::string &paramPath = "", int32_t sourceDepth = -1);
+void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted, const std::string &paramPath = "", int32_t sourceDepth = -1);
+void testNTT(uint32_t logN, uint32_t numPolys);
+void testInterPolyBatch(uint32_t numItem, uint32_t logRingDim);
+void testPtxtEncoding(uint32_t numPtxts);
+void testDBUpdate(uint32_t numItem, uint32_t numUpdates, bool isEncrypted);
 void testPolyEvals();
+void testPolyEvalCtxt(const std::string &paramPath = "");
+void testSourcePowers(const std::string &paramPath, uint32_t maxDepth, const std::string &outPath = "");
 void testIntersectionPoly();
 
 #endif
\ No newline at end of file
@@ -1,6 +1,546 @@
 #include "APSI_core.h"
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <map>
 
 // Read JSON Files
+namespace {
+
+struct JsonValue {
+    enum Type {NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT} type = NUL;
+    bool boolean = false;
+    double number = 0;
+    std::string str;
+    std::vector<JsonValue> items;
+    std::map<std::string, JsonValue> fields;
+
+    bool has(const std::string &key) const {
+        return type == OBJECT && fields.count(key) > 0;
+    }
+
+    const JsonValue &at(const std::string &key) const {
+        if (!has(key)) {
+            throw std::runtime_error("Missing JSON field: " + key);
+        }
+        return fields.at(key);
+    }
+
+    uint32_t asUint() const {
+        if (type != NUMBER || number < 0 || number != (uint32_t)number) {
+            throw std::runtime_error("Expected a non-negative integer in JSON");
+        }
+        return (uint32_t)number;
+    }
+
+    std::vector<uint32_t> asUintVec() const {
+        if (type != ARRAY) {
+            throw std::runtime_error("Expected an array in JSON");
+        }
+        std::vector<uint32_t> ret;
+        for (auto &item : items) {
+            ret.push_back(item.asUint());
+        }
+        return ret;
+    }
+};
+
+// Recursive descent over the whole file; enough for the parameter files
+class JsonParser {
+public:
+    JsonParser(const std::string &text): text(text), pos(0) {}
+
+    JsonValue parse() {
+        JsonValue ret = parseValue();
+        skipSpace();
+        if (pos != text.size()) {
+            fail("trailing characters");
+        }
+        return ret;
+    }
+
+private:
+    const std::string &text;
+    size_t pos;
+
+    [[noreturn]] void fail(const std::string &msg) {
+        throw std::runtime_error("JSON parse error at offset " + std::to_string(pos) + ": " + msg);
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+    }
+
+    void expect(char c) {
+        skipSpace();
+        if (pos >= text.size() || text[pos] != c) {
+            fail(std::string("expected '") + c + "'");
+        }
+        pos++;
+    }
+
+    bool consume(const std::string &word) {
+        if (text.compare(pos, word.size(), word) == 0) {
+            pos += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos >= text.size()) {
+            fail("unexpected end");
+        }
+        JsonValue ret;
+        char c = text[pos];
+        if (c == '{') {
+            ret.type = JsonValue::OBJECT;
+            pos++;
+            skipSpace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return ret;
+            }
+            do {
+                skipSpace();
+                std::string key = parseString();
+                expect(':');
+                ret.fields[key] = parseValue();
+                skipSpace();
+            } while (pos < text.size() && text[pos] == ',' && ++pos);
+            expect('}');
+        } else if (c == '[') {
+            ret.type = JsonValue::ARRAY;
+            pos++;
+            skipSpace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return ret;
+            }
+            do {
+                ret.items.push_back(parseValue());
+                skipSpace();
+            } while (pos < text.size() && text[pos] == ',' && ++pos);
+            expect(']');
+        } else if (c == '"') {
+            ret.type = JsonValue::STRING;
+            ret.str = parseString();
+        } else if (consume("true")) {
+            ret.type = JsonValue::BOOL;
+            ret.boolean = true;
+        } else if (consume("false")) {
+            ret.type = JsonValue::BOOL;
+        } else if (consume("null")) {
+            ret.type = JsonValue::NUL;
+        } else {
+            size_t end = pos;
+            while (end < text.size() && std::strchr("+-0123456789.eE", text[end]) != nullptr) {
+                end++;
+            }
+            if (end == pos) {
+                fail("unexpected character");
+            }
+            ret.type = JsonValue::NUMBER;
+            ret.number = std::stod(text.substr(pos, end - pos));
+            pos = end;
+        }
+        return ret;
+    }
+
+    std::string parseString() {
+        if (pos >= text.size() || text[pos] != '"') {
+            fail("expected a string");
+        }
+        std::string ret;
+        for (pos++; pos < text.size() && text[pos] != '"'; pos++) {
+            if (text[pos] == '\\') {
+                if (++pos >= text.size()) {
+                    break;
+                }
+                char e = text[pos];
+                ret += (e == 'n') ? '\n' : (e == 't') ? '\t' : e;
+            } else {
+                ret += text[pos];
+            }
+        }
+        if (pos >= text.size()) {
+            fail("unterminated string");
+        }
+        pos++;
+        return ret;
+    }
+};
+
+// "2_16M-1.json" -> 16 * 2^20
+uint64_t parsePresetSize(const std::string &name) {
+    size_t start = name.find('_');
+    start = (start == std::string::npos) ? 0 : start + 1;
+    size_t end = start;
+    while (end < name.size() && std::isdigit((unsigned char)name[end])) {
+        end++;
+    }
+    if (end == start || end == name.size()) {
+        return 0;
+    }
+    uint64_t size = std::stoull(name.substr(start, end - start));
+    switch (name[end]) {
+        case 'K': return size << 10;
+        case 'M': return size << 20;
+        case 'G': return size << 30;
+        default: return 0;
+    }
+}
+
+} // namespace
+
+APSIPreset loadAPSIPreset(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    JsonValue root = JsonParser(text).parse();
+
+    const JsonValue &table = root.at("table_params");
+    const JsonValue &query = root.at("query_params");
+    const JsonValue &seal = root.at("seal_params");
+
+    APSIPreset preset;
+    preset.name = path.substr(path.find_last_of('/') + 1);
+    preset.maxItems = parsePresetSize(preset.name);
+    preset.params.pos = query.at("query_powers").asUintVec();
+    preset.params.itemLen = root.at("item_params").at("felts_per_item").asUint();
+    preset.params.maxBin = table.at("max_items_per_bin").asUint();
+    preset.params.ps_low_degree = query.at("ps_low_degree").asUint();
+    preset.hashFuncCount = table.at("hash_func_count").asUint();
+    preset.tableSize = table.at("table_size").asUint();
+    preset.polyModulusDegree = seal.at("poly_modulus_degree").asUint();
+    preset.plainModulusBits = seal.has("plain_modulus_bits")
+        ? seal.at("plain_modulus_bits").asUint()
+        : (uint32_t)std::ceil(std::log2((double)seal.at("plain_modulus").asUint()));
+    preset.coeffModulusBits = seal.at("coeff_modulus_bits").asUintVec();
+
+    // Checks that the sender relies on
+    std::vector<uint32_t> &pos = preset.params.pos;
+    if (pos.empty() || std::find(pos.begin(), pos.end(), 1) == pos.end()) {
+        throw std::runtime_error(path + ": query_powers must contain 1");
+    }
+    for (uint32_t p : pos) {
+        if (p == 0 || p > preset.params.maxBin) {
+            throw std::runtime_error(path + ": query power out of range");
+        }
+    }
+    if (preset.params.itemLen == 0 || preset.params.maxBin == 0 || preset.hashFuncCount == 0) {
+        throw std::runtime_error(path + ": felts_per_item, max_items_per_bin and hash_func_count must be positive");
+    }
+    if (preset.params.ps_low_degree >= preset.params.maxBin) {
+        throw std::runtime_error(path + ": ps_low_degree must be below max_items_per_bin");
+    }
+    return preset;
+}
+
+std::vector<APSIPreset> loadAPSIPresets(const std::string &dir) {
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        throw std::runtime_error("Cannot open the parameter directory " + dir);
+    }
+    std::vector<std::string> names;
+    for (struct dirent *ent = readdir(d); ent != nullptr; ent = readdir(d)) {
+        std::string name = ent->d_name;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0) {
+            names.push_back(name);
+        }
+    }
+    closedir(d);
+
+    std::vector<APSIPreset> presets;
+    for (auto &name : names) {
+        presets.push_back(loadAPSIPreset(dir + "/" + name));
+    }
+    std::sort(presets.begin(), presets.end(), [](const APSIPreset &a, const APSIPreset &b) {
+        return std::make_pair(a.maxItems, a.name) < std::make_pair(b.maxItems, b.name);
+    });
+    return presets;
+}
+
+APSIPreset selectAPSIPreset(uint64_t numItems, const std::string &dir) {
+    std::vector<APSIPreset> presets = loadAPSIPresets(dir);
+    if (presets.empty()) {
+        throw std::runtime_error("No parameter files in " + dir);
+    }
+    for (auto &preset : presets) {
+        if (preset.maxItems >= numItems) {
+            return preset;
+        }
+    }
+    return presets.back();
+}
+
+std::set<uint32_t> computeTargetPowers(
+    const APSIParams &params,
+    bool usePS
+) {
+    std::set<uint32_t> targets;
+    if (!usePS || params.ps_low_degree == 0) {
+        for (uint32_t i = 1; i <= params.maxBin; i++) {
+            targets.insert(i);
+        }
+        return targets;
+    }
+    uint32_t high = params.ps_low_degree + 1;
+    for (uint32_t i = 1; i <= params.ps_low_degree; i++) {
+        targets.insert(i);
+    }
+    for (uint32_t i = high; i <= params.maxBin; i += high) {
+        targets.insert(i);
+    }
+    return targets;
+}
+
+uint32_t computeAPSIDepth(
+    const APSIPreset &preset,
+    bool isEncrypted,
+    uint32_t numParties
+) {
+    std::set<uint32_t> targets = computeTargetPowers(preset.params, true);
+    std::set<uint32_t> sources(preset.params.pos.begin(), preset.params.pos.end());
+    PowersDag dag;
+    if (!dag.configure(sources, targets)) {
+        throw std::runtime_error(preset.name + ": query_powers cannot reach max_items_per_bin");
+    }
+    return dag.depth() + (preset.params.ps_low_degree > 0) + isEncrypted
+        + (uint32_t)std::ceil(std::log2(numParties));
+}
+
+namespace {
+
+// Minimal depth of every target over the given sources, with the rule of
+// PowersDag::configure: a target is a source, or the sum of two targets.
+// Unreachable targets get SOURCE_DEPTH_UNREACHABLE.
+std::vector<uint32_t> sourceDepths(
+    const std::vector<uint32_t> &targets,
+    const std::vector<int32_t> &index,
+    const std::vector<bool> &isSource
+) {
+    std::vector<uint32_t> depth(targets.size(), SOURCE_DEPTH_UNREACHABLE);
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (isSource[i]) {
+            depth[i] = 0;
+            continue;
+        }
+        uint32_t p = targets[i];
+        for (size_t j = 0; j < i && 2 * targets[j] <= p; j++) {
+            int32_t k = index[p - targets[j]];
+            if (k < 0) {
+                continue;
+            }
+            uint32_t d = std::max(depth[j], depth[k]);
+            if (d != SOURCE_DEPTH_UNREACHABLE && d + 1 < depth[i]) {
+                depth[i] = d + 1;
+            }
+        }
+    }
+    return depth;
+}
+
+// Dense view of a target set for the searches below
+struct SourceSearch {
+    std::vector<uint32_t> targets;
+    std::vector<int32_t> index;     // power -> position in targets, -1 if absent
+
+    explicit SourceSearch(const std::set<uint32_t> &targetSet)
+        : targets(targetSet.begin(), targetSet.end()) {
+        if (targets.empty() || targets[0] != 1) {
+            throw std::runtime_error("Target powers must contain 1");
+        }
+        index.assign(targets.back() + 1, -1);
+        for (size_t i = 0; i < targets.size(); i++) {
+            index[targets[i]] = i;
+        }
+    }
+
+    // {targets above maxDepth, sum of the depths}
+    std::pair<uint32_t, uint64_t> score(const std::vector<bool> &isSource, uint32_t maxDepth) const {
+        std::vector<uint32_t> depth = sourceDepths(targets, index, isSource);
+        uint32_t numOver = 0;
+        uint64_t sum = 0;
+        for (uint32_t d : depth) {
+            if (d > maxDepth) {
+                numOver++;
+                sum += targets.back();
+            } else {
+                sum += d;
+            }
+        }
+        return {numOver, sum};
+    }
+
+    std::set<uint32_t> toSet(const std::vector<bool> &isSource) const {
+        std::set<uint32_t> ret;
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (isSource[i]) {
+                ret.insert(targets[i]);
+            }
+        }
+        return ret;
+    }
+};
+
+// Tries every set of numSources sources that contains 1
+bool searchExhaustive(
+    const SourceSearch &search,
+    uint32_t maxDepth,
+    uint32_t numSources,
+    std::vector<bool> &isSource
+) {
+    size_t n = search.targets.size();
+    std::vector<size_t> pick(numSources - 1);
+    for (size_t i = 0; i < pick.size(); i++) {
+        pick[i] = i + 1;
+    }
+    while (true) {
+        std::fill(isSource.begin(), isSource.end(), false);
+        isSource[0] = true;
+        for (size_t i : pick) {
+            isSource[i] = true;
+        }
+        if (search.score(isSource, maxDepth).first == 0) {
+            return true;
+        }
+        // Next combination of pick over [1, n)
+        int32_t i = (int32_t)pick.size() - 1;
+        while (i >= 0 && pick[i] == n - pick.size() + i) {
+            i--;
+        }
+        if (i < 0) {
+            return false;
+        }
+        pick[i]++;
+        for (size_t j = i + 1; j < pick.size(); j++) {
+            pick[j] = pick[j - 1] + 1;
+        }
+    }
+}
+
+} // namespace
+
+uint32_t computeSourceDepth(
+    const std::set<uint32_t> &sources,
+    const std::set<uint32_t> &targets
+) {
+    SourceSearch search(targets);
+    std::vector<bool> isSource(search.targets.size(), false);
+    for (uint32_t s : sources) {
+        if (s < search.index.size() && search.index[s] >= 0) {
+            isSource[search.index[s]] = true;
+        }
+    }
+    std::vector<uint32_t> depth = sourceDepths(search.targets, search.index, isSource);
+    return *std::max_element(depth.begin(), depth.end());
+}
+
+std::set<uint32_t> optimizeSourcePowers(
+    const std::set<uint32_t> &targets,
+    uint32_t maxDepth
+) {
+    SourceSearch search(targets);
+    size_t n = search.targets.size();
+    std::vector<bool> isSource(n, false);
+    isSource[0] = true;
+
+    if (maxDepth == 0) {
+        return targets;
+    }
+
+    if (n <= SOURCE_EXHAUSTIVE_TARGETS) {
+        for (uint32_t k = 1; k <= n; k++) {
+            if (searchExhaustive(search, maxDepth, k, isSource)) {
+                return search.toSet(isSource);
+            }
+        }
+        return targets;
+    }
+
+    // Greedy: add the target that leaves the fewest targets over the budget,
+    // then the smallest total depth
+    auto curr = search.score(isSource, maxDepth);
+    while (curr.first > 0) {
+        size_t best = 0;
+        auto bestScore = curr;
+        for (size_t i = 1; i < n; i++) {
+            if (isSource[i]) {
+                continue;
+            }
+            isSource[i] = true;
+            auto s = search.score(isSource, maxDepth);
+            isSource[i] = false;
+            if (best == 0 || s < bestScore) {
+                best = i;
+                bestScore = s;
+            }
+        }
+        isSource[best] = true;
+        curr = bestScore;
+    }
+
+    // Drop sources the others make redundant, largest first
+    for (size_t i = n - 1; i > 0; i--) {
+        if (!isSource[i]) {
+            continue;
+        }
+        isSource[i] = false;
+        if (search.score(isSource, maxDepth).first > 0) {
+            isSource[i] = true;
+        }
+    }
+    return search.toSet(isSource);
+}
+
+void saveAPSIPreset(const APSIPreset &preset, const std::string &path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    auto writeList = [&out](const std::vector<uint32_t> &vals) {
+        out << "[";
+        for (size_t i = 0; i < vals.size(); i++) {
+            out << (i ? ", " : " ") << vals[i];
+        }
+        out << " ]";
+    };
+
+    std::vector<uint32_t> pos = preset.params.pos;
+    std::sort(pos.begin(), pos.end());
+    out << "{\n"
+        << "    \"table_params\": {\n"
+        << "        \"hash_func_count\": " << preset.hashFuncCount << ",\n"
+        << "        \"table_size\": " << preset.tableSize << ",\n"
+        << "        \"max_items_per_bin\": " << preset.params.maxBin << "\n"
+        << "    },\n"
+        << "    \"item_params\": {\n"
+        << "        \"felts_per_item\": " << preset.params.itemLen << "\n"
+        << "    },\n"
+        << "    \"query_params\": {\n"
+        << "        \"ps_low_degree\": " << preset.params.ps_low_degree << ",\n"
+        << "        \"query_powers\": ";
+    writeList(pos);
+    out << "\n"
+        << "    },\n"
+        << "    \"seal_params\": {\n"
+        << "        \"plain_modulus_bits\": " << preset.plainModulusBits << ",\n"
+        << "        \"poly_modulus_degree\": " << preset.polyModulusDegree << ",\n"
+        << "        \"coeff_modulus_bits\": ";
+    writeList(preset.coeffModulusBits);
+    out << "\n"
+        << "    }\n"
+        << "}\n";
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
 
 
 // ModPow = a^n mod p
@@ -47,53 +587,55 @@ void compute_all_powers(
 
 // Polynomial Evaluation
 
+// Products are summed into the result in place; powers stay untouched
 Ciphertext<DCRTPoly> PolyEvalLinearPtxt(
     HE &bfv,
-    std::vector<Plaintext> coeffs,
-    std::vector<Ciphertext<DCRTPoly>> powers
+    const std::vector<Plaintext> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers
 ) {
     uint32_t deg = powers.size();
 
-    if (coeffs.size() != deg + 1) {
+    if (deg == 0 || coeffs.size() != deg + 1) {
         throw std::runtime_error(
             "Degree Mismatch! " + std::to_string(coeffs.size()) + " vs " + std::to_string(deg + 1)
         );
     }
+    CryptoContext<DCRTPoly> cc = bfv.getCryptoContext();
 
-    for (uint32_t i = 0; i < deg; i++) {        
-        powers[i] = bfv.mult(powers[i], coeffs[i+1]);
+    Ciphertext<DCRTPoly> ret = bfv.mult(powers[0], coeffs[1]);
+    for (uint32_t i = 1; i < deg; i++) {
+        cc->EvalAddInPlace(ret, bfv.mult(powers[i], coeffs[i+1]));
     }
-    Ciphertext<DCRTPoly> ret = bfv.addmany(powers);
-    ret = bfv.add(coeffs[0], ret);
+    cc->EvalAddInPlace(ret, coeffs[0]);
     return ret;
 }
 
 Ciphertext<DCRTPoly> PolyEvalLinearCtxt(
     HE &bfv,
-    std::vector<Ciphertext<DCRTPoly>> coeffs,
-    std::vector<Ciphertext<DCRTPoly>> powers
+    const std::vector<Ciphertext<DCRTPoly>> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers
 ) {
     uint32_t deg = powers.size();
 
-    if (coeffs.size() != deg + 1) {
+    if (deg == 0 || coeffs.size() != deg + 1) {
         throw std::runtime_error(
             "Degree Mismatch! " + std::to_string(coeffs.size()) + " vs " + std::to_string(deg + 1)
         );
     }
+    CryptoContext<DCRTPoly> cc = bfv.getCryptoContext();
 
-    // #pragma omp parallel for
-    for (uint32_t i = 0; i < deg; i++) {        
-        powers[i] = bfv.mult(powers[i], coeffs[i+1]);
+    Ciphertext<DCRTPoly> ret = bfv.mult(powers[0], coeffs[1]);
+    for (uint32_t i = 1; i < deg; i++) {
+        cc->EvalAddInPlace(ret, bfv.mult(powers[i], coeffs[i+1]));
     }
-    Ciphertext<DCRTPoly> ret = bfv.addmany(powers);
-    ret = bfv.add(coeffs[0], ret);
+    cc->EvalAddInPlace(ret, coeffs[0]);
     return ret;
 }
 
 Ciphertext<DCRTPoly> PolyEvalPS(
     HE &bfv,
-    std::vector<Plaintext> coeffs,
-    std::vector<Ciphertext<DCRTPoly>> powers,
+    const std::vector<Plaintext> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers,
     uint32_t ps_low_degree
 ) {
     uint32_t degree = coeffs.size() - 1;
@@ -170,6 +712,85 @@ Ciphertext<DCRTPoly> PolyEvalPS(
     return res;
 }
 
+// Paterson-Stockmeyer with encrypted coefficients, H = ps_low_degree + 1:
+//   p(x) = sum_i x^{iH} * (c_{iH} + sum_{j=1}^{H-1} c_{iH+j} x^j)
+// Every coefficient still costs one ciphertext product, but the products of a
+// block are summed unrelinearized and relinearized once, and the outer
+// products are summed the same way; only x^1..x^{H-1} and x^{iH} are read.
+Ciphertext<DCRTPoly> PolyEvalPSCtxt(
+    HE &bfv,
+    const std::vector<Ciphertext<DCRTPoly>> &coeffs,
+    const std::vector<Ciphertext<DCRTPoly>> &powers,
+    uint32_t ps_low_degree
+) {
+    if (ps_low_degree == 0 || coeffs.empty()) {
+        throw std::runtime_error("Paterson-Stockmeyer needs a positive low degree");
+    }
+    uint32_t degree = coeffs.size() - 1;
+    uint32_t ps_high_degree = ps_low_degree + 1;
+    uint32_t numBlocks = degree / ps_high_degree + 1;
+    if (powers.size() < degree) {
+        throw std::runtime_error(
+            "Degree Mismatch! " + std::to_string(powers.size()) + " powers for degree " + std::to_string(degree)
+        );
+    }
+    CryptoContext<DCRTPoly> cc = bfv.getCryptoContext();
+
+    Ciphertext<DCRTPoly> res;
+    for (uint32_t i = 0; i < numBlocks; i++) {
+        uint32_t base = i * ps_high_degree;
+        uint32_t blockDeg = std::min(ps_low_degree, degree - base);
+
+        // Inner sum, left at three elements
+        Ciphertext<DCRTPoly> inner;
+        for (uint32_t j = 1; j <= blockDeg; j++) {
+            Ciphertext<DCRTPoly> _tmp = cc->EvalMultNoRelin(coeffs[base + j], powers[j - 1]);
+            if (j == 1) {
+                inner = _tmp;
+            } else {
+                cc->EvalAddInPlace(inner, _tmp);
+            }
+        }
+        if (!inner) {
+            inner = coeffs[base]->Clone();
+        } else {
+            cc->EvalAddInPlace(inner, coeffs[base]);
+        }
+
+        // Outer product with x^{iH}; the first block is summed as it is
+        if (i > 0) {
+            if (blockDeg > 0) {
+                inner = cc->Relinearize(inner);
+            }
+            inner = cc->EvalMultNoRelin(inner, powers[base - 1]);
+        }
+        if (i == 0) {
+            res = inner;
+        } else {
+            cc->EvalAddInPlace(res, inner);
+        }
+    }
+    return cc->Relinearize(res);
+}
+
+PolyEvalCost polyEvalCtxtCost(
+    uint32_t degree,
+    uint32_t ps_low_degree
+) {
+    if (ps_low_degree == 0) {
+        return PolyEvalCost { degree, degree, degree };
+    }
+    uint32_t ps_high_degree = ps_low_degree + 1;
+    uint32_t numHigh = degree / ps_high_degree;
+    // A last block made of its constant term alone is not relinearized
+    uint32_t blockRelins = numHigh - (numHigh > 0 && degree % ps_high_degree == 0);
+    return PolyEvalCost {
+        degree,
+        blockRelins + 1,
+        std::min(ps_low_degree, degree) + numHigh
+    };
+}
+
 
 // Make a Random Vector
 Plaintext makeRandomMask(
@@ -19,7 +19,11 @@ void printUsage() {
               << " -numParties <int>"
               << " -numItems <int>"
               << " -isEncrypted <bool>"
-              << " -isPSI <bool>" << "\n\n";
+              << " -isPSI <bool>"
+              << " [-params <path to APSI/params/*.json>]"
+              << " [-sourceDepth <int>]" << "\n"
+              << "   or: ./main_apsi -bench <psCtxt, ntt, interp, encode, update, sources, batch or decode> [-params <path>] [-logN <int>] [-numItems <int>]"
+              << " [-numPtxts <int>] [-maxBatch <int>] [-numCtxts <int>] [-numUpdates <int>] [-isEncrypted <bool>] [-maxDepth <int>] [-out <path>]" << "\n\n";
             //   << " -allowIntersection <0 or 1>\n\n"
             //   << "Example:\n"
             //   << "  ./main -numItem 30 -lenData 2 -numPack 4 -numAgg 10 -alpha 5 -interType (CI or CPI or CIH or CPIH) -allowIntersection 1 \n\n";
@@ -47,6 +51,74 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Micro-benchmarks take no protocol flags
+    if (args.count("-bench")) {
+        std::string paramPath = args.count("-params") ? args["-params"] : "";
+        if (args["-bench"] == "psCtxt") {
+            testPolyEvalCtxt(paramPath);
+        } else if (args["-bench"] == "ntt") {
+            std::string logN = args.count("-logN") ? args["-logN"] : "12";
+            if (!isValidNumber(logN) || std::stoi(logN) < 1 || std::stoi(logN) > 16) {
+                std::cerr << "Error: logN must be between 1 and 16.\n";
+                return 1;
+            }
+            testNTT(std::stoi(logN), 1024);
+        } else if (args["-bench"] == "interp") {
+            std::string numItems = args.count("-numItems") ? args["-numItems"] : "20";
+            std::string logN = args.count("-logN") ? args["-logN"] : "14";
+            if (!isValidNumber(numItems) || !isValidNumber(logN) || std::stoi(logN) < 10 || std::stoi(logN) > 17) {
+                std::cerr << "Error: numItems must be a positive integer and logN between 10 and 17.\n";
+                return 1;
+            }
+            testInterPolyBatch(std::stoi(numItems), std::stoi(logN));
+        } else if (args["-bench"] == "encode") {
+            std::string numPtxts = args.count("-numPtxts") ? args["-numPtxts"] : "256";
+            if (!isValidNumber(numPtxts) || std::stoi(numPtxts) == 0) {
+                std::cerr << "Error: numPtxts must be a positive integer.\n";
+                return 1;
+            }
+            testPtxtEncoding(std::stoi(numPtxts));
+        } else if (args["-bench"] == "update") {
+            std::string numItems = args.count("-numItems") ? args["-numItems"] : "16";
+            std::string numUpdates = args.count("-numUpdates") ? args["-numUpdates"] : "64";
+            std::string isEncrypted = args.count("-isEncrypted") ? args["-isEncrypted"] : "0";
+            if (!isValidNumber(numItems) || !isValidNumber(numUpdates) || std::stoi(numUpdates) == 0
+                || (isEncrypted != "0" && isEncrypted != "1")) {
+                std::cerr << "Error: numItems and numUpdates must be positive integers, isEncrypted 0 or 1.\n";
+                return 1;
+            }
+            testDBUpdate(std::stoi(numItems), std::stoi(numUpdates), isEncrypted == "1");
+        } else if (args["-bench"] == "batch") {
+            std::string numItems = args.count("-numItems") ? args["-numItems"] : "12";
+            std::string maxBatch = args.count("-maxBatch") ? args["-maxBatch"] : "1024";
+            if (!isValidNumber(numItems) || !isValidNumber(maxBatch) || std::stoi(maxBatch) == 0) {
+                std::cerr << "Error: numItems and maxBatch must be positive integers.\n";
+                return 1;
+            }
+            testBatchQuery(std::stoi(numItems), std::stoi(maxBatch));
+        } else if (args["-bench"] == "decode") {
+            std::string numCtxts = args.count("-numCtxts") ? args["-numCtxts"] : "256";
+            if (!isValidNumber(numCtxts) || std::stoi(numCtxts) == 0) {
+                std::cerr << "Error: numCtxts must be a positive integer.\n";
+                return 1;
+            }
+            testDecode(std::stoi(numCtxts));
+        } else if (args["-bench"] == "sources") {
+            std::string maxDepth = args.count("-maxDepth") ? args["-maxDepth"] : "4";
+            std::string outPath = args.count("-out") ? args["-out"] : "";
+            if (!isValidNumber(maxDepth) || std::stoi(maxDepth) == 0) {
+                std::cerr << "Error: maxDepth must be a positive integer.\n";
+                return 1;
+            }
+            testSourcePowers(paramPath, std::stoi(maxDepth), outPath);
+        } else {
+            std::cerr << "Error: Unknown benchmark '" << args["-bench"] << "'.\n";
+            printUsage();
+            return 1;
+        }
+        return 0;
+    }
+
     // 1. Check if all required flags are present
     for (const auto& flag : REQUIRED_FLAGS) {
         if (args.find(flag) == args.end()) {
@@ -86,21 +158,36 @@ int main(int argc, char* argv[]) {
     }
     bool isPSI = (args["-isPSI"] == "1");    
 
+    // Optional preset; otherwise the smallest one that fits numItems
+    std::string paramPath = args.count("-params") ? args["-params"] : "";
+
+    // Optional depth budget for the query powers; -1 keeps the preset's
+    int sourceDepth = -1;
+    if (args.count("-sourceDepth")) {
+        if (!isValidNumber(args["-sourceDepth"])) {
+            std::cerr << "Error: sourceDepth must be a non-negative integer.\n";
+            return 1;
+        }
+        sourceDepth = std::atoi(args["-sourceDepth"].c_str());
+    }
+
     // 3. Print final values
     std::cout << "Running testFullProtocol with:\n"
               << "  numParties     = " << numParties << "\n"
               << "  numItems     = " << numItems << "\n"
               << "  isEncrypted = " << isEncrypted << "\n"
               << "  isPSI = " << isPSI << "\n"
+              << "  params = " << (paramPath.empty() ? "auto" : paramPath) << "\n"
+              << "  sourceDepth = " << (sourceDepth < 0 ? "preset" : std::to_string(sourceDepth)) << "\n"
               << "\n";
 
     if (isPSI) {
         testFullPSI(
-            numParties, numItems, isEncrypted
+            numParties, numItems, isEncrypted, paramPath, sourceDepth
         );
     } else {
         testFullProtocol(
-            numParties, numItems, isEncrypted
+            numParties, numItems, isEncrypted, paramPath, sourceDepth
         );
     }
     return 0;
@@ -0,0 +1,231 @@
+#include "ntt.h"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+uint64_t powMod(uint64_t a, uint64_t e, uint64_t p) {
+    uint64_t ret = 1;
+    a %= p;
+    while (e > 0) {
+        if (e & 1) {
+            ret = ret * a % p;
+        }
+        a = a * a % p;
+        e >>= 1;
+    }
+    return ret;
+}
+
+uint32_t bitReverse(uint32_t x, uint32_t numBits) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < numBits; i++) {
+        ret = (ret << 1) | ((x >> i) & 1);
+    }
+    return ret;
+}
+
+inline uint32_t shoupOf(uint32_t w, uint32_t p) {
+    return (uint32_t)(((uint64_t)w << 32) / p);
+}
+
+// x * w mod p in [0, 2p), for any 32-bit x
+inline uint32_t mulShoup(uint32_t x, uint32_t w, uint32_t ws, uint32_t p) {
+    uint32_t q = (uint32_t)(((uint64_t)x * ws) >> 32);
+    return x * w - q * p;
+}
+
+#if defined(__AVX2__)
+inline __m256i mulShoup8(__m256i x, __m256i w, __m256i ws, __m256i p) {
+    __m256i qe = _mm256_srli_epi64(_mm256_mul_epu32(x, ws), 32);
+    __m256i qo = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), ws);
+    __m256i q = _mm256_blend_epi32(qe, qo, 0xAA);
+    return _mm256_sub_epi32(_mm256_mullo_epi32(x, w), _mm256_mullo_epi32(q, p));
+}
+
+// x >= bound ? x - bound : x, for unsigned lanes
+inline __m256i condSub8(__m256i x, __m256i bound) {
+    return _mm256_min_epu32(x, _mm256_sub_epi32(x, bound));
+}
+#endif
+
+} // namespace
+
+template <uint32_t P, uint32_t G>
+NTTEngine<P, G>::NTTEngine(uint32_t logN) : logN(logN), n(1u << logN) {
+    if (logN == 0 || ((P - 1) % n) != 0) {
+        throw std::runtime_error("NTT size 2^" + std::to_string(logN) + " does not divide P - 1");
+    }
+    uint32_t half = n / 2;
+    uint64_t root = powMod(G, (P - 1) / n, P);
+    uint64_t rootInv = powMod(root, P - 2, P);
+
+    tw.resize(half);
+    twShoup.resize(half);
+    invTw.resize(half);
+    invTwShoup.resize(half);
+    for (uint32_t i = 0; i < half; i++) {
+        uint32_t e = bitReverse(i, logN - 1);
+        tw[i] = powMod(root, e, P);
+        twShoup[i] = shoupOf(tw[i], P);
+        invTw[i] = powMod(rootInv, e, P);
+        invTwShoup[i] = shoupOf(invTw[i], P);
+    }
+    nInv = powMod(n, P - 2, P);
+    nInvShoup = shoupOf(nInv, P);
+}
+
+template <uint32_t P, uint32_t G>
+void NTTEngine<P, G>::forward(uint32_t *a) const {
+    const uint32_t twoP = 2 * P;
+    for (uint32_t m = 1, t = n / 2; m < n; m <<= 1, t >>= 1) {
+        for (uint32_t i = 0; i < m; i++) {
+            uint32_t w = tw[i];
+            uint32_t ws = twShoup[i];
+            uint32_t *x = a + 2 * i * t;
+            uint32_t *y = x + t;
+            uint32_t j = 0;
+#if defined(__AVX2__)
+            if (t >= 8) {
+                const __m256i vw = _mm256_set1_epi32(w);
+                const __m256i vws = _mm256_set1_epi32(ws);
+                const __m256i vp = _mm256_set1_epi32(P);
+                const __m256i v2p = _mm256_set1_epi32(twoP);
+                for (; j < t; j += 8) {
+                    __m256i u = condSub8(_mm256_loadu_si256((__m256i *)(x + j)), v2p);
+                    __m256i v = mulShoup8(_mm256_loadu_si256((__m256i *)(y + j)), vw, vws, vp);
+                    _mm256_storeu_si256((__m256i *)(x + j), _mm256_add_epi32(u, v));
+                    _mm256_storeu_si256((__m256i *)(y + j), _mm256_add_epi32(_mm256_sub_epi32(u, v), v2p));
+                }
+            }
+#endif
+            for (; j < t; j++) {
+                uint32_t u = x[j] >= twoP ? x[j] - twoP : x[j];
+                uint32_t v = mulShoup(y[j], w, ws, P);
+                x[j] = u + v;
+                y[j] = u - v + twoP;
+            }
+        }
+    }
+    for (uint32_t j = 0; j < n; j++) {
+        uint32_t x = a[j] >= twoP ? a[j] - twoP : a[j];
+        a[j] = x >= P ? x - P : x;
+    }
+}
+
+template <uint32_t P, uint32_t G>
+void NTTEngine<P, G>::inverse(uint32_t *a) const {
+    const uint32_t twoP = 2 * P;
+    for (uint32_t m = n / 2, t = 1; m >= 1; m >>= 1, t <<= 1) {
+        for (uint32_t i = 0; i < m; i++) {
+            uint32_t w = invTw[i];
+            uint32_t ws = invTwShoup[i];
+            uint32_t *x = a + 2 * i * t;
+            uint32_t *y = x + t;
+            uint32_t j = 0;
+#if defined(__AVX2__)
+            if (t >= 8) {
+                const __m256i vw = _mm256_set1_epi32(w);
+                const __m256i vws = _mm256_set1_epi32(ws);
+                const __m256i vp = _mm256_set1_epi32(P);
+                const __m256i v2p = _mm256_set1_epi32(twoP);
+                for (; j < t; j += 8) {
+                    __m256i u = _mm256_loadu_si256((__m256i *)(x + j));
+                    __m256i v = _mm256_loadu_si256((__m256i *)(y + j));
+                    _mm256_storeu_si256((__m256i *)(x + j), condSub8(_mm256_add_epi32(u, v), v2p));
+                    __m256i d = _mm256_add_epi32(_mm256_sub_epi32(u, v), v2p);
+                    _mm256_storeu_si256((__m256i *)(y + j), mulShoup8(d, vw, vws, vp));
+                }
+            }
+#endif
+            for (; j < t; j++) {
+                uint32_t u = x[j];
+                uint32_t v = y[j];
+                uint32_t s = u + v;
+                x[j] = s >= twoP ? s - twoP : s;
+                y[j] = mulShoup(u - v + twoP, w, ws, P);
+            }
+        }
+    }
+    for (uint32_t j = 0; j < n; j++) {
+        uint32_t x = mulShoup(a[j], nInv, nInvShoup, P);
+        a[j] = x >= P ? x - P : x;
+    }
+}
+
+template <uint32_t P, uint32_t G>
+void NTTEngine<P, G>::forwardBatch(uint32_t *a, size_t count) const {
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < count; i++) {
+        forward(a + i * n);
+    }
+}
+
+template <uint32_t P, uint32_t G>
+void NTTEngine<P, G>::inverseBatch(uint32_t *a, size_t count) const {
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < count; i++) {
+        inverse(a + i * n);
+    }
+}
+
+template <uint32_t P, uint32_t G>
+void NTTEngine<P, G>::multiplyPointwise(const uint32_t *a, const uint32_t *b, uint32_t *out) const {
+    for (uint32_t j = 0; j < n; j++) {
+        out[j] = reduce((uint64_t)a[j] * b[j]);
+    }
+}
+
+template <uint32_t P, uint32_t G>
+std::vector<int64_t> NTTEngine<P, G>::multiply(
+    const std::vector<int64_t> &a,
+    const std::vector<int64_t> &b
+) const {
+    if (a.empty() || b.empty()) {
+        return {};
+    }
+    size_t outLen = a.size() + b.size() - 1;
+    if (outLen > n) {
+        throw std::runtime_error("Product of degree " + std::to_string(outLen - 1) + " does not fit the NTT size");
+    }
+
+    // Scratch buffers are reused across calls of the same thread
+    thread_local std::vector<uint32_t> fa, fb;
+    fa.assign(n, 0);
+    fb.assign(n, 0);
+    for (size_t i = 0; i < a.size(); i++) {
+        fa[i] = toField(a[i]);
+    }
+    for (size_t i = 0; i < b.size(); i++) {
+        fb[i] = toField(b[i]);
+    }
+
+    forward(fa.data());
+    forward(fb.data());
+    multiplyPointwise(fa.data(), fb.data(), fa.data());
+    inverse(fa.data());
+
+    return std::vector<int64_t>(fa.begin(), fa.begin() + outLen);
+}
+
+template class NTTEngine<NTT_PRIME, NTT_GENERATOR>;
+
+const NTT65537 &getNTT65537(uint32_t logN) {
+    static std::array<std::unique_ptr<NTT65537>, NTT_MAX_LOGN + 1> engines;
+    static std::array<std::once_flag, NTT_MAX_LOGN + 1> built;
+
+    if (logN == 0 || logN > NTT_MAX_LOGN) {
+        throw std::runtime_error("NTT size 2^" + std::to_string(logN) + " is not supported");
+    }
+    std::call_once(built[logN], [logN] {
+        engines[logN].reset(new NTT65537(logN));
+    });
+    return *engines[logN];
+}
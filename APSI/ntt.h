@@ -0,0 +1,76 @@
+#ifndef APSI_NTT_H
+#define APSI_NTT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cyclic NTT over Z_P for an NTT-friendly prime P with generator G; the
+// modulus is a template parameter, so every reduction is by a constant.
+// Twiddles are precomputed in bit-reversed order together with their Shoup
+// companions floor(w * 2^32 / P). The forward (Cooley-Tukey) butterflies keep
+// values in [0, 4P) and the inverse (Gentleman-Sande) ones in [0, 2P); both
+// reduce to [0, P) at the end.
+// forward() takes natural order and leaves bit-reversed order, inverse() takes
+// it back, so pointwise products need no bit-reversal pass.
+// When built with AVX2, every block of at least 8 butterflies runs 8 lanes at once.
+template <uint32_t P, uint32_t G>
+class NTTEngine {
+public:
+    static_assert(P < (1u << 30), "Lazy butterflies need 4P < 2^32");
+
+    explicit NTTEngine(uint32_t logN);
+
+    uint32_t size() const { return n; }
+    uint32_t logSize() const { return logN; }
+
+    // In place, n values in [0, P)
+    void forward(uint32_t *a) const;
+    void inverse(uint32_t *a) const;
+
+    // count polynomials of n values, stored back to back
+    void forwardBatch(uint32_t *a, size_t count) const;
+    void inverseBatch(uint32_t *a, size_t count) const;
+
+    void multiplyPointwise(const uint32_t *a, const uint32_t *b, uint32_t *out) const;
+
+    // a * b with a.size() + b.size() - 1 <= n; coefficients in [0, P)
+    std::vector<int64_t> multiply(
+        const std::vector<int64_t> &a,
+        const std::vector<int64_t> &b
+    ) const;
+
+    // Barrett reduction of any 64-bit value
+    static uint32_t reduce(uint64_t x) {
+        uint64_t q = (uint64_t)(((unsigned __int128)x * BARRETT) >> 64);
+        uint64_t r = x - q * P;
+        return (uint32_t)(r >= P ? r - P : r);
+    }
+
+    // Any signed value to [0, P)
+    static uint32_t toField(int64_t x) {
+        int64_t r = x % (int64_t)P;
+        return (uint32_t)(r < 0 ? r + P : r);
+    }
+
+private:
+    static constexpr uint64_t BARRETT = ~0ULL / P;
+
+    uint32_t logN;
+    uint32_t n;
+    // Group i of every stage uses the twiddle i
+    std::vector<uint32_t> tw, twShoup;
+    std::vector<uint32_t> invTw, invTwShoup;
+    uint32_t nInv, nInvShoup;
+};
+
+#define NTT_PRIME 65537
+#define NTT_GENERATOR 3
+#define NTT_MAX_LOGN 16
+
+typedef NTTEngine<NTT_PRIME, NTT_GENERATOR> NTT65537;
+
+// Shared engine of size 2^logN, built on first use; thread-safe
+const NTT65537 &getNTT65537(uint32_t logN);
+
+#endif
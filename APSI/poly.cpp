@@ -1,4 +1,8 @@
 #include "poly.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
 
 std::vector<int64_t> PolyAdd(
     const std::vector<int64_t>& a,
@@ -113,6 +117,20 @@ std::vector<int64_t> PolyMultNTT(
     NTTContext &ctx,
     const std::vector<int64_t>& a, 
     const std::vector<int64_t>& b
+) {
+    uint32_t logN = 1;
+    while ((1u << logN) < a.size() + b.size() - 1) logN++;
+
+    if (ctx.prime == NTT_PRIME && logN <= NTT_MAX_LOGN) {
+        return getNTT65537(logN).multiply(a, b);
+    }
+    return PolyMultNTTRef(ctx, a, b);
+}
+
+std::vector<int64_t> PolyMultNTTRef(
+    NTTContext &ctx,
+    const std::vector<int64_t>& a, 
+    const std::vector<int64_t>& b
 ) {
     uint32_t n = 1;
     while (n < a.size() + b.size() - 1) n <<= 1;
@@ -151,8 +169,8 @@ std::vector<int64_t> constructInterPolyNaive (
 // Fast Algorithm to compute
 // (x-a1)(x-a2)...(x-an)
 std::vector<int64_t> constructInterPoly(
-    NTTContext ctx,
-    std::vector<int64_t> vals
+    NTTContext &ctx,
+    const std::vector<int64_t> &vals
 ) {
     // x - a
     if (vals.size() == 1) {
@@ -181,6 +199,195 @@ std::vector<int64_t> constructInterPoly(
     }
 }
 
+namespace {
+
+#define SUBPRODUCT_WIDTH 16
+#define SUBPRODUCT_SCHOOLBOOK_DEGREE 64
+
+// Subproduct tree of SUBPRODUCT_WIDTH lanes with the same number of roots.
+// Coefficients are interleaved (coefficient-major, lane-minor), so every
+// merge runs on all lanes in lockstep. Level buffers, accumulators and NTT
+// scratch are carved once from the arenas of a builder and reused per tile.
+class SubproductTree {
+public:
+    explicit SubproductTree(uint32_t degree) : degree(degree) {
+        if (degree > (1u << NTT_MAX_LOGN)) {
+            throw std::runtime_error("Too many roots for the NTT: " + std::to_string(degree));
+        }
+        // A level holds at most 2 * degree coefficients (degree + #nodes)
+        levelSize = (size_t)2 * degree * W;
+        nttSize = 1;
+        while (nttSize < degree) nttSize <<= 1;
+        arena.resize(2 * levelSize + 2 * nttSize);
+        accArena.resize((size_t)(SUBPRODUCT_SCHOOLBOOK_DEGREE + 1) * W);
+        degs.reserve(degree);
+        nextDegs.reserve(degree);
+    }
+
+    // roots(i, lane) = roots[i * rootStride + lane]; writes coefficient k of
+    // lane to out[k * outStride + lane] for lane < numLanes
+    void build(const int64_t *roots, size_t rootStride, uint32_t numLanes, int64_t *out, size_t outStride) {
+        uint32_t *cur = arena.data();
+        uint32_t *next = cur + levelSize;
+
+        // Leaves x - a
+        degs.assign(degree, 1);
+        for (uint32_t i = 0; i < degree; i++) {
+            for (uint32_t lane = 0; lane < W; lane++) {
+                uint32_t a = lane < numLanes ? NTT65537::toField(roots[i * rootStride + lane]) : 0;
+                cur[(2 * i) * W + lane] = a == 0 ? 0 : NTT_PRIME - a;
+                cur[(2 * i + 1) * W + lane] = 1;
+            }
+        }
+
+        // Merge neighbours until one node is left; an odd one moves up as is
+        while (degs.size() > 1) {
+            size_t inOff = 0, outOff = 0;
+            nextDegs.clear();
+            for (size_t k = 0; k + 1 < degs.size(); k += 2) {
+                uint32_t da = degs[k], db = degs[k + 1];
+                const uint32_t *A = cur + inOff * W;
+                const uint32_t *B = A + (size_t)(da + 1) * W;
+                uint32_t *C = next + outOff * W;
+                if (da + db <= SUBPRODUCT_SCHOOLBOOK_DEGREE) {
+                    mulSchoolbook(A, da, B, db, C);
+                } else {
+                    mulNTT(A, da, B, db, C);
+                }
+                inOff += da + db + 2;
+                outOff += da + db + 1;
+                nextDegs.push_back(da + db);
+            }
+            if (degs.size() % 2) {
+                uint32_t d = degs.back();
+                std::memcpy(next + outOff * W, cur + inOff * W, (size_t)(d + 1) * W * sizeof(uint32_t));
+                nextDegs.push_back(d);
+            }
+            std::swap(cur, next);
+            std::swap(degs, nextDegs);
+        }
+
+        for (uint32_t k = 0; k <= degree; k++) {
+            for (uint32_t lane = 0; lane < numLanes; lane++) {
+                out[k * outStride + lane] = cur[k * W + lane];
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t W = SUBPRODUCT_WIDTH;
+
+    // Up to 65 products of values below p fit in 64 bits before reduction
+    void mulSchoolbook(const uint32_t *A, uint32_t da, const uint32_t *B, uint32_t db, uint32_t *C) {
+        uint64_t *acc = accArena.data();
+        std::fill(acc, acc + (size_t)(da + db + 1) * W, 0);
+        for (uint32_t i = 0; i <= da; i++) {
+            const uint32_t *a = A + i * W;
+            for (uint32_t j = 0; j <= db; j++) {
+                const uint32_t *b = B + j * W;
+                uint64_t *c = acc + (i + j) * W;
+                for (uint32_t lane = 0; lane < W; lane++) {
+                    c[lane] += (uint64_t)a[lane] * b[lane];
+                }
+            }
+        }
+        for (size_t k = 0; k < (size_t)(da + db + 1) * W; k++) {
+            C[k] = NTT65537::reduce(acc[k]);
+        }
+    }
+
+    // Both factors are monic, so an NTT of size da + db suffices: the leading
+    // 1 wraps around onto x^0 and is taken back out
+    void mulNTT(const uint32_t *A, uint32_t da, const uint32_t *B, uint32_t db, uint32_t *C) {
+        uint32_t logN = 1;
+        while ((1u << logN) < da + db) logN++;
+        const NTT65537 &engine = getNTT65537(logN);
+        uint32_t n = engine.size();
+        bool isWrapped = (n == da + db);
+        uint32_t *fa = arena.data() + 2 * levelSize;
+        uint32_t *fb = fa + nttSize;
+
+        for (uint32_t lane = 0; lane < W; lane++) {
+            std::fill(fa, fa + n, 0);
+            std::fill(fb, fb + n, 0);
+            for (uint32_t i = 0; i <= da; i++) fa[i] = A[i * W + lane];
+            for (uint32_t j = 0; j <= db; j++) fb[j] = B[j * W + lane];
+
+            engine.forward(fa);
+            engine.forward(fb);
+            engine.multiplyPointwise(fa, fb, fa);
+            engine.inverse(fa);
+
+            if (isWrapped) {
+                fa[0] = fa[0] == 0 ? NTT_PRIME - 1 : fa[0] - 1;
+                C[(size_t)(da + db) * W + lane] = 1;
+            }
+            for (uint32_t k = 0; k < std::min(n, da + db + 1); k++) {
+                C[(size_t)k * W + lane] = fa[k];
+            }
+        }
+    }
+
+    uint32_t degree;
+    size_t levelSize;
+    size_t nttSize;
+    std::vector<uint32_t> arena;
+    std::vector<uint64_t> accArena;
+    std::vector<uint32_t> degs, nextDegs;
+};
+
+} // namespace
+
+void constructInterPolyBatch(
+    NTTContext &ctx,
+    const std::vector<int64_t> &roots,
+    uint32_t numLanes,
+    uint32_t degree,
+    std::vector<int64_t> &coeffs
+) {
+    if (roots.size() < (size_t)degree * numLanes) {
+        throw std::runtime_error("Too few roots for the batch interpolation");
+    }
+    if (coeffs.size() < (size_t)(degree + 1) * numLanes) {
+        coeffs.resize((size_t)(degree + 1) * numLanes);
+    }
+    if (degree == 0) {
+        std::fill(coeffs.begin(), coeffs.begin() + numLanes, 1);
+        return;
+    }
+
+    // Other primes go through the recursive construction
+    if (ctx.prime != NTT_PRIME) {
+        #pragma omp parallel for
+        for (uint32_t lane = 0; lane < numLanes; lane++) {
+            std::vector<int64_t> vals(degree);
+            for (uint32_t i = 0; i < degree; i++) {
+                vals[i] = roots[(size_t)i * numLanes + lane];
+            }
+            vals = constructInterPoly(ctx, vals);
+            for (uint32_t k = 0; k <= degree; k++) {
+                coeffs[(size_t)k * numLanes + lane] = (vals[k] % ctx.prime + ctx.prime) % ctx.prime;
+            }
+        }
+        return;
+    }
+
+    uint32_t numTiles = (numLanes + SUBPRODUCT_WIDTH - 1) / SUBPRODUCT_WIDTH;
+    #pragma omp parallel
+    {
+        SubproductTree tree(degree);
+        #pragma omp for schedule(dynamic)
+        for (uint32_t t = 0; t < numTiles; t++) {
+            uint32_t lane = t * SUBPRODUCT_WIDTH;
+            tree.build(
+                roots.data() + lane, numLanes,
+                std::min<uint32_t>(SUBPRODUCT_WIDTH, numLanes - lane),
+                coeffs.data() + lane, numLanes
+            );
+        }
+    }
+}
+
 int64_t PolyEval(
     std::vector<int64_t> coeffs,
     int64_t x,
@@ -2,7 +2,10 @@
 #define APSI_POLY_H
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
+#include "ntt.h"
 
 int64_t modInverse(int64_t a, int64_t p);
 
@@ -39,12 +42,20 @@ void PolyNTT(
     int64_t prime
 );
 
+// Uses the NTTEngine of ntt.h for p = 65537; the output is in [0, p) then
 std::vector<int64_t> PolyMultNTT(
     NTTContext &ctx,
     const std::vector<int64_t>& a, 
     const std::vector<int64_t>& b
 );
 
+// Generic path on PolyNTT, for other primes and as a reference
+std::vector<int64_t> PolyMultNTTRef(
+    NTTContext &ctx,
+    const std::vector<int64_t>& a, 
+    const std::vector<int64_t>& b
+);
+
 std::vector<int64_t> PolyMulTextBook(
     const std::vector<int64_t>& a,
     const std::vector<int64_t>& b,
@@ -63,8 +74,21 @@ std::vector<int64_t> constructInterPolyNaive (
 );
 
 std::vector<int64_t> constructInterPoly(
-    NTTContext ctx,
-    std::vector<int64_t> vals
+    NTTContext &ctx,
+    const std::vector<int64_t> &vals
+);
+
+// prod_i (x - a_i) for numLanes polynomials of `degree` roots at once.
+// roots[i * numLanes + lane] is root i of a lane, the item-major layout of
+// SimpleHashTable; coefficient k of a lane goes to coeffs[k * numLanes + lane],
+// which is the slot vector of the k-th plaintext. Rows 0..degree are written,
+// in [0, p); same polynomials as constructInterPoly.
+void constructInterPolyBatch(
+    NTTContext &ctx,
+    const std::vector<int64_t> &roots,
+    uint32_t numLanes,
+    uint32_t degree,
+    std::vector<int64_t> &coeffs
 );
 
 
@@ -1,5 +1,28 @@
 #include "APSI_receiver.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Wire Format
+void encodeAPSIQuery(std::string &buf, const APSIQuery &query) {
+    encodeCtxts(buf, query.powers);
+    putVal<uint32_t>(buf, query.pos.size());
+    for (uint32_t p : query.pos) {
+        putVal<uint32_t>(buf, p);
+    }
+}
+
+APSIQuery decodeAPSIQuery(HE &bfv, const std::string &buf, size_t &pos) {
+    APSIQuery query;
+    query.powers = decodeCtxts(bfv.getCryptoContext(), buf, pos);
+    query.pos.resize(getVal<uint32_t>(buf, pos));
+    for (auto &p : query.pos) {
+        p = getVal<uint32_t>(buf, pos);
+    }
+    return query;
+}
+
 // Query Ciphertext
 APSIQuery constructQuery(
     HE &bfv,
@@ -21,15 +44,15 @@ APSIQuery constructQuery(
         itemPowers[i] = _tmp;
     }
 
-    // Hash Positions
+    // Hash Positions; word j goes to the slot of the DB, pos + numBins * j
     uint32_t numBins = bfv.ringDim / numItems;
-    uint32_t pos = computeHash(items, 42) % numBins;
+    uint32_t pos = computeHash(items, SIMPLE_HASH_SALT) % numBins;
 
     std::vector<Ciphertext<DCRTPoly>> powers(numPowers);
     for (uint32_t i = 0; i < numPowers; i++) {
         std::vector<int64_t> _tmp(bfv.ringDim, -2);
         for (uint32_t j = 0; j < numItems; j++) {
-            _tmp[pos + j] = itemPowers[i][j];
+            _tmp[pos + numBins * j] = itemPowers[i][j];
         }
         Plaintext ptxt = bfv.packing(_tmp);
         powers[i] = bfv.encrypt(ptxt);
@@ -49,8 +72,9 @@ APSIQuery constructPSIQuery(
     // uint32_t numItems = items.size();
 
     // Hash Positions
+    // Empty bins hold -2, which is not a dummy root (-1) of the DB
     std::vector<int64_t> column = computeCuckooHashTableClient(
-        items, bfv.ringDim, -1
+        items, bfv.ringDim, -2
     );
 
     std::vector<Ciphertext<DCRTPoly>> powers(numPowers);
@@ -68,45 +92,168 @@ APSIQuery constructPSIQuery(
     return APSIQuery {powers, params.pos};
 }
 
-
-std::tuple<bool, int32_t> findConseqZeros(
-    std::vector<int64_t> items,
-    uint32_t stride
+APSIBatchQuery constructBatchQuery(
+    HE &bfv,
+    const APSIParams &params,
+    const std::vector<std::vector<int64_t>> &items,
+    uint32_t h
 ) {
-    bool isFound = false; int32_t pos = -1;
-    uint32_t numItem = items.size();
-    for (uint32_t i = 0; i < numItem; i += stride) {
-        bool _tmp = true; uint32_t offset = i * stride;
-        for (uint32_t j = 0; j < stride; j++) {
-            _tmp = _tmp && (items[offset + j] == 0);
+    uint32_t numPowers = params.pos.size();
+    uint32_t prime = bfv.prime;
+    uint32_t numBins = bfv.ringDim / params.itemLen;
+    if (items.empty() || items.size() > numBins) {
+        throw std::runtime_error(
+            "A batch holds 1 to " + std::to_string(numBins) + " items, not " + std::to_string(items.size())
+        );
+    }
+    for (auto &item : items) {
+        if (item.size() != params.itemLen) {
+            throw std::runtime_error(
+                "Item length mismatch! " + std::to_string(item.size()) + " vs " + std::to_string(params.itemLen)
+            );
         }
+    }
+
+    APSIBatchQuery ret;
+    ret.numItems = items.size();
+    std::vector<std::vector<int64_t>> stashItems;
+    std::vector<int64_t> column = computeCuckooHashTableClient(
+        items, bfv.ringDim, -2, h, &stashItems, nullptr, &ret.binItems
+    );
+    std::vector<bool> isPlaced(items.size(), false);
+    for (int32_t idx : ret.binItems) {
+        if (idx >= 0) {
+            isPlaced[idx] = true;
+        }
+    }
+    for (uint32_t i = 0; i < items.size(); i++) {
+        if (!isPlaced[i]) {
+            ret.stash.push_back(i);
+        }
+    }
+
+    // Powers of the occupied slots only; the rest keep -2
+    std::vector<Ciphertext<DCRTPoly>> powers(numPowers);
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < numPowers; i++) {
+        std::vector<int64_t> _tmp(bfv.ringDim, -2);
+        for (uint32_t b = 0; b < numBins; b++) {
+            if (ret.binItems[b] < 0) {
+                continue;
+            }
+            for (uint32_t k = 0; k < params.itemLen; k++) {
+                _tmp[b + numBins * k] = modPow(column[b + numBins * k], params.pos[i], prime);
+            }
+        }
+        Plaintext ptxt = bfv.packing(_tmp);
+        powers[i] = bfv.encrypt(ptxt);
+    }
+    ret.query = APSIQuery {powers, params.pos};
+    return ret;
+}
+
+std::vector<bool> findBatchMembership(
+    HE &bfv,
+    const APSIParams &params,
+    const APSIBatchQuery &batch,
+    const std::vector<Ciphertext<DCRTPoly>> &retCtxts
+) {
+    std::vector<bool> ret(batch.numItems, false);
+    for (auto &m : decodeIntersection(bfv, params, retCtxts, &batch.binItems)) {
+        ret[m.item] = true;
+    }
+    return ret;
+}
 
-        if (_tmp) {
-            isFound = true; pos = i;
+namespace {
+
+// Bins whose itemLen slots b + numBins * k are all zero: the words of a bin
+// are OR-ed together and the zero lanes picked out, four bins per step with AVX2
+void findZeroBins(
+    const int64_t *vals,
+    uint32_t numBins,
+    uint32_t itemLen,
+    std::vector<uint32_t> &bins
+) {
+    uint32_t b = 0;
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for (; b + 4 <= numBins; b += 4) {
+        __m256i acc = _mm256_loadu_si256((const __m256i *)(vals + b));
+        for (uint32_t k = 1; k < itemLen; k++) {
+            acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i *)(vals + b + (size_t)numBins * k)));
+        }
+        uint32_t mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(acc, zero)));
+        while (mask != 0) {
+            bins.push_back(b + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; b < numBins; b++) {
+        int64_t acc = 0;
+        for (uint32_t k = 0; k < itemLen; k++) {
+            acc |= vals[b + (size_t)numBins * k];
+        }
+        if (acc == 0) {
+            bins.push_back(b);
         }
     }
-    return std::tuple<bool, int32_t>(isFound, pos);
 }
 
+} // namespace
 
-// Find Intersection
-std::tuple<bool, int32_t, int32_t> findIntersection(
+std::vector<APSIMatch> decodeIntersection(
     HE &bfv,
-    APSIParams params,
-    std::vector<Ciphertext<DCRTPoly>> retCtxts
+    const APSIParams &params,
+    const std::vector<Ciphertext<DCRTPoly>> &retCtxts,
+    const std::vector<int32_t> *binItems
 ) {
-    uint32_t itemLen = params.itemLen;
+    uint32_t numBins = bfv.ringDim / params.itemLen;
     uint32_t numCtxts = retCtxts.size();
-    bool isFound = false;
-    int32_t pos = -1; int32_t ctxtIdx = -1;
-    for (uint32_t i = 0; i < numCtxts; i++) {
-        std::vector<int64_t> retVal = bfv.decrypt(retCtxts[i])->GetPackedValue();
-        auto _tmp = findConseqZeros(retVal, itemLen);
+    std::vector<std::vector<APSIMatch>> matches(numCtxts);
+    bool isShort = false;
 
-        if (get<0>(_tmp)) {
-            isFound = true;
-            pos = get<1>(_tmp); ctxtIdx = i;
+    #pragma omp parallel for schedule(dynamic)
+    for (uint32_t i = 0; i < numCtxts; i++) {
+        Plaintext ptxt = bfv.decrypt(retCtxts[i]);
+        const std::vector<int64_t> &retVal = ptxt->GetPackedValue();
+        if (retVal.size() < (size_t)numBins * params.itemLen) {
+            #pragma omp atomic write
+            isShort = true;
+            continue;
         }
+        std::vector<uint32_t> bins;
+        findZeroBins(retVal.data(), numBins, params.itemLen, bins);
+        for (uint32_t b : bins) {
+            int32_t item = (binItems == nullptr) ? -1 : (*binItems)[b];
+            // Empty bins of a batch carry no item
+            if (binItems != nullptr && item < 0) {
+                continue;
+            }
+            matches[i].push_back(APSIMatch {i, b, item});
+        }
+    }
+
+    if (isShort) {
+        throw std::runtime_error("Response has fewer slots than the bins");
+    }
+    std::vector<APSIMatch> ret;
+    for (auto &m : matches) {
+        ret.insert(ret.end(), m.begin(), m.end());
+    }
+    return ret;
+}
+
+// Find Intersection
+std::tuple<bool, int32_t, int32_t> findIntersection(
+    HE &bfv,
+    const APSIParams &params,
+    const std::vector<Ciphertext<DCRTPoly>> &retCtxts
+) {
+    std::vector<APSIMatch> matches = decodeIntersection(bfv, params, retCtxts);
+    if (matches.empty()) {
+        return std::tuple<bool, int32_t, int32_t>(false, -1, -1);
     }
-    return std::tuple<bool, int32_t, int32_t>(isFound, pos, ctxtIdx);
-}
\ No newline at end of file
+    return std::tuple<bool, int32_t, int32_t>(true, matches[0].bin, matches[0].chunk);
+}
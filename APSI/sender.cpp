@@ -1,14 +1,64 @@
 #include "APSI_sender.h"
 
+// Interpolates items start..end-1 of every slot of the hash table; the
+// roots are read in the item-major layout of the table
+static void interpolateChunk(
+    NTTContext &ctx,
+    const SimpleHashTable &hashTable,
+    uint32_t start,
+    uint32_t end,
+    std::vector<int64_t> &coeffs
+) {
+    uint32_t numBins = hashTable.numBins * hashTable.dimElem;
+    std::vector<int64_t> roots((size_t)(end - start) * numBins);
+
+    #pragma omp parallel for collapse(2)
+    for (uint32_t c = start; c < end; c++) {
+        for (uint32_t k = 0; k < hashTable.dimElem; k++) {
+            const int64_t *src = hashTable.data.data()
+                + ((uint64_t)k * hashTable.maxBin + c) * hashTable.numBins;
+            std::copy(
+                src, src + hashTable.numBins,
+                roots.begin() + (size_t)(c - start) * numBins + (size_t)k * hashTable.numBins
+            );
+        }
+    }
+    constructInterPolyBatch(ctx, roots, numBins, end - start, coeffs);
+}
+
+// Row j of the chunk coefficients is the slot vector of the j-th plaintext,
+// so every plaintext packs a contiguous row and the rows run in parallel.
+// With toEval, the plaintexts multiplied at query time (j >= 1) are stored in
+// the evaluation domain; the constant term is only added and stays as it is.
+static std::vector<Plaintext> packChunk(
+    HE &bfv,
+    const std::vector<int64_t> &coeffs,
+    uint32_t numBins,
+    uint32_t maxDegree,
+    bool toEval
+) {
+    std::vector<Plaintext> _payload(maxDegree + 1);
+    #pragma omp parallel for schedule(dynamic)
+    for (uint32_t j = 0; j < maxDegree + 1; j++) {
+        std::vector<int64_t> _tmp(
+            coeffs.begin() + (size_t)j * numBins,
+            coeffs.begin() + (size_t)(j + 1) * numBins
+        );
+        _payload[j] = (toEval && j > 0) ? bfv.packingEval(_tmp) : bfv.packing(_tmp);
+    }
+    return _payload;
+}
+
 APSIPtxtDB constructPtxtDB (
     HE &bfv,
-    NTTContext ctx,
-    std::vector<std::vector<int64_t>> hashTable,
+    NTTContext &ctx,
+    const SimpleHashTable &hashTable,
     uint32_t maxDegree
 ) {
     // Segment hashTable into maxDegree
-    uint32_t numBins = hashTable.size();
-    uint32_t numItemsPerBin = hashTable[0].size();
+    // Each slot (bin + numBins * word) is interpolated separately
+    uint32_t numBins = hashTable.numBins * hashTable.dimElem;
+    uint32_t numItemsPerBin = hashTable.maxBin;
     uint32_t numChunks = numItemsPerBin / maxDegree + (numItemsPerBin % maxDegree != 0);
 
     std::vector<APSIPtxtChunk> ptxtChunks(numChunks);
@@ -17,33 +67,12 @@ APSIPtxtDB constructPtxtDB (
         uint32_t start = i * maxDegree;
         uint32_t end = std::min((i + 1) * maxDegree, numItemsPerBin);
 
-        std::vector<Plaintext> _payload(maxDegree + 1);
-        std::vector<std::vector<int64_t>> _tmpMsgVec(numBins);
-        
-        // Parallel Interpolation
-        #pragma omp parallel for
-        for (uint32_t j = 0; j < numBins; j++) {
-            std::vector<int64_t> currVec(hashTable[j].begin() + start, hashTable[j].begin() + end);
-
-            // Do polynomial Interpolation
-            currVec = constructInterPoly(ctx, currVec);
+        // Coefficient j of every slot is row j, i.e. the j-th plaintext
+        std::vector<int64_t> coeffs((size_t)(maxDegree + 1) * numBins, 0);
+        interpolateChunk(ctx, hashTable, start, end, coeffs);
 
-            if (currVec.size() < maxDegree + 1) {
-                currVec.resize(maxDegree + 1, 0);
-            }
-
-            // Do Packing
-            _tmpMsgVec[j] = currVec;
-        }
         // Preparing each plaintexts
-        // #pragma omp parallel for
-        for (uint32_t j = 0; j < maxDegree + 1; j++) {
-            std::vector<int64_t> _tmp(numBins); 
-            for (uint32_t k = 0; k < numBins; k++) {
-                _tmp[k] = _tmpMsgVec[k][j];
-            }
-            _payload[j] = bfv.packing(_tmp);
-        }
+        std::vector<Plaintext> _payload = packChunk(bfv, coeffs, numBins, maxDegree, true);
         // Done!
         ptxtChunks[i] = APSIPtxtChunk { _payload, maxDegree};
     }
@@ -52,13 +81,14 @@ APSIPtxtDB constructPtxtDB (
 
 APSICtxtDB constructCtxtDB (
     HE &bfv,
-    NTTContext ctx,
-    std::vector<std::vector<int64_t>> hashTable,
+    NTTContext &ctx,
+    const SimpleHashTable &hashTable,
     uint32_t maxDegree
 ) {
     // Segment hashTable into maxDegree
-    uint32_t numBins = hashTable.size();
-    uint32_t numItemsPerBin = hashTable[0].size();
+    // Each slot (bin + numBins * word) is interpolated separately
+    uint32_t numBins = hashTable.numBins * hashTable.dimElem;
+    uint32_t numItemsPerBin = hashTable.maxBin;
     uint32_t numChunks = numItemsPerBin / maxDegree + (numItemsPerBin % maxDegree != 0);
 
     std::vector<APSICtxtChunk> ctxtChunks(numChunks);
@@ -68,45 +98,270 @@ APSICtxtDB constructCtxtDB (
         uint32_t end = std::min((i + 1) * maxDegree, numItemsPerBin);
 
         std::vector<Ciphertext<DCRTPoly>> _payload(maxDegree + 1);
-        std::vector<std::vector<int64_t>> _tmpMsgVec(numBins);
-        
-        // Parallel Interpolation
+        // Coefficient j of every slot is row j, i.e. the j-th plaintext
+        std::vector<int64_t> coeffs((size_t)(maxDegree + 1) * numBins, 0);
+        interpolateChunk(ctx, hashTable, start, end, coeffs);
+
+        // Preparing each plaintexts
+        std::vector<Plaintext> _ptxts = packChunk(bfv, coeffs, numBins, maxDegree, false);
         #pragma omp parallel for
-        for (uint32_t j = 0; j < numBins; j++) {
-            std::vector<int64_t> currVec(hashTable[j].begin() + start, hashTable[j].begin() + end);
+        for (uint32_t j = 0; j < maxDegree + 1; j++) {
+            _payload[j] = bfv.encrypt(_ptxts[j]);
+        }
+        // Done!
+        ctxtChunks[i] = APSICtxtChunk { _payload, maxDegree};
+    }
+    return APSICtxtDB { ctxtChunks, maxDegree };
+}
 
-            // Do polynomial Interpolation
-            currVec = constructInterPoly(ctx, currVec);
+APSIPtxtDBHandle shareDB(APSIPtxtDB &&DB) {
+    return std::make_shared<const APSIPtxtDB>(std::move(DB));
+}
 
-            if (currVec.size() < maxDegree + 1) {
-                currVec.resize(maxDegree + 1, 0);
+APSICtxtDBHandle shareDB(APSICtxtDB &&DB) {
+    return std::make_shared<const APSICtxtDB>(std::move(DB));
+}
+
+
+
+APSIUpdatableDB::APSIUpdatableDB(
+    HE &bfv,
+    NTTContext &ctx,
+    const SimpleHashTable &hashTable,
+    uint32_t maxDegree,
+    bool isEncrypted
+) : bfv(bfv), isEncrypted(isEncrypted), maxDegree(maxDegree) {
+    if (maxDegree == 0) {
+        throw std::runtime_error("maxDegree must be positive");
+    }
+    numSlots = hashTable.numBins * hashTable.dimElem;
+    uint32_t numChunks = std::max<uint32_t>(1, hashTable.maxBin / maxDegree + (hashTable.maxBin % maxDegree != 0));
+    uint32_t capacity = numChunks * maxDegree;
+
+    // Pad every bin with dummies up to the capacity of the chunks
+    table = SimpleHashTable {
+        hashTable.numBins, hashTable.dimElem, capacity, hashTable.actualMaxBin, hashTable.dummyVal, {}
+    };
+    table.data.assign((uint64_t)table.dimElem * capacity * table.numBins, table.dummyVal);
+    #pragma omp parallel for collapse(2)
+    for (uint32_t k = 0; k < table.dimElem; k++) {
+        for (uint32_t c = 0; c < hashTable.maxBin; c++) {
+            const int64_t *src = hashTable.data.data() + ((uint64_t)k * hashTable.maxBin + c) * table.numBins;
+            std::copy(src, src + table.numBins, &entry(k, c, 0));
+        }
+    }
+
+    load.assign(table.numBins, 0);
+    #pragma omp parallel for
+    for (uint32_t b = 0; b < table.numBins; b++) {
+        for (uint32_t c = 0; c < capacity; c++) {
+            load[b] += (entry(0, c, b) != table.dummyVal);
+        }
+    }
+
+    coeffs.resize(numChunks);
+    pending.resize(numChunks);
+    APSIPtxtDB _ptxtDB { std::vector<APSIPtxtChunk>(isEncrypted ? 0 : numChunks), maxDegree };
+    APSICtxtDB _ctxtDB { std::vector<APSICtxtChunk>(isEncrypted ? numChunks : 0), maxDegree };
+    for (uint32_t i = 0; i < numChunks; i++) {
+        coeffs[i].assign((size_t)(maxDegree + 1) * numSlots, 0);
+        interpolateChunk(ctx, table, i * maxDegree, (i + 1) * maxDegree, coeffs[i]);
+
+        std::vector<Plaintext> _ptxts = packChunk(bfv, coeffs[i], numSlots, maxDegree, !isEncrypted);
+        if (isEncrypted) {
+            std::vector<Ciphertext<DCRTPoly>> _payload(maxDegree + 1);
+            #pragma omp parallel for
+            for (uint32_t j = 0; j < maxDegree + 1; j++) {
+                _payload[j] = bfv.encrypt(_ptxts[j]);
             }
+            _ctxtDB.payload[i] = APSICtxtChunk { _payload, maxDegree };
+        } else {
+            _ptxtDB.payload[i] = APSIPtxtChunk { _ptxts, maxDegree };
+        }
+    }
+    ptxtDB = shareDB(std::move(_ptxtDB));
+    ctxtDB = shareDB(std::move(_ctxtDB));
+}
 
-            // Do Packing
-            _tmpMsgVec[j] = currVec;
+uint32_t APSIUpdatableDB::binOf(const std::vector<int64_t> &item) const {
+    if (item.size() != table.dimElem) {
+        throw std::runtime_error(
+            "Item length mismatch! " + std::to_string(item.size()) + " vs " + std::to_string(table.dimElem)
+        );
+    }
+    return computeHash(item, SIMPLE_HASH_SALT) % table.numBins;
+}
+
+// P(x) <- P(x) / (x - oldRoot) * (x - newRoot) for one slot; the division
+// runs from the top coefficient down and the product is formed on the way.
+// Throws before anything is written when oldRoot is not a root.
+std::vector<int64_t> APSIUpdatableDB::replaceRoot(
+    uint32_t chunk,
+    uint32_t slot,
+    int64_t oldRoot,
+    int64_t newRoot
+) const {
+    int64_t prime = bfv.prime;
+    const std::vector<int64_t> &co = coeffs[chunk];
+    std::vector<int64_t> col(maxDegree + 1);
+
+    int64_t a = (oldRoot % prime + prime) % prime;
+    int64_t b = (newRoot % prime + prime) % prime;
+    int64_t qHigh = 0;
+    for (int32_t j = maxDegree; j >= 0; j--) {
+        int64_t qLow = (co[(size_t)j * numSlots + slot] + a * qHigh) % prime;
+        if (j == 0 && qLow != 0) {
+            throw std::runtime_error("Root is not in the slot polynomial");
         }
-        // Preparing each plaintexts
-        // #pragma omp parallel for
-        for (uint32_t j = 0; j < maxDegree + 1; j++) {
-            std::vector<int64_t> _tmp(numBins); 
-            for (uint32_t k = 0; k < numBins; k++) {
-                _tmp[k] = _tmpMsgVec[k][j];
+        col[j] = ((j == 0 ? 0 : qLow) - b * qHigh % prime + prime) % prime;
+        qHigh = qLow;
+    }
+    return col;
+}
+
+// Keeps the coefficients of the slot as of the last flush, then overwrites them
+void APSIUpdatableDB::setSlot(uint32_t chunk, uint32_t slot, const std::vector<int64_t> &col) {
+    std::vector<int64_t> &co = coeffs[chunk];
+    if (!pending[chunk].count(slot)) {
+        std::vector<int64_t> &old = pending[chunk][slot];
+        old.resize(maxDegree + 1);
+        for (uint32_t j = 0; j <= maxDegree; j++) {
+            old[j] = co[(size_t)j * numSlots + slot];
+        }
+    }
+    for (uint32_t j = 0; j <= maxDegree; j++) {
+        co[(size_t)j * numSlots + slot] = col[j];
+    }
+}
+
+// Every word is divided out before any slot is written, so a failed update
+// leaves the DB as it was
+bool APSIUpdatableDB::insert(const std::vector<int64_t> &item) {
+    uint32_t b = binOf(item);
+    for (uint32_t c = 0; c < table.maxBin; c++) {
+        if (entry(0, c, b) != table.dummyVal) {
+            continue;
+        }
+        std::vector<std::vector<int64_t>> cols(table.dimElem);
+        for (uint32_t k = 0; k < table.dimElem; k++) {
+            cols[k] = replaceRoot(c / maxDegree, b + table.numBins * k, table.dummyVal, item[k]);
+        }
+        for (uint32_t k = 0; k < table.dimElem; k++) {
+            setSlot(c / maxDegree, b + table.numBins * k, cols[k]);
+            entry(k, c, b) = item[k];
+        }
+        load[b]++;
+        table.actualMaxBin = std::max(table.actualMaxBin, load[b]);
+        return true;
+    }
+    return false;
+}
+
+bool APSIUpdatableDB::erase(const std::vector<int64_t> &item) {
+    uint32_t b = binOf(item);
+    for (uint32_t c = 0; c < table.maxBin; c++) {
+        bool isMatch = true;
+        for (uint32_t k = 0; k < table.dimElem && isMatch; k++) {
+            isMatch = (entry(k, c, b) == item[k]);
+        }
+        if (!isMatch) {
+            continue;
+        }
+        std::vector<std::vector<int64_t>> cols(table.dimElem);
+        for (uint32_t k = 0; k < table.dimElem; k++) {
+            cols[k] = replaceRoot(c / maxDegree, b + table.numBins * k, item[k], table.dummyVal);
+        }
+        for (uint32_t k = 0; k < table.dimElem; k++) {
+            setSlot(c / maxDegree, b + table.numBins * k, cols[k]);
+            entry(k, c, b) = table.dummyVal;
+        }
+        load[b]--;
+        return true;
+    }
+    return false;
+}
+
+uint32_t APSIUpdatableDB::flush() {
+    uint32_t numFlushed = 0;
+    int64_t prime = bfv.prime;
+    // Copy-on-write: the chunks are shared pointers, so the copies are shallow
+    // and the DB of running queries is never touched
+    APSIPtxtDB nextPtxtDB = *ptxtDB;
+    APSICtxtDB nextCtxtDB = *ctxtDB;
+    for (uint32_t i = 0; i < coeffs.size(); i++) {
+        if (pending[i].empty()) {
+            continue;
+        }
+        if (!isEncrypted) {
+            nextPtxtDB.payload[i].payload = packChunk(bfv, coeffs[i], numSlots, maxDegree, true);
+        } else {
+            // Only the touched slots of a delta are nonzero
+            std::vector<Ciphertext<DCRTPoly>> &_payload = nextCtxtDB.payload[i].payload;
+            #pragma omp parallel for
+            for (uint32_t j = 0; j < maxDegree + 1; j++) {
+                std::vector<int64_t> delta(numSlots, 0);
+                bool isZero = true;
+                for (auto &it : pending[i]) {
+                    int64_t d = (coeffs[i][(size_t)j * numSlots + it.first] - it.second[j] + prime) % prime;
+                    delta[it.first] = d;
+                    isZero &= (d == 0);
+                }
+                if (!isZero) {
+                    _payload[j] = bfv.add(_payload[j], bfv.encrypt(bfv.packing(delta)));
+                }
             }
-            Plaintext _ptxt = bfv.packing(_tmp);
-            _payload[j] = bfv.encrypt(_ptxt);
         }
-        // Done!
-        ctxtChunks[i] = APSICtxtChunk { _payload, maxDegree};
+        pending[i].clear();
+        numFlushed++;
     }
-    return APSICtxtDB { ctxtChunks, maxDegree };
+    if (numFlushed > 0) {
+        ptxtDB = shareDB(std::move(nextPtxtDB));
+        ctxtDB = shareDB(std::move(nextCtxtDB));
+    }
+    return numFlushed;
+}
+
+const APSIPtxtDB &APSIUpdatableDB::getPtxtDB() const {
+    if (isEncrypted) {
+        throw std::runtime_error("The DB is encrypted");
+    }
+    return *ptxtDB;
+}
+
+const APSICtxtDB &APSIUpdatableDB::getCtxtDB() const {
+    if (!isEncrypted) {
+        throw std::runtime_error("The DB is not encrypted");
+    }
+    return *ctxtDB;
+}
+
+APSIPtxtDBHandle APSIUpdatableDB::getPtxtDBHandle() const {
+    if (isEncrypted) {
+        throw std::runtime_error("The DB is encrypted");
+    }
+    return ptxtDB;
 }
 
+APSICtxtDBHandle APSIUpdatableDB::getCtxtDBHandle() const {
+    if (!isEncrypted) {
+        throw std::runtime_error("The DB is not encrypted");
+    }
+    return ctxtDB;
+}
+
+uint64_t APSIUpdatableDB::getNumItems() const {
+    uint64_t ret = 0;
+    for (uint32_t l : load) {
+        ret += l;
+    }
+    return ret;
+}
 
 
 Ciphertext<DCRTPoly> compInterChunkPtxt(
     HE &bfv,
-    APSIPtxtChunk chunk,
-    std::vector<Ciphertext<DCRTPoly>> powers,
+    const APSIPtxtChunk &chunk,
+    const std::vector<Ciphertext<DCRTPoly>> &powers,
     uint32_t ps_low_degree
 ) {
     // Do Paterson-Stockmeyer or Not?
@@ -125,13 +380,17 @@ Ciphertext<DCRTPoly> compInterChunkPtxt(
 
 Ciphertext<DCRTPoly> compInterChunkCtxt(
     HE &bfv,
-    APSICtxtChunk chunk,
-    std::vector<Ciphertext<DCRTPoly>> powers,
+    const APSICtxtChunk &chunk,
+    const std::vector<Ciphertext<DCRTPoly>> &powers,
     uint32_t ps_low_degree
 ) {
     // Do Paterson-Stockmeyer or Not?
-    // Do Always Linear Evaluation
-    Ciphertext<DCRTPoly> ret = PolyEvalLinearCtxt(bfv, chunk.payload, powers);
+    Ciphertext<DCRTPoly> ret;
+    if (ps_low_degree == 0) {
+        ret = PolyEvalLinearCtxt(bfv, chunk.payload, powers);
+    } else {
+        ret = PolyEvalPSCtxt(bfv, chunk.payload, powers, ps_low_degree);
+    }
 
     // Random Masking
     Plaintext mask = makeRandomMask(bfv);
@@ -142,17 +401,14 @@ Ciphertext<DCRTPoly> compInterChunkCtxt(
 
 std::vector<Ciphertext<DCRTPoly>> compInterPtxt(
     HE &bfv,
-    APSIParams params,
-    APSIPtxtDB DB,
-    APSIQuery query,
+    const APSIParams &params,
+    const APSIPtxtDB &DB,
+    const APSIQuery &query,
     uint32_t remDepth
 ) {
     // Query Expansion    
     PowersDag dag;
-    std::set<uint32_t> target_powers;
-    for (uint32_t i = 1; i < params.maxBin; i++) {
-        target_powers.insert(i);
-    }
+    std::set<uint32_t> target_powers = computeTargetPowers(params, true);
     std::set<uint32_t> posSet(query.pos.begin(), query.pos.end());
     trim_sources(posSet, target_powers);
     bool isOK = dag.configure(posSet, target_powers);
@@ -183,17 +439,14 @@ std::vector<Ciphertext<DCRTPoly>> compInterPtxt(
 
 std::vector<Ciphertext<DCRTPoly>> compInterCtxt(
     HE &bfv,
-    APSIParams params,
-    APSICtxtDB DB,
-    APSIQuery query,
+    const APSIParams &params,
+    const APSICtxtDB &DB,
+    const APSIQuery &query,
     uint32_t remDepth
 ) {
     // Query Expansion    
     PowersDag dag;
-    std::set<uint32_t> target_powers;
-    for (uint32_t i = 1; i < params.maxBin; i++) {
-        target_powers.insert(i);
-    }
+    std::set<uint32_t> target_powers = computeTargetPowers(params, true);
     std::set<uint32_t> posSet(query.pos.begin(), query.pos.end());
     trim_sources(posSet, target_powers);
     bool isOK = dag.configure(posSet, target_powers);
@@ -220,6 +473,27 @@ std::vector<Ciphertext<DCRTPoly>> compInterCtxt(
     return ret;
 }
 
+std::vector<Ciphertext<DCRTPoly>> compInterPtxt(
+    HE &bfv,
+    const APSIParams &params,
+    const APSIPtxtDBHandle &DB,
+    const APSIQuery &query,
+    uint32_t remDepth
+) {
+    APSIPtxtDBHandle hold = DB;
+    return compInterPtxt(bfv, params, *hold, query, remDepth);
+}
+
+std::vector<Ciphertext<DCRTPoly>> compInterCtxt(
+    HE &bfv,
+    const APSIParams &params,
+    const APSICtxtDBHandle &DB,
+    const APSIQuery &query,
+    uint32_t remDepth
+) {
+    APSICtxtDBHandle hold = DB;
+    return compInterCtxt(bfv, params, *hold, query, remDepth);
+}
 
 std::vector<Ciphertext<DCRTPoly>> compAggResponse(
     HE &bfv,
@@ -239,4 +513,12 @@ std::vector<Ciphertext<DCRTPoly>> compAggResponse(
         ret[i] = bfv.compress(ret[i], 3);
     }
     return ret;
+}
+
+std::vector<Ciphertext<DCRTPoly>> compAggResponse(
+    HE &bfv,
+    const std::vector<std::vector<Ciphertext<DCRTPoly>>> &responses,
+    const AggTreePlan &plan
+) {
+    return runAggTree(bfv.getCryptoContext(), plan, AggOp::PRODUCT, responses);
 }
\ No newline at end of file
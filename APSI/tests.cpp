@@ -32,12 +32,43 @@ std::vector<std::vector<int64_t>> genDataAPSI(
     return ret;
 }
 
-void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
+// Prints the preset and the OpenFHE parameters it maps to
+static void printPreset(const APSIPreset &preset, HE &bfv, uint32_t depth) {
+    std::cout << "Preset: " << preset.name
+              << " | Query Powers: " << preset.params.pos.size()
+              << " | Items per Bin: " << preset.params.maxBin
+              << " | PS Low Degree: " << preset.params.ps_low_degree
+              << " | Felts per Item: " << preset.params.itemLen
+              << " | SEAL N: " << preset.polyModulusDegree
+              << " | OpenFHE N: " << bfv.ringDim
+              << " | Depth: " << depth << std::endl;
+}
+
+// Preset of the protocol tests; sourceDepth >= 0 replaces its query powers
+// by the fewest sources within that depth. The receiver uploads and the
+// sender configures its DAG from params.pos, so both sides follow.
+static APSIPreset loadTestPreset(uint32_t numItems, const std::string &paramPath, int32_t sourceDepth) {
+    APSIPreset preset = paramPath.empty()
+        ? selectAPSIPreset(numItems)
+        : loadAPSIPreset(paramPath);
+    if (sourceDepth >= 0) {
+        std::set<uint32_t> targets = computeTargetPowers(preset.params, true);
+        std::set<uint32_t> sources = optimizeSourcePowers(targets, sourceDepth);
+        preset.params.pos.assign(sources.begin(), sources.end());
+    }
+    return preset;
+}
+
+void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted, const std::string &paramPath, int32_t sourceDepth) {
     uint32_t actualNumItem = 1<<numItem;
-    uint32_t itemLen = 5;
+    APSIPreset preset = loadTestPreset(actualNumItem, paramPath, sourceDepth);
+    APSIParams params = preset.params;
+    uint32_t itemLen = params.itemLen;
     uint32_t prime = (1<<16) + 1;
     uint32_t remDepth = std::ceil(std::log2(numParties));
-    HE bfv("BFV", 65537, isEncrypted + remDepth);    
+    uint32_t depth = computeAPSIDepth(preset, isEncrypted, numParties);
+    HE bfv("BFV", 65537, depth);
+    printPreset(preset, bfv, depth);
 
     std::cout << remDepth << std::endl;
 
@@ -45,14 +76,8 @@ void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     auto msgVec = genDataAPSI(actualNumItem, itemLen, prime);
     std::cout << "Done!" << std::endl;
 
-    // Dummy Value..?
-    // Just wanted to avoid errors when generating tables.
-    uint32_t maxBin;
-    if (numItem <= 20) {
-        maxBin = 1000;    
-    } else {
-        maxBin = 1000 * (1<< (numItem - 20));
-    }
+    // Single hash function; the table is trimmed to the actual max load
+    uint32_t maxBin = computeMaxBinLoad(bfv.ringDim / itemLen, actualNumItem, preset.hashFuncCount);
     
     std::cout << maxBin << std::endl;
 
@@ -62,16 +87,8 @@ void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     );
     std::cout << "Done!" << std::endl;    
 
-    // Create Query Value
-    uint32_t numPowers = 55;
-    std::vector<uint32_t> pos(numPowers);
-    for (uint32_t i = 0; i < numPowers; i++) {
-        pos[i] = i + 1;
-    }
+    // Query powers and chunk degree come from the preset
     NTTContext ctx(bfv.prime, 3, 1<<16);
-    APSIParams params {
-        pos, 5, numPowers, 0
-    };    
 
 
 
@@ -90,8 +107,11 @@ void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
 
     if (isEncrypted) {
         std::cout << "Construct Database" << std::endl;    
-        APSICtxtDB DB = constructCtxtDB(bfv, ctx, hashTable, numPowers);
+        auto tDB1 = std::chrono::high_resolution_clock::now();
+        APSICtxtDB DB = constructCtxtDB(bfv, ctx, hashTable, params.maxBin);
+        auto tDB2 = std::chrono::high_resolution_clock::now();
         std::cout << "Done!" << std::endl;    
+        std::cout << "DB Time: " << std::chrono::duration<double>(tDB2 - tDB1).count() << std::endl;
 
         std::cout << "Compute Intersection" << std::endl;
         auto t1 = std::chrono::high_resolution_clock::now();
@@ -108,8 +128,11 @@ void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     } else {
         std::cout << "Construct Database" << std::endl;    
         NTTContext ctx(bfv.prime, 3, 1<<16);
-        APSIPtxtDB DB = constructPtxtDB(bfv, ctx, hashTable, numPowers);
-        std::cout << "Done!" << std::endl;            
+        auto tDB1 = std::chrono::high_resolution_clock::now();
+        APSIPtxtDB DB = constructPtxtDB(bfv, ctx, hashTable, params.maxBin);
+        auto tDB2 = std::chrono::high_resolution_clock::now();
+        std::cout << "Done!" << std::endl;
+        std::cout << "DB Time: " << std::chrono::duration<double>(tDB2 - tDB1).count() << std::endl;
 
 
         std::cout << "Compute Intersection for PtxtDB" << std::endl;
@@ -144,12 +167,16 @@ void testFullProtocol(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     std::cout << "Aggregated Size: " << (double)ctxtSize(retCtxt[0]) * retCtxt.size() / 1000000 << "MB" << std::endl;
 }
 
-void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
+void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted, const std::string &paramPath, int32_t sourceDepth) {
     uint32_t actualNumItem = 1<<numItem;
-    uint32_t itemLen = 8;
+    APSIPreset preset = loadTestPreset(actualNumItem, paramPath, sourceDepth);
+    APSIParams params = preset.params;
+    uint32_t itemLen = params.itemLen;
     uint32_t prime = (1<<16) + 1;
     uint32_t remDepth = std::ceil(std::log2(numParties));
-    HE bfv("BFV", 65537, isEncrypted + remDepth);    
+    uint32_t depth = computeAPSIDepth(preset, isEncrypted, numParties);
+    HE bfv("BFV", 65537, depth);
+    printPreset(preset, bfv, depth);
 
 
     uint32_t queryNum = 2048;
@@ -169,9 +196,7 @@ void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     auto queryVec = genDataAPSI(queryNum, itemLen, prime);
     std::cout << "Done!" << std::endl;
 
-    // Dummy Value..?
-    // Just wanted to avoid errors when generating tables.
-    uint32_t maxBin = getMaxBins((bfv.ringDim / itemLen), numItem);
+    uint32_t maxBin = computeMaxBinLoad(bfv.ringDim / itemLen, actualNumItem, 3);
     
     std::cout << maxBin << std::endl;
 
@@ -181,16 +206,8 @@ void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     );
     std::cout << "Done!" << std::endl;    
 
-    // Create Query Value
-    uint32_t numPowers = 55;
-    std::vector<uint32_t> pos(numPowers);
-    for (uint32_t i = 0; i < numPowers; i++) {
-        pos[i] = i + 1;
-    }
+    // Query powers and chunk degree come from the preset
     NTTContext ctx(bfv.prime, 3, 1<<16);
-    APSIParams params {
-        pos, 5, numPowers, 0
-    };    
 
     std::cout << "Construct Query" << std::endl;
     APSIQuery query = constructPSIQuery (
@@ -206,8 +223,11 @@ void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
 
     if (isEncrypted) {
         std::cout << "Construct Database" << std::endl;    
-        APSICtxtDB DB = constructCtxtDB(bfv, ctx, hashTable, numPowers);
+        auto tDB1 = std::chrono::high_resolution_clock::now();
+        APSICtxtDB DB = constructCtxtDB(bfv, ctx, hashTable, params.maxBin);
+        auto tDB2 = std::chrono::high_resolution_clock::now();
         std::cout << "Done!" << std::endl;    
+        std::cout << "DB Time: " << std::chrono::duration<double>(tDB2 - tDB1).count() << std::endl;
 
         std::cout << "Compute Intersection" << std::endl;
         auto t1 = std::chrono::high_resolution_clock::now();
@@ -224,8 +244,11 @@ void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
     } else {
         std::cout << "Construct Database" << std::endl;    
         NTTContext ctx(bfv.prime, 3, 1<<16);
-        APSIPtxtDB DB = constructPtxtDB(bfv, ctx, hashTable, numPowers);
-        std::cout << "Done!" << std::endl;            
+        auto tDB1 = std::chrono::high_resolution_clock::now();
+        APSIPtxtDB DB = constructPtxtDB(bfv, ctx, hashTable, params.maxBin);
+        auto tDB2 = std::chrono::high_resolution_clock::now();
+        std::cout << "Done!" << std::endl;
+        std::cout << "DB Time: " << std::chrono::duration<double>(tDB2 - tDB1).count() << std::endl;
 
 
         std::cout << "Compute Intersection for PtxtDB" << std::endl;
@@ -261,6 +284,172 @@ void testFullPSI(uint32_t numParties, uint32_t numItem, bool isEncrypted) {
 }
 
 
+// Membership queries of growing batches against one cuckoo-hashed DB: per-item
+// latency and query bytes. Half of every batch is in the DB; stashed items
+// go out in a further round.
+void testBatchQuery(uint32_t numItem, uint32_t maxBatch) {
+    uint32_t actualNumItem = 1 << numItem;
+    APSIPreset preset = selectAPSIPreset(actualNumItem);
+    APSIParams params = preset.params;
+    uint32_t itemLen = params.itemLen;
+    uint32_t prime = (1<<16) + 1;
+    uint32_t depth = computeAPSIDepth(preset, false, 1);
+    HE bfv("BFV", 65537, depth);
+    printPreset(preset, bfv, depth);
+
+    uint32_t numBins = bfv.ringDim / itemLen;
+    maxBatch = std::min(maxBatch, numBins / 2);
+
+    auto msgVec = genDataAPSI(actualNumItem, itemLen, prime);
+    uint32_t maxBin = computeMaxBinLoad(numBins, actualNumItem, 3);
+    auto hashTable = computeCuckooHashTableServer(msgVec, bfv.ringDim, maxBin, -1, 3);
+    NTTContext ctx(bfv.prime, 3, 1<<16);
+    auto tDB1 = std::chrono::high_resolution_clock::now();
+    APSIPtxtDBHandle DB = shareDB(constructPtxtDB(bfv, ctx, hashTable, params.maxBin));
+    auto tDB2 = std::chrono::high_resolution_clock::now();
+    std::cout << "Bins: " << numBins << " | Chunks: " << DB->payload.size() << std::endl;
+    std::cout << "DB Time: " << std::chrono::duration<double>(tDB2 - tDB1).count() << std::endl;
+
+    for (uint32_t batchSize = 1; batchSize <= maxBatch; batchSize *= 4) {
+        // Even items from the DB, odd ones fresh
+        auto items = genDataAPSI(batchSize, itemLen, prime);
+        std::vector<bool> expected(batchSize);
+        for (uint32_t i = 0; i < batchSize; i++) {
+            expected[i] = (i % 2 == 0);
+            if (expected[i]) {
+                items[i] = msgVec[(uint64_t)i * 7919 % actualNumItem];
+            }
+        }
+
+        double queryTime = 0, evalTime = 0, decodeTime = 0;
+        size_t queryBytes = 0;
+        uint32_t numRounds = 0;
+        std::vector<bool> found(batchSize, false);
+        std::vector<uint32_t> pending(batchSize);
+        for (uint32_t i = 0; i < batchSize; i++) {
+            pending[i] = i;
+        }
+        while (!pending.empty()) {
+            std::vector<std::vector<int64_t>> roundItems;
+            for (uint32_t i : pending) {
+                roundItems.push_back(items[i]);
+            }
+            auto t1 = std::chrono::high_resolution_clock::now();
+            APSIBatchQuery batch = constructBatchQuery(bfv, params, roundItems, 3);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            auto retCtxts = compInterPtxt(bfv, params, DB, batch.query, 0);
+            auto t3 = std::chrono::high_resolution_clock::now();
+            std::vector<bool> roundFound = findBatchMembership(bfv, params, batch, retCtxts);
+            auto t4 = std::chrono::high_resolution_clock::now();
+
+            std::string buf;
+            encodeAPSIQuery(buf, batch.query);
+            queryBytes += buf.size();
+            queryTime += std::chrono::duration<double>(t2 - t1).count();
+            evalTime += std::chrono::duration<double>(t3 - t2).count();
+            decodeTime += std::chrono::duration<double>(t4 - t3).count();
+            numRounds++;
+
+            for (uint32_t i = 0; i < pending.size(); i++) {
+                found[pending[i]] = roundFound[i];
+            }
+            std::vector<uint32_t> next;
+            for (uint32_t i : batch.stash) {
+                next.push_back(pending[i]);
+            }
+            pending = next;
+        }
+        if (found != expected) {
+            throw std::runtime_error("Batched membership answers are wrong");
+        }
+
+        double total = queryTime + evalTime + decodeTime;
+        std::cout << "Batch: " << batchSize
+                  << " | Rounds: " << numRounds
+                  << " | Query Time: " << queryTime
+                  << " | Eval Time: " << evalTime
+                  << " | Decode Time: " << decodeTime
+                  << " | Latency per Item: " << total / batchSize
+                  << " | Query Bytes: " << queryBytes
+                  << " | Bytes per Item: " << queryBytes / batchSize << std::endl;
+    }
+}
+
+// Receiver decode of numCtxts responses with planted zero bins: a serial
+// decrypt-and-scan loop against decodeIntersection
+void testDecode(uint32_t numCtxts) {
+    HE bfv("BFV", 65537, 1);
+    APSIParams params {{1}, 5, 1, 0};
+    uint32_t numBins = bfv.ringDim / params.itemLen;
+
+    // One or two hits per response, nonzero slots elsewhere
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int64_t> dist(1, bfv.prime - 1);
+    std::vector<std::vector<int64_t>> rawVals(numCtxts);
+    std::vector<APSIMatch> planted;
+    for (uint32_t i = 0; i < numCtxts; i++) {
+        rawVals[i].resize(bfv.ringDim);
+        for (auto &v : rawVals[i]) {
+            v = dist(gen);
+        }
+        std::vector<uint32_t> bins = {(uint32_t)(((uint64_t)i * 131) % numBins)};
+        if (i % 3 == 0) {
+            bins.push_back((bins[0] + numBins / 2) % numBins);
+            std::sort(bins.begin(), bins.end());
+        }
+        for (uint32_t b : bins) {
+            for (uint32_t k = 0; k < params.itemLen; k++) {
+                rawVals[i][b + numBins * k] = 0;
+            }
+            planted.push_back(APSIMatch {i, b, -1});
+        }
+    }
+    std::vector<Ciphertext<DCRTPoly>> retCtxts(numCtxts);
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < numCtxts; i++) {
+        retCtxts[i] = bfv.encrypt(bfv.packing(rawVals[i]));
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<APSIMatch> serial;
+    for (uint32_t i = 0; i < numCtxts; i++) {
+        std::vector<int64_t> retVal = bfv.decrypt(retCtxts[i])->GetPackedValue();
+        for (uint32_t b = 0; b < numBins; b++) {
+            bool isZero = true;
+            for (uint32_t k = 0; k < params.itemLen; k++) {
+                isZero = isZero && (retVal[b + numBins * k] == 0);
+            }
+            if (isZero) {
+                serial.push_back(APSIMatch {i, b, -1});
+            }
+        }
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::vector<APSIMatch> decoded = decodeIntersection(bfv, params, retCtxts);
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    auto isSame = [](const std::vector<APSIMatch> &a, const std::vector<APSIMatch> &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].chunk != b[i].chunk || a[i].bin != b[i].bin || a[i].item != b[i].item) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!isSame(serial, planted) || !isSame(decoded, planted)) {
+        throw std::runtime_error("Decoded matches differ from the planted ones");
+    }
+
+    double serialTime = std::chrono::duration<double>(t2 - t1).count();
+    double decodeTime = std::chrono::duration<double>(t3 - t2).count();
+    std::cout << "Responses: " << numCtxts << " | Bins: " << numBins << " | Matches: " << planted.size() << std::endl;
+    std::cout << "Serial Decode Time: " << serialTime << " (" << numCtxts / serialTime << " ctxts/s)" << std::endl;
+    std::cout << "Parallel Decode Time: " << decodeTime << " (" << numCtxts / decodeTime << " ctxts/s)" << std::endl;
+}
+
 void testFullProtocolTwoParty(int numParties) {
     uint32_t numItem = 1<<20;
     uint32_t itemLen = 5;
@@ -271,8 +460,7 @@ void testFullProtocolTwoParty(int numParties) {
     auto msgVec = genDataAPSI(numItem, itemLen, prime);
     std::cout << "Done!" << std::endl;
 
-    // Dummy Value..?
-    uint32_t maxBin = 1000;
+    uint32_t maxBin = computeMaxBinLoad(bfv.ringDim / itemLen, numItem, 1);
 
     // Create a hash table
     std::cout << "Create Hash Table..." << std::endl;
@@ -328,10 +516,12 @@ void testFullProtocolTwoParty(int numParties) {
     } else {
         std::cout << "Intersection Found!" << std::endl;
         std::vector<int64_t> retMsg = bfv.decrypt(retCtxts[get<2>(retRes)])->GetPackedValue();
-        std::cout << std::vector<int64_t>(
-            retMsg.begin() + params.itemLen * get<1>(retRes),
-            retMsg.begin() + params.itemLen * (get<1>(retRes) + 1)
-        ) << std::endl;
+        uint32_t numBins = bfv.ringDim / params.itemLen;
+        std::vector<int64_t> binVals(params.itemLen);
+        for (uint32_t k = 0; k < params.itemLen; k++) {
+            binVals[k] = retMsg[get<1>(retRes) + numBins * k];
+        }
+        std::cout << binVals << std::endl;
     }
     
 
@@ -348,8 +538,7 @@ void testSender() {
     auto msgVec = genDataAPSI(numItem, itemLen, prime);
     std::cout << "Done!" << std::endl;
 
-    // Dummy Value..?
-    uint32_t maxBin = 10000;
+    uint32_t maxBin = computeMaxBinLoad(bfv.ringDim / itemLen, numItem, 1);
 
     // Create a hash table
     std::cout << "Create Hash Table..." << std::endl;
@@ -377,8 +566,7 @@ void testHashing() {
     auto msgVec = genDataAPSI(numItem, itemLen, prime);
     std::cout << "Done!" << std::endl;
 
-    // Dummy Value..?
-    uint32_t maxBin = 1000;
+    uint32_t maxBin = computeMaxBinLoad(ringDim / itemLen, numItem, 1);
 
     // Create a hash table
     std::cout << "Create Hash Table..." << std::endl;
@@ -451,6 +639,282 @@ void testPolyOps() {
     }
 }
 
+// NTT engine against PolyNTT: numPolys transforms of size 2^logN, and the
+// products of size 2^logN behind constructInterPoly
+void testNTT(uint32_t logN, uint32_t numPolys) {
+    int64_t prime = 65537;
+    uint32_t n = 1 << logN;
+    NTTContext ctx(prime, 3, 1<<16);
+    const NTT65537 &engine = getNTT65537(logN);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int64_t> dist(0, prime - 1);
+    std::vector<std::vector<int64_t>> polys(numPolys, std::vector<int64_t>(n));
+    std::vector<uint32_t> batch((size_t)numPolys * n);
+    for (uint32_t i = 0; i < numPolys; i++) {
+        for (uint32_t j = 0; j < n; j++) {
+            polys[i][j] = dist(gen);
+            batch[(size_t)i * n + j] = polys[i][j];
+        }
+    }
+
+    // Forward transforms
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numPolys; i++) {
+        PolyNTT(polys[i], false, ctx.roots, ctx.invRoots, prime);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numPolys; i++) {
+        engine.forward(batch.data() + (size_t)i * n);
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+    // Back to the coefficients, then the OpenMP batch
+    engine.inverseBatch(batch.data(), numPolys);
+    auto t4 = std::chrono::high_resolution_clock::now();
+    engine.forwardBatch(batch.data(), numPolys);
+    auto t5 = std::chrono::high_resolution_clock::now();
+
+    // Products of two halves; both paths must agree
+    std::vector<int64_t> fa(n / 2), fb(n / 2);
+    for (uint32_t j = 0; j < n / 2; j++) {
+        fa[j] = dist(gen);
+        fb[j] = dist(gen);
+    }
+    auto t6 = std::chrono::high_resolution_clock::now();
+    std::vector<int64_t> ret1;
+    for (uint32_t i = 0; i < numPolys; i++) {
+        ret1 = PolyMultNTTRef(ctx, fa, fb);
+    }
+    auto t7 = std::chrono::high_resolution_clock::now();
+    std::vector<int64_t> ret2;
+    for (uint32_t i = 0; i < numPolys; i++) {
+        ret2 = PolyMultNTT(ctx, fa, fb);
+    }
+    auto t8 = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t j = 0; j < ret1.size(); j++) {
+        if ((ret1[j] % prime + prime) % prime != ret2[j]) {
+            throw std::runtime_error("NTT engine output does not match PolyMultNTTRef");
+        }
+    }
+
+#if defined(__AVX2__)
+    std::cout << "NTT Engine: AVX2" << std::endl;
+#else
+    std::cout << "NTT Engine: scalar" << std::endl;
+#endif
+    std::cout << "Size: 2^" << logN << " | Polys: " << numPolys << std::endl;
+    std::cout << "PolyNTT Time: " << std::chrono::duration<double>(t2 - t1).count() << std::endl;
+    std::cout << "Engine Forward Time: " << std::chrono::duration<double>(t3 - t2).count() << std::endl;
+    std::cout << "Engine Batch Forward Time: " << std::chrono::duration<double>(t5 - t4).count() << std::endl;
+    std::cout << "PolyMultNTTRef Time: " << std::chrono::duration<double>(t7 - t6).count() << std::endl;
+    std::cout << "PolyMultNTT Time: " << std::chrono::duration<double>(t8 - t7).count() << std::endl;
+}
+
+// Interpolation of a sender DB of 2^numItem items with the preset for that
+// size in a ring of 2^logRingDim slots: constructInterPoly per slot, as the
+// DB construction did, against constructInterPolyBatch
+void testInterPolyBatch(uint32_t numItem, uint32_t logRingDim) {
+    uint32_t actualNumItem = 1 << numItem;
+    uint32_t ringDim = 1 << logRingDim;
+    int64_t prime = 65537;
+    APSIPreset preset = selectAPSIPreset(actualNumItem);
+    uint32_t itemLen = preset.params.itemLen;
+    uint32_t degree = preset.params.maxBin;
+
+    auto msgVec = genDataAPSI(actualNumItem, itemLen, prime);
+    uint32_t maxBin = computeMaxBinLoad(ringDim / itemLen, actualNumItem, preset.hashFuncCount);
+    auto hashTable = computeHashTable(msgVec, ringDim, maxBin, -1);
+    NTTContext ctx(prime, 3, 1<<16);
+
+    uint32_t numRows = hashTable.numBins * hashTable.dimElem;
+    uint32_t numChunks = maxBin / degree + (maxBin % degree != 0);
+    std::cout << "Preset: " << preset.name << " | Slots: " << numRows
+              << " | Chunks: " << numChunks << " | Degree: " << degree << std::endl;
+
+    // Per slot; the first chunk is kept for the comparison
+    std::vector<std::vector<int64_t>> firstChunk(numRows);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numChunks; i++) {
+        uint32_t start = i * degree;
+        uint32_t end = std::min((i + 1) * degree, maxBin);
+        #pragma omp parallel for
+        for (uint32_t j = 0; j < numRows; j++) {
+            std::vector<int64_t> currVec(end - start);
+            for (uint32_t c = start; c < end; c++) {
+                currVec[c - start] = hashTable.at(j, c);
+            }
+            currVec = constructInterPoly(ctx, currVec);
+            if (i == 0) {
+                firstChunk[j] = currVec;
+            }
+        }
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    // Batched
+    std::vector<int64_t> coeffs, firstCoeffs;
+    for (uint32_t i = 0; i < numChunks; i++) {
+        uint32_t start = i * degree;
+        uint32_t end = std::min((i + 1) * degree, maxBin);
+        std::vector<int64_t> roots((size_t)(end - start) * numRows);
+        #pragma omp parallel for
+        for (uint32_t c = start; c < end; c++) {
+            for (uint32_t j = 0; j < numRows; j++) {
+                roots[(size_t)(c - start) * numRows + j] = hashTable.at(j, c);
+            }
+        }
+        constructInterPolyBatch(ctx, roots, numRows, end - start, coeffs);
+        if (i == 0) {
+            firstCoeffs = coeffs;
+        }
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t j = 0; j < numRows; j++) {
+        for (uint32_t k = 0; k < firstChunk[j].size(); k++) {
+            if ((firstChunk[j][k] % prime + prime) % prime != firstCoeffs[(size_t)k * numRows + j]) {
+                throw std::runtime_error("Batched interpolation does not match constructInterPoly");
+            }
+        }
+    }
+    std::cout << "Per-Slot Interpolation Time: " << std::chrono::duration<double>(t2 - t1).count() << std::endl;
+    std::cout << "Batched Interpolation Time: " << std::chrono::duration<double>(t3 - t2).count() << std::endl;
+}
+
+// DB plaintexts: serial packing against parallel packing into the evaluation
+// domain, then the products of one query ciphertext with either set
+void testPtxtEncoding(uint32_t numPtxts) {
+    HE bfv("BFV", 65537, 3);
+    auto rows = genDataAPSI(numPtxts, bfv.ringDim, bfv.prime);
+    std::vector<Plaintext> ptCoef(numPtxts), ptEval(numPtxts);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numPtxts; i++) {
+        ptCoef[i] = bfv.packing(rows[i]);
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for schedule(dynamic)
+    for (uint32_t i = 0; i < numPtxts; i++) {
+        ptEval[i] = bfv.packingEval(rows[i]);
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    std::vector<int64_t> x(bfv.ringDim, 5);
+    auto ct = bfv.encrypt(bfv.packing(x));
+    std::vector<Ciphertext<DCRTPoly>> outCoef(numPtxts), outEval(numPtxts);
+    auto t4 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numPtxts; i++) {
+        outCoef[i] = bfv.mult(ct, ptCoef[i]);
+    }
+    auto t5 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numPtxts; i++) {
+        outEval[i] = bfv.mult(ct, ptEval[i]);
+    }
+    auto t6 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Plaintexts: " << numPtxts << " | Slots: " << bfv.ringDim << std::endl;
+    std::cout << "Serial Packing Time: " << std::chrono::duration<double>(t2 - t1).count() << std::endl;
+    std::cout << "Parallel Eval-Domain Packing Time: " << std::chrono::duration<double>(t3 - t2).count() << std::endl;
+    std::cout << "Mult Time per Ptxt (coefficient): " << std::chrono::duration<double>(t5 - t4).count() / numPtxts << std::endl;
+    std::cout << "Mult Time per Ptxt (evaluation): " << std::chrono::duration<double>(t6 - t5).count() / numPtxts << std::endl;
+
+    auto decCoef = bfv.decrypt(outCoef[0])->GetPackedValue();
+    auto decEval = bfv.decrypt(outEval[0])->GetPackedValue();
+    for (uint32_t j = 0; j < bfv.ringDim; j++) {
+        int64_t expected = rows[0][j] * 5 % bfv.prime;
+        if ((decCoef[j] + bfv.prime) % bfv.prime != expected || (decEval[j] + bfv.prime) % bfv.prime != expected) {
+            throw std::runtime_error("Products with the pre-encoded plaintexts do not match");
+        }
+    }
+    std::cout << "Products Match: 1" << std::endl;
+}
+
+// Incremental updates of a DB of 2^numItem items: numUpdates deletes and
+// numUpdates inserts, against rebuilding the DB from the updated table.
+// The inserted items must be found and the deleted ones must not.
+void testDBUpdate(uint32_t numItem, uint32_t numUpdates, bool isEncrypted) {
+    uint32_t actualNumItem = 1 << numItem;
+    if (numUpdates > actualNumItem) {
+        throw std::runtime_error("More updates than items");
+    }
+    APSIPreset preset = selectAPSIPreset(actualNumItem);
+    APSIParams params = preset.params;
+    uint32_t itemLen = params.itemLen;
+    uint32_t prime = (1<<16) + 1;
+    uint32_t depth = computeAPSIDepth(preset, isEncrypted, 1);
+    HE bfv("BFV", 65537, depth);
+    printPreset(preset, bfv, depth);
+
+    auto msgVec = genDataAPSI(actualNumItem, itemLen, prime);
+    auto newVec = genDataAPSI(numUpdates, itemLen, prime);
+    uint32_t maxBin = computeMaxBinLoad(bfv.ringDim / itemLen, actualNumItem, preset.hashFuncCount);
+    auto hashTable = computeHashTable(msgVec, bfv.ringDim, maxBin, -1);
+    NTTContext ctx(bfv.prime, 3, 1<<16);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    APSIUpdatableDB DB(bfv, ctx, hashTable, params.maxBin, isEncrypted);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::cout << "Chunks: " << DB.getNumChunks() << " | Items: " << DB.getNumItems() << std::endl;
+    std::cout << "Build Time: " << std::chrono::duration<double>(t2 - t1).count() << std::endl;
+
+    // Updates
+    auto t3 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < numUpdates; i++) {
+        if (!DB.erase(msgVec[i])) {
+            throw std::runtime_error("Erase: item not found");
+        }
+        if (!DB.insert(newVec[i])) {
+            throw std::runtime_error("Insert: bin is full");
+        }
+    }
+    auto t4 = std::chrono::high_resolution_clock::now();
+    // Handles taken before the flush keep the previous DB
+    APSIPtxtDBHandle oldPtxtDB = isEncrypted ? nullptr : DB.getPtxtDBHandle();
+    APSICtxtDBHandle oldCtxtDB = isEncrypted ? DB.getCtxtDBHandle() : nullptr;
+    uint32_t numFlushed = DB.flush();
+    auto t5 = std::chrono::high_resolution_clock::now();
+    double updateTime = std::chrono::duration<double>(t4 - t3).count();
+    std::cout << "Update Time per Item: " << updateTime / (2 * numUpdates) << std::endl;
+    std::cout << "Flush Time (" << numFlushed << " chunks): " << std::chrono::duration<double>(t5 - t4).count() << std::endl;
+
+    // Rebuild from the updated table; the coefficients must match
+    auto t6 = std::chrono::high_resolution_clock::now();
+    APSIUpdatableDB rebuilt(bfv, ctx, DB.getHashTable(), params.maxBin, isEncrypted);
+    auto t7 = std::chrono::high_resolution_clock::now();
+    std::cout << "Rebuild Time: " << std::chrono::duration<double>(t7 - t6).count() << std::endl;
+    for (uint32_t i = 0; i < DB.getNumChunks(); i++) {
+        if (DB.getCoeffs(i) != rebuilt.getCoeffs(i)) {
+            throw std::runtime_error("Updated coefficients do not match the rebuild");
+        }
+    }
+
+    // Concurrent queries on the shared DBs: the inserted and the deleted item
+    // against the updated DB, and the deleted one against the old DB
+    std::vector<APSIQuery> queries = {
+        constructQuery(bfv, params, newVec[0]),
+        constructQuery(bfv, params, msgVec[0]),
+        constructQuery(bfv, params, msgVec[0])
+    };
+    std::vector<std::string> labels = {"Inserted", "Deleted", "Deleted (old DB)"};
+    std::vector<bool> expected = {true, false, true};
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> retCtxts(queries.size());
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < queries.size(); i++) {
+        bool isOld = (i == 2);
+        retCtxts[i] = isEncrypted
+            ? compInterCtxt(bfv, params, isOld ? oldCtxtDB : DB.getCtxtDBHandle(), queries[i], 1)
+            : compInterPtxt(bfv, params, isOld ? oldPtxtDB : DB.getPtxtDBHandle(), queries[i], 1);
+    }
+    for (uint32_t i = 0; i < queries.size(); i++) {
+        auto retRes = findIntersection(bfv, params, retCtxts[i]);
+        std::cout << labels[i] << " Item Found: " << get<0>(retRes) << std::endl;
+        if (get<0>(retRes) != expected[i]) {
+            throw std::runtime_error("Membership after the update is wrong");
+        }
+    }
+}
+
 void testPolyEvals() {
     HE bfv("BFV", 65537, 3);
     {
@@ -520,6 +984,184 @@ void testPolyEvals() {
         }
         std::cout << "Output from Raw Data: " << outFromRaw << std::endl;
     }
+
+    {
+        std::cout << "TEST on PolyEvalPSCtxt" << std::endl;
+        int64_t x = 5;
+        uint32_t degree = 12;
+        std::vector<Ciphertext<DCRTPoly>> powers(degree);
+        for (uint32_t i = 0; i < degree; i++) {
+            int64_t currVal = modPow(x, i+1, 65537);
+            std::vector<int64_t> _tmp(bfv.ringDim, currVal);
+            Plaintext _ptxt = bfv.packing(_tmp);
+            powers[i] = bfv.encrypt(_ptxt);
+        }
+        std::vector<Ciphertext<DCRTPoly>> coeffs(degree + 1);
+        std::vector<int64_t> rawCoeffs(degree + 1);
+        for (uint32_t i = 0; i < degree + 1; i++) {
+            rawCoeffs[i] = (i+42) % 65537;
+            std::vector<int64_t> _tmp(bfv.ringDim, rawCoeffs[i]);
+            coeffs[i] = bfv.encrypt(bfv.packing(_tmp));
+        }
+        // 12 % 4 == 0 ends with a block of a single constant term
+        for (uint32_t lowDeg : {3, 4}) {
+            auto ret = PolyEvalPSCtxt(bfv, coeffs, powers, lowDeg);
+            std::vector<int64_t> retMsg = bfv.decrypt(ret)->GetPackedValue();
+            std::cout << "Output (low degree " << lowDeg << "): " << std::endl;
+            std::cout << std::vector<int64_t>(retMsg.begin(), retMsg.begin() + 10) << std::endl;
+        }
+        int64_t outFromRaw = rawCoeffs[0];
+        for (uint i = 0; i < degree; i++) {
+            outFromRaw = (outFromRaw + rawCoeffs[i+1] * modPow(5, i+1, 65537) ) % 65537;
+        }
+        std::cout << "Output from Raw Data: " << outFromRaw << std::endl;
+    }
+}
+
+// One chunk of an encrypted DB, linear against Paterson-Stockmeyer, at the
+// degree and low degree of a preset (the first one using PS by default)
+void testPolyEvalCtxt(const std::string &paramPath) {
+    std::vector<APSIPreset> presets = loadAPSIPresets();
+    std::cout << "Per-chunk cost of the encrypted DB" << std::endl;
+    for (auto &preset : presets) {
+        uint32_t degree = preset.params.maxBin;
+        uint32_t lowDeg = preset.params.ps_low_degree;
+        PolyEvalCost lin = polyEvalCtxtCost(degree, 0);
+        PolyEvalCost ps = polyEvalCtxtCost(degree, lowDeg);
+        std::cout << preset.name << " | Degree: " << degree
+                  << " | Low Degree: " << lowDeg
+                  << " | Linear ct-ct/relin/powers: " << lin.ctxtMults << "/" << lin.relins << "/" << lin.numPowers
+                  << " | PS ct-ct/relin/powers: " << ps.ctxtMults << "/" << ps.relins << "/" << ps.numPowers
+                  << std::endl;
+    }
+
+    APSIPreset preset;
+    if (!paramPath.empty()) {
+        preset = loadAPSIPreset(paramPath);
+    } else {
+        auto it = std::find_if(presets.begin(), presets.end(), [](const APSIPreset &p) {
+            return p.params.ps_low_degree > 0;
+        });
+        if (it == presets.end()) {
+            throw std::runtime_error("No preset uses Paterson-Stockmeyer");
+        }
+        preset = *it;
+    }
+    uint32_t degree = preset.params.maxBin;
+    uint32_t lowDeg = preset.params.ps_low_degree;
+    if (lowDeg == 0) {
+        throw std::runtime_error(preset.name + " does not use Paterson-Stockmeyer");
+    }
+
+    // Fresh powers; only the chunk evaluation is measured
+    HE bfv("BFV", 65537, 2);
+    int64_t x = 5;
+    std::vector<Ciphertext<DCRTPoly>> powers(degree);
+    std::vector<int64_t> rawPowers(degree);
+    for (uint32_t i = 0; i < degree; i++) {
+        rawPowers[i] = modPow(x, i+1, 65537);
+        std::vector<int64_t> _tmp(bfv.ringDim, rawPowers[i]);
+        powers[i] = bfv.encrypt(bfv.packing(_tmp));
+    }
+    std::vector<Ciphertext<DCRTPoly>> coeffs(degree + 1);
+    int64_t outFromRaw = 0;
+    for (uint32_t i = 0; i < degree + 1; i++) {
+        int64_t rawCoeff = (i * 7 + 42) % 65537;
+        std::vector<int64_t> _tmp(bfv.ringDim, rawCoeff);
+        coeffs[i] = bfv.encrypt(bfv.packing(_tmp));
+        outFromRaw = (outFromRaw + rawCoeff * (i == 0 ? 1 : rawPowers[i-1])) % 65537;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto retLin = PolyEvalLinearCtxt(bfv, coeffs, powers);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto retPS = PolyEvalPSCtxt(bfv, coeffs, powers, lowDeg);
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    int64_t outLin = bfv.decrypt(retLin)->GetPackedValue()[0];
+    int64_t outPS = bfv.decrypt(retPS)->GetPackedValue()[0];
+    outLin = (outLin + 65537) % 65537;
+    outPS = (outPS + 65537) % 65537;
+
+    std::cout << "Preset: " << preset.name << std::endl;
+    std::cout << "Linear Eval Time: " << std::chrono::duration<double>(t2 - t1).count() << std::endl;
+    std::cout << "PS Eval Time: " << std::chrono::duration<double>(t3 - t2).count() << std::endl;
+    std::cout << "Outputs (linear, PS, raw): " << outLin << ", " << outPS << ", " << outFromRaw << std::endl;
+    if (outLin != outFromRaw || outPS != outFromRaw) {
+        throw std::runtime_error("Paterson-Stockmeyer output does not match");
+    }
+}
+
+// Upload size against server depth: the fewest query powers for every depth
+// budget of the powers DAG, for one preset or all of them. outPath saves the
+// preset optimized for maxDepth.
+void testSourcePowers(const std::string &paramPath, uint32_t maxDepth, const std::string &outPath) {
+    std::vector<APSIPreset> presets;
+    if (paramPath.empty()) {
+        presets = loadAPSIPresets();
+    } else {
+        presets.push_back(loadAPSIPreset(paramPath));
+    }
+    if (!outPath.empty() && presets.size() != 1) {
+        throw std::runtime_error("-out needs a single preset");
+    }
+
+    // Fresh ciphertext size per total depth; one context each
+    std::map<uint32_t, size_t> ctSizes;
+    auto ctSizeAt = [&ctSizes](uint32_t depth) {
+        if (!ctSizes.count(depth)) {
+            HE bfv("BFV", 65537, depth);
+            auto ct = bfv.encrypt(bfv.packing({1}));
+            ctSizes[depth] = ctxtSize(ct);
+        }
+        return ctSizes[depth];
+    };
+
+    for (auto &preset : presets) {
+        std::set<uint32_t> targets = computeTargetPowers(preset.params, true);
+        std::cout << "Preset: " << preset.name
+                  << " | Targets: " << targets.size()
+                  << " | PS Low Degree: " << preset.params.ps_low_degree << std::endl;
+
+        auto report = [&](const std::string &label, const APSIPreset &p, double searchTime) {
+            std::set<uint32_t> sources(p.params.pos.begin(), p.params.pos.end());
+            uint32_t srcDepth = computeSourceDepth(sources, targets);
+            PowersDag dag;
+            if (srcDepth == SOURCE_DEPTH_UNREACHABLE || !dag.configure(sources, targets)
+                || dag.depth() != srcDepth) {
+                throw std::runtime_error(label + ": sources do not match the powers DAG");
+            }
+            uint32_t depth = computeAPSIDepth(p, false, 1);
+            size_t upload = ctSizeAt(depth) * sources.size();
+            std::cout << "  " << label
+                      << " | Sources: " << sources.size()
+                      << " | DAG Depth: " << srcDepth
+                      << " | Total Depth: " << depth
+                      << " | Mults: " << targets.size() - sources.size()
+                      << " | Upload: " << (double)upload / 1000000 << "MB"
+                      << " | Search Time: " << searchTime << std::endl;
+        };
+
+        report("preset", preset, 0);
+        for (uint32_t d = 1; d <= maxDepth; d++) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            std::set<uint32_t> sources = optimizeSourcePowers(targets, d);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            APSIPreset optimized = preset;
+            optimized.params.pos.assign(sources.begin(), sources.end());
+            report("budget " + std::to_string(d), optimized, std::chrono::duration<double>(t2 - t1).count());
+
+            if (d == maxDepth && !outPath.empty()) {
+                saveAPSIPreset(optimized, outPath);
+                // Round trip through the loader
+                APSIPreset loaded = loadAPSIPreset(outPath);
+                if (loaded.params.pos != optimized.params.pos) {
+                    throw std::runtime_error("Saved preset does not load back");
+                }
+                std::cout << "Saved " << outPath << std::endl;
+            }
+        }
+    }
 }
 
 void testIntersectionPoly() {
@@ -3,9 +3,9 @@
 // DO-PMT
 // Process Query
 
-Ciphertext<DCRTPoly> queryCompress(
+std::vector<int64_t> packQuery(
     FHECTX &ctx,
-    std::vector<int64_t> data
+    const std::vector<int64_t> &data
 ) {
     uint32_t k = data.size();
     std::vector<int64_t> msgVec(ctx.ringDim);
@@ -15,21 +15,137 @@ Ciphertext<DCRTPoly> queryCompress(
     for (uint32_t i = 0; i < ctx.ringDim; i++) {
         msgVec[i] = data[i/numOnes];
     }
-    Plaintext ptxt = ctx.cc->MakePackedPlaintext(msgVec);
-    return ctx.cc->Encrypt(ptxt, ctx.sk);
+    return msgVec;
+}
+
+Ciphertext<DCRTPoly> queryCompress(
+    FHECTX &ctx,
+    std::vector<int64_t> data
+) {
+    Plaintext ptxt = ctx.cc->MakePackedPlaintext(packQuery(ctx, data));
+    return encryptPtxt(ctx, ptxt);
+}
+
+std::vector<int64_t> packQueryMulti(
+    FHECTX &ctx,
+    const std::vector<std::vector<int64_t>> &data
+) {
+    uint32_t m = data.size();
+    uint32_t k = data[0].size();
+    if ((m & (m - 1)) != 0 || m * k > ctx.ringDim) {
+        throw std::runtime_error("The number of items must be a power of two with m * k <= ringDim");
+    }
+    std::vector<int64_t> msgVec(ctx.ringDim);
+    uint32_t numOnes = ctx.ringDim / k;
+
+    // Interleave the items inside every block
+    for (uint32_t i = 0; i < ctx.ringDim; i++) {
+        msgVec[i] = data[i % m][i/numOnes];
+    }
+    return msgVec;
+}
+
+Ciphertext<DCRTPoly> queryCompressMulti(
+    FHECTX &ctx,
+    const std::vector<std::vector<int64_t>> &data
+) {
+    Plaintext ptxt = ctx.cc->MakePackedPlaintext(packQueryMulti(ctx, data));
+    return encryptPtxt(ctx, ptxt);
 }
 
 
 // DO-PSI
 Ciphertext<DCRTPoly> queryCompressTable(
     FHECTX &ctx,
-    std::vector<std::vector<int64_t>> data
+    std::vector<std::vector<int64_t>> data,
+    const PermHashParams *perm,
+    std::vector<int64_t> *slots
 ) {
     // Make Hash Table; this it just a compressed table!
-    std::vector<int64_t> msgVec = computeCuckooHashTableClient(
-        data, ctx.ringDim, -1
-    );
+    std::vector<int64_t> msgVec = (perm == nullptr)
+        ? computeCuckooHashTableClient(data, ctx.ringDim, -1)
+        : computeCuckooHashTableClientPerm(data, ctx.ringDim, -1, *perm);
+    if (slots != nullptr) {
+        *slots = msgVec;
+    }
 
     Plaintext ptxt = ctx.cc->MakePackedPlaintext(msgVec);
-    return ctx.cc->Encrypt(ptxt, ctx.sk);
+    return encryptPtxt(ctx, ptxt);
+}
+
+
+// Replicated Query
+std::vector<Ciphertext<DCRTPoly>> queryReplicate(
+    FHECTX &ctx,
+    const std::vector<int64_t> &msgVec,
+    uint32_t k,
+    std::vector<CtxtSeed> *seeds
+) {
+    if (k == 0 || (k & (k - 1)) != 0 || k > ctx.ringDim || msgVec.size() != ctx.ringDim) {
+        throw std::runtime_error("Replication needs a full slot vector and a power-of-two k");
+    }
+    uint32_t numOnes = ctx.ringDim / k;
+    if (seeds != nullptr) {
+        seeds->resize(k);
+        for (auto &seed : *seeds) {
+            seed = makeSeed();
+        }
+    }
+
+    // Same slots as queryExtract: block j repeated over the whole vector
+    std::vector<Ciphertext<DCRTPoly>> ret(k);
+    #pragma omp parallel for
+    for (uint32_t j = 0; j < k; j++) {
+        std::vector<int64_t> extVec(ctx.ringDim);
+        for (uint32_t x = 0; x < ctx.ringDim; x++) {
+            extVec[x] = msgVec[(x % numOnes) + j * numOnes];
+        }
+        Plaintext ptxt = ctx.cc->MakePackedPlaintext(extVec);
+        ret[j] = (seeds != nullptr)
+            ? encryptSeeded(ctx, ptxt, (*seeds)[j])
+            : encryptPtxt(ctx, ptxt);
+    }
+    return ret;
+}
+
+std::string queryModeName(QueryMode mode) {
+    switch (mode) {
+        case QueryMode::PACKED: return "packed";
+        case QueryMode::REPLICATED: return "replicated";
+        case QueryMode::SEEDED: return "seeded";
+    }
+    return "unknown";
+}
+
+QueryMode chooseQueryMode(
+    const QueryCostModel &model,
+    uint32_t k,
+    size_t ctxtBytes,
+    bool hasSecretKey
+) {
+    if (k <= 1) {
+        return QueryMode::PACKED;
+    }
+    // Extraction: one mask and log2(k) rotations per block, over the workers
+    uint32_t logK = 0;
+    while ((1U << logK) < k) {
+        logK++;
+    }
+    uint32_t numWorkers = std::max<uint32_t>(1, std::min(k, model.numThreads));
+    double extractTime = k * (model.ptMultTime + logK * model.rotTime) / numWorkers;
+
+    // Upload on top of the packed query; a seeded query sends c0 only
+    double replTime = (double)(k - 1) * ctxtBytes / model.bandwidth;
+    double seededTime = ((double)k / 2 - 1) * ctxtBytes / model.bandwidth;
+
+    QueryMode best = QueryMode::PACKED;
+    double bestTime = extractTime;
+    if (hasSecretKey && seededTime < bestTime) {
+        best = QueryMode::SEEDED;
+        bestTime = seededTime;
+    }
+    if (!hasSecretKey && replTime < bestTime) {
+        best = QueryMode::REPLICATED;
+    }
+    return best;
 }
\ No newline at end of file
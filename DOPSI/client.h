@@ -3,14 +3,74 @@
 
 #include "header.h"
 
+// Slot vectors of queryCompress and queryCompressMulti
+std::vector<int64_t> packQuery(
+    FHECTX &ctx,
+    const std::vector<int64_t> &data
+);
+
+std::vector<int64_t> packQueryMulti(
+    FHECTX &ctx,
+    const std::vector<std::vector<int64_t>> &data
+);
+
 Ciphertext<DCRTPoly> queryCompress(
     FHECTX &ctx,
     std::vector<int64_t> data
 );
 
+// Packs m = data.size() items (a power of two) into one query: word j of
+// item g sits in every slot i of block j with i % m == g. The DB must be
+// built with numPack = m; the answer for item g is in slot g.
+Ciphertext<DCRTPoly> queryCompressMulti(
+    FHECTX &ctx,
+    const std::vector<std::vector<int64_t>> &data
+);
+
+// perm enables permutation-based hashing; it should match the server's.
+// slots receives the plaintext table, which the client needs to read the result.
 Ciphertext<DCRTPoly> queryCompressTable(
     FHECTX &ctx,
-    std::vector<std::vector<int64_t>> data
+    std::vector<std::vector<int64_t>> data,
+    const PermHashParams *perm = nullptr,
+    std::vector<int64_t> *slots = nullptr
+);
+
+// Replicated query: the client encrypts the k ciphertexts that queryExtract
+// would produce from the packed slot vector msgVec, so the server skips the
+// extraction. With seeds, the ciphertexts are seeded (core/seeded.h) and
+// seeds receives one seed per ciphertext; this needs the secret key.
+std::vector<Ciphertext<DCRTPoly>> queryReplicate(
+    FHECTX &ctx,
+    const std::vector<int64_t> &msgVec,
+    uint32_t k,
+    std::vector<CtxtSeed> *seeds = nullptr
+);
+
+enum class QueryMode {
+    PACKED,       // one ciphertext, extracted by every data owner
+    REPLICATED,   // k ciphertexts
+    SEEDED        // k seeded ciphertexts, about half the size each
+};
+
+std::string queryModeName(QueryMode mode);
+
+// Measured costs for chooseQueryMode
+struct QueryCostModel {
+    double bandwidth;     // client upload, bytes per second
+    double ptMultTime;    // seconds per plaintext multiplication
+    double rotTime;       // seconds per rotation
+    uint32_t numThreads;  // server workers for the extraction
+};
+
+// Picks the mode with the smallest upload + extraction time for k blocks and
+// a packed query of ctxtBytes; SEEDED is only chosen with the secret key,
+// REPLICATED only without it (threshold setup).
+QueryMode chooseQueryMode(
+    const QueryCostModel &model,
+    uint32_t k,
+    size_t ctxtBytes,
+    bool hasSecretKey
 );
 
 #endif
\ No newline at end of file
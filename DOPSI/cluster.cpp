@@ -0,0 +1,580 @@
+#include "cluster.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "key/key-ser.h"
+#include "scheme/bfvrns/bfvrns-ser.h"
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Framing
+namespace {
+
+void writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Socket write failed: " + std::string(std::strerror(errno)));
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void readAll(int fd, char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error("Socket read failed: " + std::string(std::strerror(errno)));
+        }
+        if (n == 0) {
+            throw std::runtime_error("Peer closed the socket");
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+double cpuSec() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+        + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+double elapsedSec(std::chrono::high_resolution_clock::time_point t1) {
+    auto t2 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(t2-t1).count();
+}
+
+// Response frame: u32 count, count x (u32 partyId, DOPSIPartyStats), then a
+// DO-PMT response; owners send one party, tree nodes the parties below them.
+typedef std::vector<std::pair<uint32_t, DOPSIPartyStats>> PartyList;
+
+std::string makeResponseFrame(const PartyList &parties, const DOPMTServerResponse &response) {
+    std::string msg;
+    putVal<uint32_t>(msg, parties.size());
+    for (auto &party : parties) {
+        putVal(msg, party.first);
+        putVal(msg, party.second);
+    }
+    encodeDOPMTResponse(msg, response);
+    return msg;
+}
+
+// Accepts numFrames response frames on listenFd and folds them into agg;
+// one task per frame. Returns the parties carried by the frames.
+PartyList collectResponses(
+    FHECTX &ctx,
+    uint32_t numFrames,
+    int listenFd,
+    StreamingAggregator &agg,
+    uint64_t &bytesIn,
+    std::chrono::high_resolution_clock::time_point &lastArrival
+) {
+    PartyList parties;
+    std::mutex statLock;
+    std::string errMsg;
+    bytesIn = 0;
+    lastArrival = std::chrono::high_resolution_clock::now();
+
+    // Responses are accepted in arrival order and folded in by tasks
+    #pragma omp parallel
+    #pragma omp single
+    for (uint32_t i = 0; i < numFrames; i++) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            std::lock_guard<std::mutex> guard(statLock);
+            errMsg = "Accept failed: " + std::string(std::strerror(errno));
+            break;
+        }
+
+        #pragma omp task firstprivate(fd)
+        {
+            try {
+                std::string msg = recvFrame(fd);
+                close(fd);
+                auto arrival = std::chrono::high_resolution_clock::now();
+
+                size_t pos = 0;
+                uint32_t count = getVal<uint32_t>(msg, pos);
+                PartyList frameParties(count);
+                for (auto &party : frameParties) {
+                    party.first = getVal<uint32_t>(msg, pos);
+                    party.second = getVal<DOPSIPartyStats>(msg, pos);
+                    // First hop: the owner's own frame
+                    if (count == 1 && party.second.responseBytes == 0) {
+                        party.second.responseBytes = msg.size() + sizeof(uint64_t);
+                    }
+                }
+                DOPMTServerResponse response = decodeDOPMTResponse(ctx, msg, pos);
+                {
+                    std::lock_guard<std::mutex> guard(statLock);
+                    parties.insert(parties.end(), frameParties.begin(), frameParties.end());
+                    bytesIn += msg.size() + sizeof(uint64_t);
+                    if (arrival > lastArrival) {
+                        lastArrival = arrival;
+                    }
+                }
+                agg.add(response.vafOutput, response.maskCtxt);
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> guard(statLock);
+                errMsg = e.what();
+            }
+        }
+    }
+    if (!errMsg.empty()) {
+        throw std::runtime_error(errMsg);
+    }
+    return parties;
+}
+
+} // namespace
+
+void sendFrame(int fd, const std::string &buf) {
+    uint64_t len = buf.size();
+    writeAll(fd, reinterpret_cast<const char *>(&len), sizeof(len));
+    writeAll(fd, buf.data(), buf.size());
+}
+
+std::string recvFrame(int fd) {
+    uint64_t len;
+    readAll(fd, reinterpret_cast<char *>(&len), sizeof(len));
+    std::string buf(len, '\0');
+    readAll(fd, &buf[0], len);
+    return buf;
+}
+
+// Serialization
+std::string serializeCtxt(const Ciphertext<DCRTPoly> &ctxt) {
+    std::ostringstream os;
+    Serial::Serialize(ctxt, os, SerType::BINARY);
+    return os.str();
+}
+
+Ciphertext<DCRTPoly> deserializeCtxt(const std::string &buf) {
+    std::istringstream is(buf);
+    Ciphertext<DCRTPoly> ctxt;
+    Serial::Deserialize(ctxt, is, SerType::BINARY);
+    return ctxt;
+}
+
+// Sockets
+int makeListenSocket(const std::string &path, uint32_t backlog) {
+    struct sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create a socket");
+    }
+    unlink(path.c_str());
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        throw std::runtime_error("Cannot listen on " + path + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+int connectSocket(const std::string &path) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // The leader's backlog may be full while many owners finish at once
+    for (uint32_t attempt = 0; attempt < 1000; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create a socket");
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            return fd;
+        }
+        int err = errno;
+        close(fd);
+        if (err != EAGAIN && err != ECONNREFUSED && err != EINTR) {
+            throw std::runtime_error("Cannot connect to " + path + ": " + std::strerror(err));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    throw std::runtime_error("Timed out connecting to " + path);
+}
+
+void raiseFdLimit(uint64_t numFds) {
+    struct rlimit lim;
+    getrlimit(RLIMIT_NOFILE, &lim);
+    if (lim.rlim_cur >= numFds) {
+        return;
+    }
+    if (lim.rlim_max != RLIM_INFINITY && lim.rlim_max < numFds) {
+        throw std::runtime_error("Open-file limit too low for " + std::to_string(numFds) + " descriptors");
+    }
+    lim.rlim_cur = numFds;
+    if (setrlimit(RLIMIT_NOFILE, &lim) < 0) {
+        throw std::runtime_error("Cannot raise the open-file limit");
+    }
+}
+
+// Crypto context file: context, public key, then every evaluation key
+void saveClusterContext(FHECTX &ctx, const std::string &path) {
+    std::ofstream os(path, std::ios::binary);
+    if (!os) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    Serial::Serialize(ctx.cc, os, SerType::BINARY);
+    Serial::Serialize(ctx.pk, os, SerType::BINARY);
+    if (!ctx.cc->SerializeEvalMultKey(os, SerType::BINARY) ||
+        !ctx.cc->SerializeEvalAutomorphismKey(os, SerType::BINARY)) {
+        throw std::runtime_error("Cannot serialize the evaluation keys");
+    }
+    if (!os) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+FHECTX loadClusterContext(const std::string &path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    FHECTX ctx;
+    Serial::Deserialize(ctx.cc, is, SerType::BINARY);
+    Serial::Deserialize(ctx.pk, is, SerType::BINARY);
+    if (!CryptoContextImpl<DCRTPoly>::DeserializeEvalMultKey(is, SerType::BINARY) ||
+        !CryptoContextImpl<DCRTPoly>::DeserializeEvalAutomorphismKey(is, SerType::BINARY)) {
+        throw std::runtime_error("Cannot deserialize the evaluation keys");
+    }
+    ctx.sk = nullptr;
+    ctx.ringDim = ctx.cc->GetRingDimension();
+    ctx.modulus = ctx.cc->GetCryptoParameters()->GetPlaintextModulus();
+    return ctx;
+}
+
+// Processes
+namespace {
+
+// Forks and re-executes this binary as "-role role -setupFd fd", then sends
+// setup on the other end of a fresh socket pair. The child only closes
+// descriptors and calls execv, so the OpenMP and OpenFHE state of the parent
+// never runs in it.
+pid_t execRole(
+    const std::string &role,
+    const std::string &ctxPath,
+    const std::string &setup,
+    const std::vector<int> &closeFds
+) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        throw std::runtime_error("Cannot create a socket pair");
+    }
+    // Built before fork: the child must not allocate
+    std::string fdStr = std::to_string(fds[1]);
+    const char *argv[] = {"main_dopsi", "-role", role.c_str(), "-setupFd", fdStr.c_str(), nullptr};
+
+    std::string msg;
+    putBytes(msg, ctxPath);
+    putVal<uint32_t>(msg, omp_get_max_threads());
+    msg.append(setup);
+
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        throw std::runtime_error("Cannot fork the " + role + " process");
+    }
+    if (pid == 0) {
+        for (int fd : closeFds) {
+            close(fd);
+        }
+        close(fds[0]);
+        execv("/proc/self/exe", const_cast<char *const *>(argv));
+        _exit(127);
+    }
+
+    close(fds[1]);
+    try {
+        sendFrame(fds[0], msg);
+    } catch (...) {
+        close(fds[0]);
+        throw;
+    }
+    close(fds[0]);
+    return pid;
+}
+
+int runDataOwner(FHECTX &ctx, const std::string &setup, size_t pos) {
+    DOPSIOwnerConfig cfg = getVal<DOPSIOwnerConfig>(setup, pos);
+    int clientFd = getVal<int32_t>(setup, pos);
+    std::string leaderPath = getBytes(setup, pos);
+    std::vector<std::vector<int64_t>> shard(getVal<uint64_t>(setup, pos));
+    for (auto &item : shard) {
+        item.resize(cfg.itemLen);
+        for (auto &word : item) {
+            word = getVal<int64_t>(setup, pos);
+        }
+    }
+
+    int status = 0;
+    try {
+        if (cfg.numThreads > 0) {
+            omp_set_num_threads(cfg.numThreads);
+        }
+
+        // Setup
+        auto t1 = std::chrono::high_resolution_clock::now();
+        DOPMTDB DB;
+        if (cfg.isPSI) {
+            uint32_t maxBin = computeMaxBinLoad(ctx.ringDim / cfg.itemLen, shard.size(), 3);
+            SimpleHashTable hashTable = computeCuckooHashTableServer(
+                shard, ctx.ringDim, maxBin, -1, 3
+            );
+            DB = makeDOPSIDB(ctx, hashTable, cfg.alpha);
+        } else {
+            DB = makeDOPMTDB(ctx, shard, cfg.alpha, cfg.numPack);
+        }
+        double dbTime = elapsedSec(t1);
+        std::vector<DOPSIScratch> arena = makeScratchArena(DB, omp_get_max_threads(), cfg.numRand);
+
+        std::string ready;
+        putVal(ready, dbTime);
+        sendFrame(clientFd, ready);
+
+        // Queries
+        for (uint32_t rep = 0; rep < cfg.numReps; rep++) {
+            std::string queryMsg = recvFrame(clientFd);
+            size_t pos = 0;
+            Ciphertext<DCRTPoly> query = decodeCtxt(ctx.cc, queryMsg, pos);
+
+            t1 = std::chrono::high_resolution_clock::now();
+            DOPMTServerResponse response = cfg.isPSI
+                ? compInterPSIServer(ctx, DB, query, arena, cfg.mode)
+                : compInterPMTServer(ctx, DB, query, arena, cfg.mode);
+            double evalTime = elapsedSec(t1);
+
+            std::string msg = makeResponseFrame(
+                {{cfg.partyId, DOPSIPartyStats {dbTime, evalTime, 0}}}, response
+            );
+
+            int fd = connectSocket(leaderPath);
+            sendFrame(fd, msg);
+            close(fd);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Data owner " << cfg.partyId << ": " << e.what() << std::endl;
+        status = 1;
+    }
+    close(clientFd);
+    return status;
+}
+
+int runLeader(FHECTX &ctx, const std::string &setup, size_t pos) {
+    uint32_t numParties = getVal<uint32_t>(setup, pos);
+    uint32_t numReps = getVal<uint32_t>(setup, pos);
+    uint32_t numFrames = getVal<uint32_t>(setup, pos);
+    int listenFd = getVal<int32_t>(setup, pos);
+    int clientFd = getVal<int32_t>(setup, pos);
+
+    int status = 0;
+    try {
+        for (uint32_t rep = 0; rep < numReps; rep++) {
+            StreamingAggregator agg(ctx.cc, numFrames);
+            DOPSILeaderStats stats;
+            stats.parties.resize(numParties);
+
+            auto lastArrival = std::chrono::high_resolution_clock::now();
+            double cpu0 = cpuSec();
+            PartyList parties = collectResponses(ctx, numFrames, listenFd, agg, stats.bytesIn, lastArrival);
+            if (parties.size() != numParties) {
+                throw std::runtime_error("Leader received " + std::to_string(parties.size()) + " parties");
+            }
+            for (auto &party : parties) {
+                if (party.first >= numParties) {
+                    throw std::runtime_error("Unknown party " + std::to_string(party.first));
+                }
+                stats.parties[party.first] = party.second;
+            }
+
+            Ciphertext<DCRTPoly> aggCtxt = agg.finalize();
+            stats.tailTime = elapsedSec(lastArrival);
+            stats.cpuTime = cpuSec() - cpu0;
+
+            std::string reply;
+            putVal(reply, stats.cpuTime);
+            putVal(reply, stats.tailTime);
+            putVal(reply, stats.bytesIn);
+            putVal(reply, numParties);
+            for (auto &party : stats.parties) {
+                putVal(reply, party);
+            }
+            encodeCtxt(reply, aggCtxt);
+            sendFrame(clientFd, reply);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Leader: " << e.what() << std::endl;
+        status = 1;
+    }
+    close(listenFd);
+    close(clientFd);
+    return status;
+}
+
+int runAggNode(FHECTX &ctx, const std::string &setup, size_t pos) {
+    uint32_t numChildren = getVal<uint32_t>(setup, pos);
+    uint32_t numReps = getVal<uint32_t>(setup, pos);
+    uint32_t numTowers = getVal<uint32_t>(setup, pos);
+    int listenFd = getVal<int32_t>(setup, pos);
+    std::string parentPath = getBytes(setup, pos);
+
+    int status = 0;
+    try {
+        for (uint32_t rep = 0; rep < numReps; rep++) {
+            StreamingAggregator agg(ctx.cc, numChildren, 0, true);
+            uint64_t bytesIn;
+            auto lastArrival = std::chrono::high_resolution_clock::now();
+            PartyList parties = collectResponses(ctx, numChildren, listenFd, agg, bytesIn, lastArrival);
+
+            auto sums = agg.finalizeSums();
+            DOPMTServerResponse partial {sums.first, sums.second};
+            if (numTowers > 0) {
+                partial.vafOutput = ctx.cc->Compress(partial.vafOutput, numTowers);
+                partial.maskCtxt = ctx.cc->Compress(partial.maskCtxt, numTowers);
+            }
+
+            int fd = connectSocket(parentPath);
+            sendFrame(fd, makeResponseFrame(parties, partial));
+            close(fd);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Aggregation node: " << e.what() << std::endl;
+        status = 1;
+    }
+    close(listenFd);
+    return status;
+}
+
+} // namespace
+
+pid_t spawnDataOwner(
+    const std::string &ctxPath,
+    const DOPSIOwnerConfig &cfg,
+    const std::vector<std::vector<int64_t>> &shard,
+    int clientFd,
+    const std::vector<int> &closeFds,
+    const std::string &leaderPath
+) {
+    std::string setup;
+    putVal(setup, cfg);
+    putVal<int32_t>(setup, clientFd);
+    putBytes(setup, leaderPath);
+    putVal<uint64_t>(setup, shard.size());
+    for (auto &item : shard) {
+        if (item.size() != cfg.itemLen) {
+            throw std::runtime_error("Shard item length does not match itemLen");
+        }
+        setup.append(reinterpret_cast<const char *>(item.data()), item.size() * sizeof(int64_t));
+    }
+    return execRole("owner", ctxPath, setup, closeFds);
+}
+
+pid_t spawnLeader(
+    const std::string &ctxPath,
+    uint32_t numParties,
+    uint32_t numReps,
+    int listenFd,
+    int clientFd,
+    const std::vector<int> &closeFds,
+    uint32_t numFrames
+) {
+    std::string setup;
+    putVal(setup, numParties);
+    putVal(setup, numReps);
+    putVal<uint32_t>(setup, (numFrames == 0) ? numParties : numFrames);
+    putVal<int32_t>(setup, listenFd);
+    putVal<int32_t>(setup, clientFd);
+    return execRole("leader", ctxPath, setup, closeFds);
+}
+
+pid_t spawnAggNode(
+    const std::string &ctxPath,
+    uint32_t numChildren,
+    uint32_t numReps,
+    uint32_t numTowers,
+    int listenFd,
+    const std::string &parentPath,
+    const std::vector<int> &closeFds
+) {
+    std::string setup;
+    putVal(setup, numChildren);
+    putVal(setup, numReps);
+    putVal(setup, numTowers);
+    putVal<int32_t>(setup, listenFd);
+    putBytes(setup, parentPath);
+    return execRole("agg", ctxPath, setup, closeFds);
+}
+
+int runClusterRole(const std::string &role, int setupFd) {
+    std::string setup;
+    FHECTX ctx;
+    size_t pos = 0;
+    try {
+        // Read first, so that the parent can go on spawning
+        setup = recvFrame(setupFd);
+        close(setupFd);
+        std::string ctxPath = getBytes(setup, pos);
+        omp_set_num_threads(getVal<uint32_t>(setup, pos));
+        ctx = loadClusterContext(ctxPath);
+    } catch (const std::exception &e) {
+        std::cerr << "Cluster " << role << " setup: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (role == "owner") {
+        return runDataOwner(ctx, setup, pos);
+    }
+    if (role == "leader") {
+        return runLeader(ctx, setup, pos);
+    }
+    if (role == "agg") {
+        return runAggNode(ctx, setup, pos);
+    }
+    std::cerr << "Unknown cluster role " << role << std::endl;
+    return 1;
+}
+
+size_t recvLeaderReply(
+    FHECTX &ctx,
+    int fd,
+    Ciphertext<DCRTPoly> &aggCtxt,
+    DOPSILeaderStats &stats
+) {
+    std::string reply = recvFrame(fd);
+    size_t pos = 0;
+    stats.cpuTime = getVal<double>(reply, pos);
+    stats.tailTime = getVal<double>(reply, pos);
+    stats.bytesIn = getVal<uint64_t>(reply, pos);
+    uint32_t numParties = getVal<uint32_t>(reply, pos);
+    stats.parties.resize(numParties);
+    for (uint32_t i = 0; i < numParties; i++) {
+        stats.parties[i] = getVal<DOPSIPartyStats>(reply, pos);
+    }
+    aggCtxt = decodeCtxt(ctx.cc, reply, pos);
+    return reply.size() + sizeof(uint64_t);
+}
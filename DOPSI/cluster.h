@@ -0,0 +1,110 @@
+#ifndef DOPSI_CLUSTER_H
+#define DOPSI_CLUSTER_H
+
+#include "server.h"
+#include <string>
+#include <sys/types.h>
+
+// Local cluster simulation: every data owner and the leader run in their own
+// process and exchange ciphertexts in the compact wire format over
+// Unix-domain sockets.
+// The processes re-execute this binary (runClusterRole) rather than carrying
+// on after fork, since OpenMP does not survive a fork once the parent has run
+// a parallel region. They load the crypto context and evaluation keys from
+// the file written by saveClusterContext.
+
+// Length-prefixed frames over a stream socket
+void sendFrame(int fd, const std::string &buf);
+std::string recvFrame(int fd);
+
+// OpenFHE serialization; the cluster itself uses the compact format of
+// core/wire.h
+std::string serializeCtxt(const Ciphertext<DCRTPoly> &ctxt);
+Ciphertext<DCRTPoly> deserializeCtxt(const std::string &buf);
+
+int makeListenSocket(const std::string &path, uint32_t backlog);
+int connectSocket(const std::string &path);
+
+// Raises the open-file limit to at least numFds
+void raiseFdLimit(uint64_t numFds);
+
+// Context, public key and evaluation keys; the loaded context has no secret key
+void saveClusterContext(FHECTX &ctx, const std::string &path);
+FHECTX loadClusterContext(const std::string &path);
+
+struct DOPSIOwnerConfig {
+    uint32_t partyId;
+    bool isPSI;
+    uint32_t itemLen;
+    uint32_t numPack;
+    uint32_t mode;
+    uint32_t numRand;
+    uint32_t numThreads;   // OpenMP threads inside the owner process
+    uint32_t numReps;      // queries served before exiting
+    int64_t alpha;
+};
+
+struct DOPSIPartyStats {
+    double dbTime;
+    double evalTime;
+    uint64_t responseBytes;
+};
+
+struct DOPSILeaderStats {
+    double cpuTime;        // user + system time of the leader process
+    double tailTime;       // last arrival to aggregated result
+    uint64_t bytesIn;
+    std::vector<DOPSIPartyStats> parties;
+};
+
+// Data owner: builds its DB from shard, reports {dbTime} on clientFd, then
+// for every query read from clientFd sends its response to the leader.
+// closeFds are descriptors of the parent that the child must not keep.
+pid_t spawnDataOwner(
+    const std::string &ctxPath,
+    const DOPSIOwnerConfig &cfg,
+    const std::vector<std::vector<int64_t>> &shard,
+    int clientFd,
+    const std::vector<int> &closeFds,
+    const std::string &leaderPath
+);
+
+// Leader: for every query accepts numFrames response frames on listenFd
+// (numParties when 0, i.e. no aggregation tree), folds them into a
+// StreamingAggregator and replies on clientFd.
+pid_t spawnLeader(
+    const std::string &ctxPath,
+    uint32_t numParties,
+    uint32_t numReps,
+    int listenFd,
+    int clientFd,
+    const std::vector<int> &closeFds,
+    uint32_t numFrames = 0
+);
+
+// Intermediate node of an aggregation tree (core/aggtree.h): for every query
+// sums numChildren frames from listenFd and forwards the partial sums, with
+// the stats of the parties below, to parentPath; numTowers > 0 compresses them.
+pid_t spawnAggNode(
+    const std::string &ctxPath,
+    uint32_t numChildren,
+    uint32_t numReps,
+    uint32_t numTowers,
+    int listenFd,
+    const std::string &parentPath,
+    const std::vector<int> &closeFds
+);
+
+// Entry point of a spawned process ("-role <owner, leader or agg> -setupFd
+// <fd>"): reads its setup frame from setupFd; returns the exit status
+int runClusterRole(const std::string &role, int setupFd);
+
+// Client side of the leader reply; returns the size of the frame
+size_t recvLeaderReply(
+    FHECTX &ctx,
+    int fd,
+    Ciphertext<DCRTPoly> &aggCtxt,
+    DOPSILeaderStats &stats
+);
+
+#endif
@@ -4,5 +4,9 @@
 #include "../core/utils.h"
 #include "../core/vaf.h"
 #include "../core/hashing.h"
+#include "../core/aggregator.h"
+#include "../core/aggtree.h"
+#include "../core/wire.h"
+#include "../core/seeded.h"
 
 #endif 
\ No newline at end of file
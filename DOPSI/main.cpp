@@ -1,20 +1,241 @@
 #include "main.h"
+#include <map>
+
+// Helper function to check if a string is a valid non-negative integer
+bool isValidNumber(const std::string& str) {
+    if (str.empty()) return false;
+    for (char c : str) {
+        if (!std::isdigit(c)) return false;
+    }
+    return true;
+}
+
+// Function to print usage instructions
+void printUsage(const char *prog) {
+    std::cerr << "\nUsage: " << prog << " <mode> <numItem>\n"
+              << "   or: " << prog << " [flags]\n\n"
+              << "Flags (all optional):\n"
+              << "  -protocol <PSI or PMT>      (default PSI)\n"
+              << "  -numItem <int>              log2 of the server set size (default 16)\n"
+              << "  -itemLen <int>              16-bit words per item (default 8)\n"
+              << "  -numClient <int>            client set size for PSI (default 2048)\n"
+              << "  -numPack <int>              client items per PMT query (default 1)\n"
+              << "  -numInter <int>             client items in the server set (default 16)\n"
+              << "  -mode <0 or 1>              exact or probabilistic NPC (default 1)\n"
+              << "  -numRand <int>              random combinations for mode 1 (default 4)\n"
+              << "  -numThreads <int>           0 for the OpenMP default (default 0)\n"
+              << "  -reps <int>                 repetitions of the query (default 1)\n"
+              << "  -numParties <int>           data owners (default 1)\n"
+              << "  -keyHolders <int>           threshold key holders, 0 for a trusted key (default 0)\n"
+              << "  -cluster <0 or 1>           one process per data owner (default 0)\n"
+              << "  -ownerThreads <int>         OpenMP threads per owner process (default 1)\n"
+              << "  -queryMode <mode>           packed, replicated, seeded or auto (default packed)\n"
+              << "  -bandwidth <int>            link bandwidth in MB/s for the cost models (default 100)\n"
+              << "  -fanOut <int or auto>       aggregation tree fan-out, 0 for a flat leader (default 0)\n"
+              << "  -depth <int>                0 to compute from the parameters (default 0)\n"
+              << "  -scalingMod <int>           (default 60)\n"
+              << "  -alpha <int>                (default 3)\n"
+              << "  -format <text, csv or json> (default text)\n"
+              << "  -out <path>                 append records to a file\n\n"
+              << "Example:\n"
+              << "  " << prog << " -protocol PSI -numItem 20 -mode 0 -reps 3 -format csv -out sweep.csv\n"
+              << "  " << prog << " -protocol PSI -numItem 16 -numParties 64 -cluster 1 -format csv\n"
+              << "  " << prog << " -protocol PSI -numItem 12 -numParties 1024 -cluster 1 -fanOut auto\n\n";
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <mode> <numItem>" << std::endl;
+    // Legacy interface: <mode> <numItem>
+    if (argc == 3 && argv[1][0] != '-') {
+        uint32_t mode = std::stoi(argv[1]);
+        uint32_t logNumItem = std::stoi(argv[2]);
+
+        if (mode == 1) {
+            testDOPMT(logNumItem);
+        }
+        else if (mode == 2) {
+            testDOPSI(logNumItem);
+        }
+        else if (mode == 3) {
+            testHashTableBuild(logNumItem);
+        }
+        else if (mode == 4) {
+            testCuckooInsert(logNumItem);
+        }
+        else if (mode == 5) {
+            testPermHashing(logNumItem);
+        }
+        else if (mode == 6) {
+            testDBReuse(logNumItem);
+        }
+        else if (mode == 7) {
+            testWireFormat(logNumItem);
+        }
+        else if (mode == 8) {
+            testThresholdDecrypt(logNumItem);
+        }
+        else if (mode == 9) {
+            testMultiPMT(logNumItem);
+        }
+        else if (mode == 10) {
+            testQueryReplication(logNumItem);
+        }
+        else if (mode == 11) {
+            testAggTree(logNumItem);
+        }
+        return 0;
+    }
+
+    if (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+        printUsage(argv[0]);
+        return 0;
+    }
+    if (argc % 2 == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Store all key-value pairs in a map
+    std::map<std::string, std::string> args;
+    for (int i = 1; i < argc - 1; i += 2) {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+
+        // Check for flags that start with "-"
+        if (key.size() > 1 && key[0] == '-') {
+            args[key] = value;
+        } else {
+            std::cerr << "Error: Invalid flag '" << key << "'.\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Processes of the cluster mode re-execute this binary
+    if (args.count("-role")) {
+        if (args.size() != 2 || !args.count("-setupFd") || !isValidNumber(args["-setupFd"])) {
+            std::cerr << "Error: -role needs -setupFd <fd> and no other flag.\n";
+            return 1;
+        }
+        return runClusterRole(args["-role"], std::stoi(args["-setupFd"]));
+    }
+
+    DOPSIBenchParams params;
+
+    // Unsigned integer flags
+    std::map<std::string, uint32_t *> uintFlags = {
+        {"-numItem", &params.logNumItem},
+        {"-itemLen", &params.itemLen},
+        {"-numClient", &params.numClient},
+        {"-numPack", &params.numPack},
+        {"-numInter", &params.numInter},
+        {"-mode", &params.mode},
+        {"-numRand", &params.numRand},
+        {"-numThreads", &params.numThreads},
+        {"-reps", &params.numReps},
+        {"-numParties", &params.numParties},
+        {"-ownerThreads", &params.ownerThreads},
+        {"-bandwidth", &params.bandwidth},
+        {"-keyHolders", &params.numKeyHolders},
+        {"-depth", &params.depth},
+        {"-scalingMod", &params.scalingMod}
+    };
+
+    for (auto& arg : args) {
+        const std::string &key = arg.first;
+        const std::string &value = arg.second;
+
+        if (uintFlags.count(key)) {
+            if (!isValidNumber(value)) {
+                std::cerr << "Error: " << key << " must be a non-negative integer.\n";
+                return 1;
+            }
+            *uintFlags[key] = std::stoul(value);
+        } else if (key == "-protocol") {
+            if (value != "PSI" && value != "PMT") {
+                std::cerr << "Error: protocol must be either PSI or PMT.\n";
+                return 1;
+            }
+            params.isPSI = (value == "PSI");
+        } else if (key == "-cluster") {
+            if (value != "0" && value != "1") {
+                std::cerr << "Error: cluster must be either 0 or 1.\n";
+                return 1;
+            }
+            params.cluster = (value == "1");
+        } else if (key == "-queryMode") {
+            if (value != "packed" && value != "replicated" && value != "seeded" && value != "auto") {
+                std::cerr << "Error: queryMode must be packed, replicated, seeded or auto.\n";
+                return 1;
+            }
+            params.queryMode = value;
+        } else if (key == "-fanOut") {
+            if (value == "auto") {
+                params.autoFanOut = true;
+            } else if (isValidNumber(value) && std::stoul(value) != 1) {
+                params.fanOut = std::stoul(value);
+            } else {
+                std::cerr << "Error: fanOut must be auto, 0 or at least 2.\n";
+                return 1;
+            }
+        } else if (key == "-alpha") {
+            bool isNeg = !value.empty() && value[0] == '-';
+            if (!isValidNumber(isNeg ? value.substr(1) : value)) {
+                std::cerr << "Error: alpha must be an integer.\n";
+                return 1;
+            }
+            params.alpha = std::stoll(value);
+        } else if (key == "-format") {
+            if (value != "text" && value != "csv" && value != "json") {
+                std::cerr << "Error: format must be text, csv or json.\n";
+                return 1;
+            }
+            params.format = value;
+        } else if (key == "-out") {
+            params.outPath = value;
+        } else {
+            std::cerr << "Error: Unknown flag '" << key << "'.\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (params.mode > 1) {
+        std::cerr << "Error: mode must be either 0 (exact) or 1 (probabilistic).\n";
+        return 1;
+    }
+    if (params.logNumItem > 30 || params.itemLen == 0 || params.numClient == 0 ||
+        params.numRand == 0 || params.numReps == 0 || params.numParties == 0) {
+        std::cerr << "Error: numItem must be at most 30; itemLen, numClient, numRand, reps and numParties must be positive.\n";
+        return 1;
+    }
+    // The strided slot layout needs a power-of-two number of words
+    if ((params.itemLen & (params.itemLen - 1)) != 0) {
+        std::cerr << "Error: itemLen must be a power of two.\n";
+        return 1;
+    }
+    if (params.numPack == 0 || (params.numPack & (params.numPack - 1)) != 0) {
+        std::cerr << "Error: numPack must be a power of two.\n";
+        return 1;
+    }
+
+    // Seeded queries are encrypted under the secret key
+    if (params.queryMode == "seeded" && params.numKeyHolders > 0) {
+        std::cerr << "Error: seeded queries need a trusted key (keyHolders 0).\n";
+        return 1;
+    }
+    if (params.bandwidth == 0) {
+        std::cerr << "Error: bandwidth must be positive.\n";
+        return 1;
+    }
+    if (params.cluster && params.queryMode != "packed") {
+        std::cerr << "Error: the cluster mode sends packed queries only.\n";
         return 1;
     }
 
-    uint32_t mode = std::stoi(argv[1]);  
-    uint32_t logNumItem = std::stoi(argv[2]);  
-  
-    if (mode == 1) {
-        testDOPMT(logNumItem);
-    } 
-    else if (mode == 2) {
-        testDOPSI(logNumItem);
+    if (params.cluster) {
+        runDOPSICluster(params);
+    } else {
+        runDOPSIBench(params);
     }
-    
     return 0;
-}
\ No newline at end of file
+}
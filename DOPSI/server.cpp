@@ -43,40 +43,52 @@ std::vector<Ciphertext<DCRTPoly>> queryExtract(
 // Process Database
 DOPMTDB makeDOPMTDB (
     FHECTX &ctx,
-    std::vector<std::vector<int64_t>> msgVecs,
-    int64_t alpha
+    const std::vector<std::vector<int64_t>> &msgVecs,
+    int64_t alpha,
+    uint32_t numPack
 ) {
     uint32_t numItems = msgVecs.size();
     uint32_t kVal = msgVecs[0].size();
-    uint32_t numChunks = numItems / ctx.ringDim + (numItems % ctx.ringDim != 0);
+    if (numPack == 0 || (numPack & (numPack - 1)) != 0 || numPack * kVal > ctx.ringDim) {
+        throw std::runtime_error("numPack must be a power of two with numPack * k <= ringDim");
+    }
+    // Item r of a chunk occupies slots [r * numPack, (r+1) * numPack)
+    uint32_t chunkItems = ctx.ringDim / numPack;
+    uint32_t numChunks = numItems / chunkItems + (numItems % chunkItems != 0);
 
     std::vector<std::vector<Ciphertext<DCRTPoly>>> payload(numChunks);
+    for (auto &chunk : payload) {
+        chunk.resize(kVal);
+    }
 
     // Make Encrypted Database
-    for (uint32_t i = 0; i < numChunks; i++) {
-        uint32_t offset = i * ctx.ringDim;
-        std::vector<Ciphertext<DCRTPoly>> _tmp(kVal);
-
-        // Read Data
-        for (uint32_t j = 0; j < kVal; j++) {
-            std::vector<int64_t> _tmpMsg(ctx.ringDim, -1);
-
-            for (uint32_t k = 0; k < ctx.ringDim; k++) {
-                if (offset + k < numItems) {
-                    _tmpMsg[k] = msgVecs[offset + k][j];
+    // Each task gathers word j of the items of chunk i into a per-thread
+    // buffer and encrypts it; no transposed copy of the DB is materialized.
+    #pragma omp parallel
+    {
+        std::vector<int64_t> slots(ctx.ringDim);
+
+        #pragma omp for collapse(2) schedule(dynamic)
+        for (uint32_t i = 0; i < numChunks; i++) {
+            for (uint32_t j = 0; j < kVal; j++) {
+                uint32_t offset = i * chunkItems;
+                uint32_t numRead = std::min(chunkItems, numItems - offset);
+                for (uint32_t r = 0; r < numRead; r++) {
+                    std::fill_n(&slots[(uint64_t)r * numPack], numPack, msgVecs[offset + r][j]);
                 }
+                std::fill(slots.begin() + (uint64_t)numRead * numPack, slots.end(), -1);
+
+                Plaintext _ptxt = ctx.cc->MakePackedPlaintext(slots);
+                payload[i][j] = ctx.cc->Encrypt(_ptxt, ctx.pk);
             }
-            Plaintext _ptxt = ctx.cc->MakePackedPlaintext(_tmpMsg);
-            _tmp[j] = ctx.cc->Encrypt(_ptxt, ctx.pk);
         }
-        payload[i] = _tmp;
     }
 
     std::vector<Plaintext> maskPtxts = makeMaskPtxts(ctx, kVal);
     Plaintext ptOne = ctx.cc->MakePackedPlaintext(std::vector<int64_t>(1, ctx.ringDim));
 
     return DOPMTDB {
-        payload, ptOne, maskPtxts, alpha
+        payload, ptOne, maskPtxts, alpha, numPack
     };
 }
 
@@ -84,116 +96,187 @@ DOPMTDB makeDOPMTDB (
 DOPMTDB makeDOPSIDB (
     FHECTX &ctx,
     std::vector<std::vector<int64_t>> &msgVecs,
-    int64_t alpha
+    int64_t alpha,
+    const PermHashParams *perm
 ) {
     uint32_t numItems = msgVecs.size();
-    uint32_t kVal = msgVecs[0].size();
+    // With permutation-based hashing, only the remainders are stored
+    uint32_t kVal = (perm == nullptr) ? msgVecs[0].size() : perm->remWords;
+    if (perm != nullptr && perm->numBins != ctx.ringDim / perm->remWords) {
+        throw std::runtime_error("perm.numBins must be ringDim / perm.remWords");
+    }
 
-    uint32_t logN = std::log2(numItems);
-    uint32_t maxBin = getMaxBins(ctx.ringDim / kVal,  logN);
+    uint32_t maxBin = computeMaxBinLoad(ctx.ringDim / kVal, numItems, 3);
 
     // Make Hash Table
-    std::vector<std::vector<int64_t>> hashTable = computeCuckooHashTableServer (
-        msgVecs, ctx.ringDim, maxBin, -1, 3
-    );
+    SimpleHashTable hashTable = (perm == nullptr)
+        ? computeCuckooHashTableServer(msgVecs, ctx.ringDim, maxBin, -1, 3)
+        : computeCuckooHashTableServerPerm(msgVecs, maxBin, -1, *perm);
+
+    return makeDOPSIDB(ctx, hashTable, alpha);
+}
 
-    uint32_t numBuckets = hashTable.size();
+DOPMTDB makeDOPSIDB (
+    FHECTX &ctx,
+    const SimpleHashTable &hashTable,
+    int64_t alpha
+) {
+    uint32_t kVal = hashTable.dimElem;
+    uint32_t maxBin = hashTable.maxBin;
     uint32_t numChunks = maxBin / kVal + (maxBin % kVal != 0);
 
     std::vector<std::vector<Ciphertext<DCRTPoly>>> payload(numChunks);
+    for (auto &chunk : payload) {
+        chunk.resize(kVal);
+    }
 
     // Make Encrypted Database
-    for (uint32_t i = 0; i < numChunks; i++) {
-        uint32_t offset = i * kVal;
-        std::vector<Ciphertext<DCRTPoly>> _tmp(kVal);
-
-        for (uint32_t j = 0; j < kVal; j++) {
-            std::vector<int64_t> _tmpMsg(ctx.ringDim, -1);
-            uint32_t coloffset = numBuckets * j;
-
-            // Read Table
-            for (uint32_t k = 0; k < kVal; k++) {
-                for (uint32_t l = 0; l < numBuckets; l++) {
-                    size_t idx = k * numBuckets + l;
-                    if (idx < _tmpMsg.size() && offset + l < hashTable.size()) {
-                        if (coloffset + k < hashTable[offset + l].size()) {
-                            _tmpMsg[idx] = hashTable[offset + l][coloffset + k];
-                        }
-                    }
-                }
+    // Slot (b + numBins * t) of the j-th ciphertext in chunk i holds
+    // the j-th word of the (i * kVal + t)-th item in bin b.
+    // In the flat table, this is a contiguous copy; each task fills and encrypts one ciphertext.
+    #pragma omp parallel
+    {
+        std::vector<int64_t> _tmpMsg(ctx.ringDim);
+
+        #pragma omp for collapse(2) schedule(dynamic)
+        for (uint32_t i = 0; i < numChunks; i++) {
+            for (uint32_t j = 0; j < kVal; j++) {
+                hashTable.readSlots(j, i * kVal, _tmpMsg.data(), ctx.ringDim);
+
+                Plaintext _ptxt = ctx.cc->MakePackedPlaintext(_tmpMsg);
+                payload[i][j] = ctx.cc->Encrypt(_ptxt, ctx.pk);
             }
-            Plaintext _ptxt = ctx.cc->MakePackedPlaintext(_tmpMsg);
-            _tmp[j] = ctx.cc->Encrypt(_ptxt, ctx.pk);
         }
-        payload[i] = _tmp;
     }
 
     std::vector<Plaintext> maskPtxts = makeMaskPtxts(ctx, kVal);
     Plaintext ptOne = ctx.cc->MakePackedPlaintext(std::vector<int64_t>(1, ctx.ringDim));
 
     return DOPMTDB {
-        payload, ptOne, maskPtxts, alpha
+        payload, ptOne, maskPtxts, alpha, 1
     };    
 }
 
 // Do Server Operations
 
-Ciphertext<DCRTPoly> compInterServerInner (
+std::vector<DOPSIScratch> makeScratchArena(
+    const DOPMTDB &DB,
+    uint32_t numWorkers,
+    uint32_t numRand
+) {
+    if (numWorkers == 0) {
+        numWorkers = omp_get_max_threads();
+    }
+    const Ciphertext<DCRTPoly> &proto = DB.payload[0][0];
+    uint32_t k = DB.payload[0].size();
+
+    std::vector<DOPSIScratch> arena(numWorkers);
+    for (auto &scratch : arena) {
+        scratch.diff.resize(k);
+        for (auto &ctxt : scratch.diff) {
+            ctxt = proto->Clone();
+        }
+        scratch.rand.resize(numRand);
+        for (auto &ctxt : scratch.rand) {
+            ctxt = proto->Clone();
+        }
+        scratch.tmp = proto->Clone();
+        scratch.acc = proto->Clone();
+        scratch.isAccEmpty = true;
+    }
+    return arena;
+}
+
+// The result lives in the scratch and is valid until its next use
+Ciphertext<DCRTPoly> &compInterServerInner (
     FHECTX &ctx,
-    std::vector<Ciphertext<DCRTPoly>> &x,
-    std::vector<Ciphertext<DCRTPoly>> &y,
+    const std::vector<Ciphertext<DCRTPoly>> &x,
+    const std::vector<Ciphertext<DCRTPoly>> &y,
+    DOPSIScratch &scratch,
     Plaintext ptOne,
     int64_t alpha,
     uint32_t mode
 ) {
     uint32_t k = x.size();
 
+    // Copy into the buffers; DB stays intact
     for (uint32_t i = 0; i < k; i++) {
-        ctx.cc->EvalSubInPlace(x[i], y[i]);
+        *scratch.diff[i] = *x[i];
+        ctx.cc->EvalSubInPlace(scratch.diff[i], y[i]);
     }
 
-    Ciphertext<DCRTPoly> ret;
-
     // VAF with Exact NPC
     if (mode == 0) {
-        ret = compExactNPM(ctx, x, alpha);
-        ret = compVAF16(ctx, ret, ptOne);
+        compExactNPM(ctx, scratch.diff, alpha);
+        compVAF16InPlace(ctx, scratch.diff[0], ptOne);
+        return scratch.diff[0];
     }
-    else if (mode == 1) {
-        ret = compProbNPM(ctx, x, alpha, 4);
-        ret = compVAF16(ctx, ret, ptOne);
-    }
-    return ret;
+    compProbNPM(ctx, scratch.diff, alpha, scratch.rand, scratch.tmp);
+    compVAF16InPlace(ctx, scratch.rand[0], ptOne);
+    return scratch.rand[0];
 }
 
-
-DOPMTServerResponse compInterPMTServer(
+// Evaluates all chunks and sums their VAF outputs
+Ciphertext<DCRTPoly> compInterChunks(
     FHECTX &ctx,
-    DOPMTDB &DB,
-    Ciphertext<DCRTPoly> &query,
+    const DOPMTDB &DB,
+    const std::vector<Ciphertext<DCRTPoly>> &extQuery,
+    std::vector<DOPSIScratch> &arena,
     uint32_t mode
 ) {
     uint32_t numChunks = DB.payload.size();
+    uint32_t numWorkers = arena.size();
 
-    // Extract Query
-    std::vector<Ciphertext<DCRTPoly>> extQuery = queryExtract(
-        ctx, query, DB.maskPtxts
-    );
+    // Each worker accumulates into its own scratch. All entries are reset
+    // first: the runtime may hand out a smaller team than the arena.
+    for (auto &scratch : arena) {
+        scratch.isAccEmpty = true;
+    }
+    #pragma omp parallel num_threads(numWorkers)
+    {
+        DOPSIScratch &scratch = arena[omp_get_thread_num()];
+
+        #pragma omp for
+        for (uint32_t i = 0; i < numChunks; i++) {
+            Ciphertext<DCRTPoly> &vafRet = compInterServerInner(
+                ctx, DB.payload[i], extQuery, scratch, DB.ptOne, DB.alpha, mode
+            );
+            if (scratch.isAccEmpty) {
+                *scratch.acc = *vafRet;
+                scratch.isAccEmpty = false;
+            } else {
+                ctx.cc->EvalAddInPlace(scratch.acc, vafRet);
+            }
+        }
+    }
 
-    // Do Calculations
-    std::vector<Ciphertext<DCRTPoly>> vafRets(numChunks);
-    #pragma omp parallel for
-    for (uint32_t i = 0; i < numChunks; i++) {
-        vafRets[i] = compInterServerInner(
-            ctx, DB.payload[i], extQuery, DB.ptOne, DB.alpha, mode
-        );
+    std::vector<Ciphertext<DCRTPoly>> vafRets;
+    for (auto &scratch : arena) {
+        if (!scratch.isAccEmpty) {
+            vafRets.push_back(scratch.acc);
+        }
     }
+    return ctx.cc->EvalAddMany(vafRets);
+}
 
-    // Aggregate & Compress 
-    Ciphertext<DCRTPoly> vafOutput = ctx.cc->EvalAddMany(vafRets);
+// Compress the output and attach the mask
+DOPMTServerResponse makeServerResponse(
+    FHECTX &ctx,
+    Ciphertext<DCRTPoly> &vafOutput,
+    uint32_t k,
+    bool isPSI,
+    uint32_t numPack
+) {
     vafOutput = ctx.cc->Compress(vafOutput, 3);
-
-    vafOutput = sumOverSlots(ctx, vafOutput);
+    if (isPSI) {
+        // Sum the k items of each bin; bins are numBins = ringDim / k apart
+        vafOutput = ctxtRotAddStride(ctx, vafOutput, ctx.ringDim / k);
+    } else if (numPack == 1) {
+        vafOutput = sumOverSlots(ctx, vafOutput);
+    } else {
+        // Slots of client item g are g modulo numPack
+        vafOutput = ctxtRotAddStride(ctx, vafOutput, numPack);
+    }
 
     // Make Mask Randomness
     Ciphertext<DCRTPoly> maskCtxt = makeRandCtxt(ctx);
@@ -204,60 +287,125 @@ DOPMTServerResponse compInterPMTServer(
     };
 }
 
-// DO-PSI Server's Operations
-DOPMTServerResponse compInterPSIServer(
+DOPMTServerResponse compInterPMTServer(
     FHECTX &ctx,
-    DOPMTDB &DB,
+    const DOPMTDB &DB,
     Ciphertext<DCRTPoly> &query,
+    std::vector<DOPSIScratch> &arena,
     uint32_t mode
 ) {
-    uint32_t numChunks = DB.payload.size();
-
     // Extract Query
     std::vector<Ciphertext<DCRTPoly>> extQuery = queryExtract(
         ctx, query, DB.maskPtxts
     );
-    uint32_t k = extQuery.size();
 
     // Do Calculations
-    std::vector<Ciphertext<DCRTPoly>> vafRets(numChunks);
+    Ciphertext<DCRTPoly> vafOutput = compInterChunks(ctx, DB, extQuery, arena, mode);
+    return makeServerResponse(ctx, vafOutput, extQuery.size(), false, DB.numPack);
+}
 
-    #pragma omp parallel for
-    for (uint32_t i = 0; i < numChunks; i++) {
-        vafRets[i] = compInterServerInner(
-            ctx, DB.payload[i], extQuery, DB.ptOne, DB.alpha, mode
-        );
+DOPMTServerResponse compInterPMTServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    Ciphertext<DCRTPoly> &query,
+    uint32_t mode
+) {
+    std::vector<DOPSIScratch> arena = makeScratchArena(DB);
+    return compInterPMTServer(ctx, DB, query, arena, mode);
+}
+
+// Replicated query; no extraction
+DOPMTServerResponse compInterPMTServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    const std::vector<Ciphertext<DCRTPoly>> &extQuery,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+) {
+    if (extQuery.size() != DB.maskPtxts.size()) {
+        throw std::runtime_error("Replicated query does not match the DB");
     }
+    Ciphertext<DCRTPoly> vafOutput = compInterChunks(ctx, DB, extQuery, arena, mode);
+    return makeServerResponse(ctx, vafOutput, extQuery.size(), false, DB.numPack);
+}
 
-    // Aggregate & Compress 
-    Ciphertext<DCRTPoly> vafOutput = ctx.cc->EvalAddMany(vafRets);
-    vafOutput = ctx.cc->Compress(vafOutput, 3);
-    vafOutput = ctxtRotAddStride(ctx, vafOutput, ctx.modulus / k);
+// DO-PSI Server's Operations
+DOPMTServerResponse compInterPSIServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    Ciphertext<DCRTPoly> &query,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+) {
+    // Extract Query
+    std::vector<Ciphertext<DCRTPoly>> extQuery = queryExtract(
+        ctx, query, DB.maskPtxts
+    );
 
-    // Make Mask Randomness
-    Ciphertext<DCRTPoly> maskCtxt = makeRandCtxt(ctx);
-    maskCtxt = ctx.cc->Compress(maskCtxt, 3);
+    // Do Calculations
+    Ciphertext<DCRTPoly> vafOutput = compInterChunks(ctx, DB, extQuery, arena, mode);
+    return makeServerResponse(ctx, vafOutput, extQuery.size(), true);
+}
 
-    return DOPMTServerResponse {
-        vafOutput, maskCtxt
-    };
+DOPMTServerResponse compInterPSIServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    Ciphertext<DCRTPoly> &query,
+    uint32_t mode
+) {
+    std::vector<DOPSIScratch> arena = makeScratchArena(DB);
+    return compInterPSIServer(ctx, DB, query, arena, mode);
+}
+
+DOPMTServerResponse compInterPSIServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    const std::vector<Ciphertext<DCRTPoly>> &extQuery,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+) {
+    if (extQuery.size() != DB.maskPtxts.size()) {
+        throw std::runtime_error("Replicated query does not match the DB");
+    }
+    Ciphertext<DCRTPoly> vafOutput = compInterChunks(ctx, DB, extQuery, arena, mode);
+    return makeServerResponse(ctx, vafOutput, extQuery.size(), true);
 }
 
 // Leader Server
+void encodeDOPMTResponse(std::string &buf, const DOPMTServerResponse &response) {
+    encodeCtxt(buf, response.vafOutput);
+    encodeCtxt(buf, response.maskCtxt);
+}
+
+DOPMTServerResponse decodeDOPMTResponse(FHECTX &ctx, const std::string &buf, size_t &pos) {
+    Ciphertext<DCRTPoly> vafOutput = decodeCtxt(ctx.cc, buf, pos);
+    Ciphertext<DCRTPoly> maskCtxt = decodeCtxt(ctx.cc, buf, pos);
+    return DOPMTServerResponse {vafOutput, maskCtxt};
+}
+
 Ciphertext<DCRTPoly> compAggLeader (
     FHECTX &ctx,
-    std::vector<DOPMTServerResponse> &responses
+    const std::vector<DOPMTServerResponse> &responses
 ) {
     uint32_t numResponses = responses.size();
-    std::vector<Ciphertext<DCRTPoly>> vafOuts(numResponses);
-    std::vector<Ciphertext<DCRTPoly>> masks(numResponses);
+    StreamingAggregator agg(ctx.cc, numResponses);
 
+    #pragma omp parallel for
     for (uint32_t i = 0; i < numResponses; i++) {
-        vafOuts[i] = responses[i].vafOutput;
-        masks[i] = responses[i].maskCtxt;
+        agg.add(responses[i].vafOutput, responses[i].maskCtxt);
     }
-    Ciphertext<DCRTPoly> vafAgg = ctx.cc->EvalAddMany(vafOuts);
-    Ciphertext<DCRTPoly> maskAgg = ctx.cc->EvalAddMany(masks);
+    return agg.finalize();
+}
 
-    return ctx.cc->EvalMult(vafAgg, maskAgg);
+Ciphertext<DCRTPoly> compAggLeader (
+    FHECTX &ctx,
+    const std::vector<DOPMTServerResponse> &responses,
+    const AggTreePlan &plan
+) {
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> leaves(responses.size());
+    for (uint32_t i = 0; i < responses.size(); i++) {
+        leaves[i] = {responses[i].vafOutput, responses[i].maskCtxt};
+    }
+    std::vector<Ciphertext<DCRTPoly>> sums = runAggTree(ctx.cc, plan, AggOp::SUM, leaves);
+    return ctx.cc->EvalMult(sums[0], sums[1]);
 }
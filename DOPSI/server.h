@@ -8,6 +8,20 @@ struct DOPMTDB {
     Plaintext ptOne;
     std::vector<Plaintext> maskPtxts;
     int64_t alpha;
+    uint32_t numPack;   // DO-PMT client items per query; 1 for DO-PSI
+};
+
+// Number of random combinations for the probabilistic NPC (mode 1)
+#define DOPSI_NUM_RAND 4
+
+// Preallocated ciphertexts of one worker; reused across chunks and queries
+// so that the DB is never modified.
+struct DOPSIScratch {
+    std::vector<Ciphertext<DCRTPoly>> diff;
+    std::vector<Ciphertext<DCRTPoly>> rand;
+    Ciphertext<DCRTPoly> tmp;
+    Ciphertext<DCRTPoly> acc;
+    bool isAccEmpty;
 };
 
 struct DOPMTServerResponse {
@@ -15,35 +29,128 @@ struct DOPMTServerResponse {
     Ciphertext<DCRTPoly> maskCtxt;
 };
 
+// With numPack > 1, every item is repeated in numPack consecutive slots so
+// that one pass answers numPack packed client items (queryCompressMulti).
 DOPMTDB makeDOPMTDB (
     FHECTX &ctx,
-    std::vector<std::vector<int64_t>> msgVecs,
-    int64_t alpha
+    const std::vector<std::vector<int64_t>> &msgVecs,
+    int64_t alpha,
+    uint32_t numPack = 1
 );
 
+// perm enables permutation-based hashing; kVal becomes perm->remWords.
 DOPMTDB makeDOPSIDB (
     FHECTX &ctx,
     std::vector<std::vector<int64_t>> &msgVecs,
+    int64_t alpha,
+    const PermHashParams *perm = nullptr
+);
+
+// Encrypts a server table built by the caller
+DOPMTDB makeDOPSIDB (
+    FHECTX &ctx,
+    const SimpleHashTable &hashTable,
     int64_t alpha
 );
 
+std::vector<Ciphertext<DCRTPoly>> queryExtract(
+    FHECTX & ctx,
+    Ciphertext<DCRTPoly> &x,
+    std::vector<Plaintext> maskVecs
+);
+
+// One scratch per worker; numWorkers = 0 uses the OpenMP thread count
+std::vector<DOPSIScratch> makeScratchArena(
+    const DOPMTDB &DB,
+    uint32_t numWorkers = 0,
+    uint32_t numRand = DOPSI_NUM_RAND
+);
+
+// Sum of the VAF outputs over all chunks
+Ciphertext<DCRTPoly> compInterChunks(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    const std::vector<Ciphertext<DCRTPoly>> &extQuery,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+);
+
+// Post-processing of the summed VAF output; PSI sums per bin, PMT over all
+// slots of each of the numPack client items (slot g answers item g)
+DOPMTServerResponse makeServerResponse(
+    FHECTX &ctx,
+    Ciphertext<DCRTPoly> &vafOutput,
+    uint32_t k,
+    bool isPSI,
+    uint32_t numPack = 1
+);
+
+DOPMTServerResponse compInterPMTServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    Ciphertext<DCRTPoly> &query,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+);
+
+// Allocates a temporary arena
 DOPMTServerResponse compInterPMTServer(
     FHECTX &ctx,
-    DOPMTDB &DB,
+    const DOPMTDB &DB,
+    Ciphertext<DCRTPoly> &query,
+    uint32_t mode
+);
+
+DOPMTServerResponse compInterPSIServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
     Ciphertext<DCRTPoly> &query,
+    std::vector<DOPSIScratch> &arena,
     uint32_t mode
 );
 
 DOPMTServerResponse compInterPSIServer(
     FHECTX &ctx,
-    DOPMTDB &DB,
+    const DOPMTDB &DB,
     Ciphertext<DCRTPoly> &query,
     uint32_t mode
 );
 
+// Replicated queries (queryReplicate): extQuery holds one ciphertext per
+// block, so the extraction is skipped.
+DOPMTServerResponse compInterPMTServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    const std::vector<Ciphertext<DCRTPoly>> &extQuery,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+);
+
+DOPMTServerResponse compInterPSIServer(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    const std::vector<Ciphertext<DCRTPoly>> &extQuery,
+    std::vector<DOPSIScratch> &arena,
+    uint32_t mode
+);
+
+// Compact wire format of a response (core/wire.h)
+void encodeDOPMTResponse(std::string &buf, const DOPMTServerResponse &response);
+DOPMTServerResponse decodeDOPMTResponse(FHECTX &ctx, const std::string &buf, size_t &pos);
+
+// Batch interface over StreamingAggregator; responses arriving over time
+// should be passed to StreamingAggregator::add directly.
+Ciphertext<DCRTPoly> compAggLeader (
+    FHECTX &ctx,
+    const std::vector<DOPMTServerResponse> &responses
+);
+
+// Aggregation tree (core/aggtree.h): the nodes sum (isInter, mask) and the
+// root performs the multiplication; plan is an AggOp::SUM plan.
 Ciphertext<DCRTPoly> compAggLeader (
     FHECTX &ctx,
-    std::vector<DOPMTServerResponse> &responses
+    const std::vector<DOPMTServerResponse> &responses,
+    const AggTreePlan &plan
 );
 
 #endif 
\ No newline at end of file
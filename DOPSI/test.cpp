@@ -1,4 +1,9 @@
 #include "test.h"
+#include <fstream>
+#include <set>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 void testDOPMT(uint32_t logNumItem) {
     FHECTX ctx = initParams(65537, 18, 60);
@@ -53,4 +58,1101 @@ void testDOPSI(uint32_t logNumItem) {
 
     std::cout << "Done!" << std::endl;
     std::cout << "Server Runtime: " << tdiff << "s" << std::endl;
-}
\ No newline at end of file
+}
+
+// Throughput of the server-side cuckoo table build for each hash backend
+void testHashTableBuild(uint32_t logNumItem) {
+    uint32_t ringDim = 1 << 15;
+    uint32_t kVal = 8;
+    uint32_t numItem = 1 << logNumItem;
+    uint32_t maxBin = computeMaxBinLoad(ringDim / kVal, numItem, 3);
+
+    std::cout << "Prepare Data" << std::endl;
+    std::vector<std::vector<int64_t>> serverData = genData(numItem, kVal, 1<<16);
+
+    std::vector<std::pair<std::string, HashType>> hashTypes = {
+        {"SHA256", HashType::SHA256},
+        {"SipHash", HashType::SIPHASH}
+    };
+
+    for (auto &hashType : hashTypes) {
+        setHashType(hashType.second);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        SimpleHashTable hashTable = computeCuckooHashTableServer(
+            serverData, ringDim, maxBin, -1, 3
+        );
+        auto t2 = std::chrono::high_resolution_clock::now();
+        auto tdiff = std::chrono::duration<double>(t2-t1).count();
+
+        std::cout << "[" << hashType.first << "] Table Build: " << tdiff << "s, "
+                  << numItem / tdiff << " items/s" << std::endl;
+    }
+    setHashType(HashType::SHA256);
+}
+
+// Client-side cuckoo insertion: build time, evictions, stash usage and failure rate
+void testCuckooInsert(uint32_t logNumItem) {
+    uint32_t numItem = 1 << logNumItem;
+    std::vector<double> loadFactors = {0.5, 0.7, 0.79, 0.85};
+
+    for (double load : loadFactors) {
+        uint32_t numBins = numItem / load;
+        CuckooStats stats;
+        std::vector<std::vector<int64_t>> stashItems;
+        // Two words, deduplicated: repeated items share all their bins and
+        // would overflow them
+        std::set<std::vector<int64_t>> uniqueData;
+        while (uniqueData.size() < numItem) {
+            for (auto &item : genData(numItem - uniqueData.size(), 2, 1<<16)) {
+                uniqueData.insert(item);
+            }
+        }
+        std::vector<std::vector<int64_t>> clientData(uniqueData.begin(), uniqueData.end());
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        computeCuckooHashTableClient(clientData, numBins * 2, -1, 3, &stashItems, &stats);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        auto tdiff = std::chrono::duration<double>(t2-t1).count();
+
+        double failNoStash = estimateCuckooFailProb(numItem, numBins, 3, 0, 100);
+        double failStash = estimateCuckooFailProb(numItem, numBins, 3, CUCKOO_STASH_SIZE, 100);
+
+        std::cout << "Load: " << load
+                  << " | Time: " << tdiff << "s"
+                  << " | Evictions: " << stats.totalEvictions
+                  << " | Max Chain: " << stats.maxEvictionChain
+                  << " | Stash Used: " << stats.stashUsed
+                  << " | Fail Prob (no stash): " << failNoStash
+                  << " | Fail Prob (stash " << CUCKOO_STASH_SIZE << "): " << failStash
+                  << std::endl;
+    }
+}
+
+// DO-PSI with and without permutation-based hashing for 72-bit items
+void testPermHashing(uint32_t logNumItem) {
+    uint32_t itemBits = 72;
+    uint32_t wordBits = 16;
+    uint32_t itemWords = (itemBits + wordBits - 1) / wordBits;
+
+    // Without phash, the slot layout needs a power-of-two number of words
+    uint32_t fullWords = 1;
+    while (fullWords < itemWords) {
+        fullWords *= 2;
+    }
+
+    FHECTX ctx = initParams(65537, 19, 60);
+    PermHashParams perm = choosePermHashParams(ctx.ringDim, itemBits, wordBits, 3);
+
+    std::cout << "Prepare Data" << std::endl;
+    std::vector<std::vector<int64_t>> serverData = genData(1<<logNumItem, fullWords, 1<<16);
+    std::vector<std::vector<int64_t>> clientData = genData(2048, fullWords, 1<<16);
+    for (auto *data : {&serverData, &clientData}) {
+        for (auto &item : *data) {
+            // Keep only itemBits bits
+            item[itemWords - 1] &= (1 << (itemBits - (itemWords - 1) * wordBits)) - 1;
+            std::fill(item.begin() + itemWords, item.end(), 0);
+        }
+    }
+
+    std::vector<std::pair<std::string, const PermHashParams *>> modes = {
+        {"Full Items", nullptr},
+        {"Permutation", &perm}
+    };
+
+    for (auto &mode : modes) {
+        Ciphertext<DCRTPoly> queryCtxt = queryCompressTable(ctx, clientData, mode.second);
+        DOPMTDB serverDB = makeDOPSIDB(ctx, serverData, 3, mode.second);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        DOPMTServerResponse ret = compInterPSIServer(
+            ctx, serverDB, queryCtxt, 1
+        );
+        auto t2 = std::chrono::high_resolution_clock::now();
+        auto tdiff = std::chrono::duration<double>(t2-t1).count();
+
+        uint32_t kVal = serverDB.maskPtxts.size();
+        std::cout << "[" << mode.first << "]"
+                  << " Words: " << kVal
+                  << " | Bins: " << ctx.ringDim / kVal
+                  << " | Chunks: " << serverDB.payload.size()
+                  << " | Server Runtime: " << tdiff << "s" << std::endl;
+    }
+}
+
+// One DB and one scratch arena serving repeated queries; outputs should not drift
+void testDBReuse(uint32_t logNumItem) {
+    FHECTX ctx = initParams(65537, 19, 60);
+    std::cout << "Prepare Data" << std::endl;
+    std::vector<std::vector<int64_t>> serverData = genData(1<<logNumItem, 8, 1<<16);
+    std::vector<std::vector<int64_t>> clientData = genData(2048, 8, 1<<16);
+
+    Ciphertext<DCRTPoly> queryCtxt = queryCompressTable(ctx, clientData);
+    const DOPMTDB serverDB = makeDOPSIDB(ctx, serverData, 3);
+    std::vector<DOPSIScratch> arena = makeScratchArena(serverDB);
+
+    int64_t prevCount = -1;
+    for (uint32_t q = 0; q < 3; q++) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        DOPMTServerResponse ret = compInterPSIServer(
+            ctx, serverDB, queryCtxt, arena, 0
+        );
+        auto t2 = std::chrono::high_resolution_clock::now();
+        auto tdiff = std::chrono::duration<double>(t2-t1).count();
+
+        Plaintext retPtxt;
+        ctx.cc->Decrypt(ret.vafOutput, ctx.sk, &retPtxt);
+        std::vector<int64_t> retVec = retPtxt->GetPackedValue();
+        int64_t count = std::count_if(retVec.begin(), retVec.end(), [](int64_t v) { return v != 0; });
+
+        std::cout << "Query " << q << " | Server Runtime: " << tdiff << "s"
+                  << " | Nonzero Slots: " << count
+                  << ((prevCount < 0 || prevCount == count) ? "" : " [MISMATCH]")
+                  << std::endl;
+        prevCount = count;
+    }
+}
+
+
+// Bytes per response and encode/decode throughput of the compact wire format,
+// against the raw limbs and OpenFHE's binary serialization
+void testWireFormat(uint32_t logNumItem) {
+    FHECTX ctx = initParams(65537, 19, 60);
+    std::cout << "Prepare Data" << std::endl;
+    std::vector<std::vector<int64_t>> serverData = genData(1<<logNumItem, 8, 1<<16);
+    std::vector<std::vector<int64_t>> clientData = genData(2048, 8, 1<<16);
+
+    Ciphertext<DCRTPoly> queryCtxt = queryCompressTable(ctx, clientData);
+    DOPMTDB serverDB = makeDOPSIDB(ctx, serverData, 3);
+    DOPMTServerResponse response = compInterPSIServer(ctx, serverDB, queryCtxt, 1);
+
+    uint32_t numReps = 16;
+    std::vector<std::pair<std::string, std::vector<Ciphertext<DCRTPoly>>>> cases = {
+        {"Query", {queryCtxt}},
+        {"Response", {response.vafOutput, response.maskCtxt}}
+    };
+    for (auto &c : cases) {
+        size_t rawSize = 0, serialSize = 0;
+        for (auto &ctxt : c.second) {
+            rawSize += ctxtSize(ctxt);
+            serialSize += serializeCtxt(ctxt).size();
+        }
+
+        std::string buf;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (uint32_t r = 0; r < numReps; r++) {
+            buf.clear();
+            encodeCtxts(buf, c.second);
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        double encTime = std::chrono::duration<double>(t2-t1).count() / numReps;
+
+        std::vector<Ciphertext<DCRTPoly>> decoded;
+        t1 = std::chrono::high_resolution_clock::now();
+        for (uint32_t r = 0; r < numReps; r++) {
+            size_t pos = 0;
+            decoded = decodeCtxts(ctx.cc, buf, pos);
+        }
+        t2 = std::chrono::high_resolution_clock::now();
+        double decTime = std::chrono::duration<double>(t2-t1).count() / numReps;
+
+        // The decoded ciphertexts must decrypt to the same messages
+        bool isSame = true;
+        for (uint32_t i = 0; i < c.second.size(); i++) {
+            Plaintext ptxt1, ptxt2;
+            ctx.cc->Decrypt(c.second[i], ctx.sk, &ptxt1);
+            ctx.cc->Decrypt(decoded[i], ctx.sk, &ptxt2);
+            isSame = isSame && (ptxt1->GetPackedValue() == ptxt2->GetPackedValue());
+        }
+
+        std::cout << c.first << " | Towers: " << c.second[0]->GetElements()[0].GetNumOfElements()
+                  << " | Raw (MB): " << rawSize / 1000000.0
+                  << " | OpenFHE Serial (MB): " << serialSize / 1000000.0
+                  << " | Compact (MB): " << buf.size() / 1000000.0
+                  << " | Encode (MB/s): " << buf.size() / 1000000.0 / encTime
+                  << " | Decode (MB/s): " << buf.size() / 1000000.0 / decTime
+                  << (isSame ? "" : " [MISMATCH]") << std::endl;
+    }
+}
+
+
+// Latency of the joint decryption of an aggregated result for 1, 2, 4, ...,
+// 2^logMaxHolders key holders
+void testThresholdDecrypt(uint32_t logMaxHolders) {
+    uint32_t numReps = 4;
+    for (uint32_t numHolders = 1; numHolders <= (1U << logMaxHolders); numHolders *= 2) {
+        std::vector<PrivateKey<DCRTPoly>> shares;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        FHECTX ctx = initThresholdParams(65537, 2, 60, numHolders, shares);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        double keygenTime = std::chrono::duration<double>(t2-t1).count();
+
+        // Same shape as the leader's output: a product of two sums, rotated
+        std::vector<std::vector<int64_t>> msgs = genData(2, ctx.ringDim, 256);
+        Ciphertext<DCRTPoly> x = encryptPtxt(ctx, ctx.cc->MakePackedPlaintext(msgs[0]));
+        Ciphertext<DCRTPoly> y = encryptPtxt(ctx, ctx.cc->MakePackedPlaintext(msgs[1]));
+        Ciphertext<DCRTPoly> ret = ctx.cc->EvalRotate(ctx.cc->EvalMult(x, y), 1);
+        ret = ctx.cc->Compress(ret, 3);
+
+        std::vector<int64_t> retVec;
+        t1 = std::chrono::high_resolution_clock::now();
+        for (uint32_t r = 0; r < numReps; r++) {
+            retVec = thresholdDecrypt(ctx, shares, ret)->GetPackedValue();
+        }
+        t2 = std::chrono::high_resolution_clock::now();
+        double decTime = std::chrono::duration<double>(t2-t1).count() / numReps;
+
+        // Rotation over the two rows of the BFV slots
+        uint32_t half = ctx.ringDim / 2;
+        uint32_t numWrong = 0;
+        for (uint32_t i = 0; i < ctx.ringDim; i++) {
+            uint32_t src = (i < half) ? (i + 1) % half : half + (i + 1 - half) % half;
+            int64_t exp = (msgs[0][src] * msgs[1][src]) % ctx.modulus;
+            int64_t got = ((retVec[i] % ctx.modulus) + ctx.modulus) % ctx.modulus;
+            numWrong += (exp != got);
+        }
+
+        std::cout << "Key Holders: " << numHolders
+                  << " | Keygen: " << keygenTime << "s"
+                  << " | Threshold Decryption: " << decTime << "s"
+                  << " | Wrong Slots: " << numWrong << std::endl;
+    }
+}
+
+
+// Amortized server cost per client item when m items share one DO-PMT query
+void testMultiPMT(uint32_t logNumItem) {
+    FHECTX ctx = initParams(65537, 19, 60);
+    uint32_t numItem = 1 << logNumItem;
+
+    for (uint32_t k = 2; k <= 16; k *= 2) {
+        std::vector<std::vector<int64_t>> serverData = genData(numItem, k, 1<<16);
+        std::set<std::vector<int64_t>> serverSet(serverData.begin(), serverData.end());
+
+        for (uint32_t m = 1; m <= 64 && m * k <= ctx.ringDim; m *= 4) {
+            // Every other client item is in the server set
+            std::vector<std::vector<int64_t>> clientData = genData(m, k, 1<<16);
+            for (uint32_t g = 0; g < m; g += 2) {
+                clientData[g] = serverData[(uint64_t)g * numItem / m];
+            }
+
+            auto t1 = std::chrono::high_resolution_clock::now();
+            DOPMTDB serverDB = makeDOPMTDB(ctx, serverData, 3, m);
+            auto t2 = std::chrono::high_resolution_clock::now();
+            double dbTime = std::chrono::duration<double>(t2-t1).count();
+
+            Ciphertext<DCRTPoly> queryCtxt = queryCompressMulti(ctx, clientData);
+            t1 = std::chrono::high_resolution_clock::now();
+            DOPMTServerResponse ret = compInterPMTServer(ctx, serverDB, queryCtxt, 1);
+            t2 = std::chrono::high_resolution_clock::now();
+            double tdiff = std::chrono::duration<double>(t2-t1).count();
+
+            Plaintext retPtxt;
+            ctx.cc->Decrypt(ret.vafOutput, ctx.sk, &retPtxt);
+            std::vector<int64_t> retVec = retPtxt->GetPackedValue();
+            uint32_t numWrong = 0;
+            for (uint32_t g = 0; g < m; g++) {
+                numWrong += ((retVec[g] != 0) != (serverSet.count(clientData[g]) > 0));
+            }
+
+            std::cout << "k: " << k << " | Items per Query: " << m
+                      << " | Chunks: " << serverDB.payload.size()
+                      << " | DB Build: " << dbTime << "s"
+                      << " | Server Runtime: " << tdiff << "s"
+                      << " | Per Item: " << tdiff / m << "s"
+                      << " | Wrong: " << numWrong << std::endl;
+        }
+    }
+}
+
+
+
+// Upload against server compute for packed, replicated and seeded DO-PMT
+// queries; the break-even bandwidth is where the extra upload of a seeded
+// query takes as long as the extraction it saves.
+void testQueryReplication(uint32_t logNumItem) {
+    FHECTX ctx = initParams(65537, 19, 60);
+    uint32_t numItem = 1 << logNumItem;
+
+    for (uint32_t k = 2; k <= 16; k *= 2) {
+        std::vector<std::vector<int64_t>> serverData = genData(numItem, k, 1<<16);
+        std::vector<int64_t> clientData = serverData[numItem / 2];
+        DOPMTDB serverDB = makeDOPMTDB(ctx, serverData, 3);
+        std::vector<DOPSIScratch> arena = makeScratchArena(serverDB);
+        std::vector<int64_t> msgVec = packQuery(ctx, clientData);
+
+        // Packed
+        std::string packedBytes;
+        Ciphertext<DCRTPoly> queryCtxt = queryCompress(ctx, clientData);
+        encodeCtxt(packedBytes, queryCtxt);
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::vector<Ciphertext<DCRTPoly>> extQuery = queryExtract(ctx, queryCtxt, serverDB.maskPtxts);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        double extractTime = std::chrono::duration<double>(t2-t1).count();
+
+        t1 = std::chrono::high_resolution_clock::now();
+        DOPMTServerResponse packedRet = compInterPMTServer(ctx, serverDB, extQuery, arena, 1);
+        t2 = std::chrono::high_resolution_clock::now();
+        double evalTime = std::chrono::duration<double>(t2-t1).count();
+
+        // Replicated
+        std::string replBytes;
+        std::vector<Ciphertext<DCRTPoly>> replCtxts = queryReplicate(ctx, msgVec, k);
+        encodeCtxts(replBytes, replCtxts);
+        DOPMTServerResponse replRet = compInterPMTServer(ctx, serverDB, replCtxts, arena, 1);
+
+        // Seeded; the owner expands the seeds before evaluating
+        std::string seededBytes;
+        std::vector<CtxtSeed> seeds;
+        std::vector<Ciphertext<DCRTPoly>> seededCtxts = queryReplicate(ctx, msgVec, k, &seeds);
+        for (uint32_t j = 0; j < k; j++) {
+            encodeSeededCtxt(seededBytes, seededCtxts[j], seeds[j]);
+        }
+        t1 = std::chrono::high_resolution_clock::now();
+        size_t pos = 0;
+        for (uint32_t j = 0; j < k; j++) {
+            seededCtxts[j] = decodeSeededCtxt(ctx, seededBytes, pos);
+        }
+        t2 = std::chrono::high_resolution_clock::now();
+        double expandTime = std::chrono::duration<double>(t2-t1).count();
+        DOPMTServerResponse seededRet = compInterPMTServer(ctx, serverDB, seededCtxts, arena, 1);
+
+        // Every mode must report the planted item
+        bool isSame = true;
+        for (auto *ret : {&packedRet, &replRet, &seededRet}) {
+            Plaintext retPtxt;
+            ctx.cc->Decrypt(ret->vafOutput, ctx.sk, &retPtxt);
+            isSame = isSame && (retPtxt->GetPackedValue()[0] != 0);
+        }
+
+        double extraMB = ((double)seededBytes.size() - packedBytes.size()) / 1000000;
+        std::cout << "k: " << k
+                  << " | Packed (MB): " << packedBytes.size() / 1000000.0
+                  << " | Replicated (MB): " << replBytes.size() / 1000000.0
+                  << " | Seeded (MB): " << seededBytes.size() / 1000000.0
+                  << " | Extraction: " << extractTime << "s"
+                  << " | Seed Expansion: " << expandTime << "s"
+                  << " | Evaluation: " << evalTime << "s"
+                  << " | Break-even (MB/s): " << extraMB / std::max(extractTime - expandTime, 1e-9)
+                  << (isSame ? "" : " [MISMATCH]") << std::endl;
+    }
+}
+
+
+
+// Benchmark Driver
+namespace {
+
+double elapsedSec(std::chrono::high_resolution_clock::time_point t1) {
+    auto t2 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(t2-t1).count();
+}
+
+typedef std::vector<std::pair<std::string, std::string>> BenchRecord;
+
+// Numbers and booleans are written as is in JSON; everything else is quoted
+std::string jsonValue(const std::string &val) {
+    if (val == "true" || val == "false") {
+        return val;
+    }
+    char *end = nullptr;
+    std::strtod(val.c_str(), &end);
+    if (!val.empty() && *end == '\0') {
+        return val;
+    }
+    return "\"" + val + "\"";
+}
+
+void emitRecord(
+    std::ostream &os,
+    const BenchRecord &record,
+    const std::string &format,
+    bool withHeader
+) {
+    if (format == "csv") {
+        if (withHeader) {
+            for (uint32_t i = 0; i < record.size(); i++) {
+                os << (i ? "," : "") << record[i].first;
+            }
+            os << "\n";
+        }
+        for (uint32_t i = 0; i < record.size(); i++) {
+            os << (i ? "," : "") << record[i].second;
+        }
+        os << std::endl;
+    } else if (format == "json") {
+        os << "{";
+        for (uint32_t i = 0; i < record.size(); i++) {
+            os << (i ? ", " : "") << "\"" << record[i].first << "\": " << jsonValue(record[i].second);
+        }
+        os << "}" << std::endl;
+    } else {
+        for (auto &field : record) {
+            os << field.first << ": " << field.second << std::endl;
+        }
+    }
+}
+
+// Trusted key generation, or a threshold setup with params.numKeyHolders
+FHECTX benchContext(
+    const DOPSIBenchParams &params,
+    uint32_t depth,
+    std::vector<PrivateKey<DCRTPoly>> &shares
+) {
+    if (params.numKeyHolders == 0) {
+        return initParams(65537, depth, params.scalingMod);
+    }
+    return initThresholdParams(65537, depth, params.scalingMod, params.numKeyHolders, shares);
+}
+
+std::vector<int64_t> benchDecrypt(
+    FHECTX &ctx,
+    const std::vector<PrivateKey<DCRTPoly>> &shares,
+    const Ciphertext<DCRTPoly> &ctxt
+) {
+    Plaintext retPtxt;
+    if (shares.empty()) {
+        ctx.cc->Decrypt(ctxt, ctx.sk, &retPtxt);
+    } else {
+        retPtxt = thresholdDecrypt(ctx, shares, ctxt);
+    }
+    return retPtxt->GetPackedValue();
+}
+
+// NPC tree + VAF (16 squarings) + masking at the leader
+uint32_t benchDepth(const DOPSIBenchParams &params) {
+    if (params.depth != 0) {
+        return params.depth;
+    }
+    uint32_t npcWidth = (params.mode == 0) ? params.itemLen : params.numRand;
+    return (uint32_t)std::ceil(std::log2(npcWidth)) + 16 + 1;
+}
+
+// Counts the client items expected in, found in and misreported for the
+// server set; slots is the client's plaintext table in PSI mode
+void checkResult(
+    const DOPSIBenchParams &params,
+    FHECTX &ctx,
+    const std::vector<int64_t> &retVec,
+    const std::vector<int64_t> &slots,
+    const std::vector<std::vector<int64_t>> &clientData,
+    const std::set<std::vector<int64_t>> &serverSet,
+    uint32_t &numExpected,
+    uint32_t &numFound,
+    uint32_t &numWrong
+) {
+    numExpected = 0, numFound = 0, numWrong = 0;
+    if (params.isPSI) {
+        uint32_t numBins = ctx.ringDim / params.itemLen;
+        for (uint32_t b = 0; b < numBins; b++) {
+            if (slots[b] == -1) {
+                continue;
+            }
+            std::vector<int64_t> item(params.itemLen);
+            for (uint32_t j = 0; j < params.itemLen; j++) {
+                item[j] = slots[b + numBins * j];
+            }
+            bool isExpected = serverSet.count(item) > 0;
+            bool isFound = retVec[b] != 0;
+            numExpected += isExpected;
+            numFound += isFound;
+            numWrong += (isExpected != isFound);
+        }
+    } else {
+        // Slot g answers the g-th packed client item
+        for (uint32_t g = 0; g < clientData.size(); g++) {
+            bool isExpected = serverSet.count(clientData[g]) > 0;
+            bool isFound = retVec[g] != 0;
+            numExpected += isExpected;
+            numFound += isFound;
+            numWrong += (isExpected != isFound);
+        }
+    }
+}
+
+// Times one mask multiplication and one rotation of the extraction
+QueryCostModel calibrateQueryCost(
+    FHECTX &ctx,
+    const DOPMTDB &DB,
+    uint32_t numThreads,
+    uint32_t bandwidth
+) {
+    uint32_t k = DB.maskPtxts.size();
+    Ciphertext<DCRTPoly> x = encryptPtxt(ctx, DB.ptOne);
+    uint32_t numReps = 4;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t r = 0; r < numReps; r++) {
+        ctx.cc->EvalMult(x, DB.maskPtxts[r % k]);
+    }
+    double ptMultTime = elapsedSec(t1) / numReps;
+
+    t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t r = 0; r < numReps; r++) {
+        ctx.cc->EvalRotate(x, ctx.ringDim / k);
+    }
+    double rotTime = elapsedSec(t1) / numReps;
+
+    return QueryCostModel {(double)bandwidth * 1000000, ptMultTime, rotTime, numThreads};
+}
+
+// Per-tower operation costs on a response; bandwidth in MB/s, 0 for threads
+AggCostModel calibrateAggCost(
+    FHECTX &ctx,
+    const DOPMTServerResponse &sample,
+    uint32_t numThreads,
+    uint32_t bandwidth,
+    double hopLatency
+) {
+    uint32_t numReps = 4;
+    double towers = sample.vafOutput->GetElements()[0].GetNumOfElements();
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t r = 0; r < numReps; r++) {
+        ctx.cc->EvalAdd(sample.vafOutput, sample.maskCtxt);
+    }
+    double addTime = elapsedSec(t1) / numReps / towers;
+
+    Ciphertext<DCRTPoly> prod;
+    t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t r = 0; r < numReps; r++) {
+        prod = ctx.cc->EvalMult(sample.vafOutput, sample.maskCtxt);
+    }
+    double multTime = elapsedSec(t1) / numReps / towers;
+
+    t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t r = 0; r < numReps; r++) {
+        ctx.cc->Compress(prod, 1);
+    }
+    double compressTime = elapsedSec(t1) / numReps / towers;
+
+    return AggCostModel {
+        addTime, multTime, compressTime, wireSize(sample.vafOutput) / towers,
+        (double)bandwidth * 1000000, hopLatency, numThreads
+    };
+}
+
+// Plan of the leader aggregation; one level with every party when flat
+AggTreePlan benchAggPlan(
+    const DOPSIBenchParams &params,
+    const AggCostModel &model,
+    uint32_t numTowers
+) {
+    if (params.autoFanOut) {
+        return planAggTree(model, params.numParties, AggOp::SUM, 2, numTowers);
+    }
+    return makeAggTreePlan(params.numParties, params.fanOut, AggOp::SUM);
+}
+
+} // namespace
+
+void runDOPSIBench(const DOPSIBenchParams &params) {
+    if (params.numThreads > 0) {
+        omp_set_num_threads(params.numThreads);
+    }
+    uint32_t numThreads = omp_get_max_threads();
+
+    uint32_t depth = benchDepth(params);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<PrivateKey<DCRTPoly>> shares;
+    FHECTX ctx = benchContext(params, depth, shares);
+    double keygenTime = elapsedSec(t1);
+
+    // Data; some client items are planted in the server set
+    uint32_t numItem = 1 << params.logNumItem;
+    uint32_t numClient = params.isPSI ? params.numClient : params.numPack;
+    uint32_t numInter = std::min({params.numInter, numClient, numItem});
+
+    std::vector<std::vector<int64_t>> serverData = genData(numItem, params.itemLen, 1<<16);
+    std::vector<std::vector<int64_t>> clientData = genData(numClient, params.itemLen, 1<<16);
+    for (uint32_t i = 0; i < numInter; i++) {
+        serverData[i * (numItem / numInter)] = clientData[i];
+    }
+    std::set<std::vector<int64_t>> serverSet(serverData.begin(), serverData.end());
+
+    // Server Setup
+    double tableTime = 0;
+    DOPMTDB serverDB;
+    if (params.isPSI) {
+        uint32_t maxBin = computeMaxBinLoad(ctx.ringDim / params.itemLen, numItem, 3);
+        t1 = std::chrono::high_resolution_clock::now();
+        SimpleHashTable hashTable = computeCuckooHashTableServer(
+            serverData, ctx.ringDim, maxBin, -1, 3
+        );
+        tableTime = elapsedSec(t1);
+
+        t1 = std::chrono::high_resolution_clock::now();
+        serverDB = makeDOPSIDB(ctx, hashTable, params.alpha);
+    } else {
+        t1 = std::chrono::high_resolution_clock::now();
+        serverDB = makeDOPMTDB(ctx, serverData, params.alpha, params.numPack);
+    }
+    double dbTime = elapsedSec(t1);
+    std::vector<DOPSIScratch> arena = makeScratchArena(serverDB, numThreads, params.numRand);
+
+    // Query mode; auto weighs the extraction against the extra upload
+    uint32_t k = serverDB.maskPtxts.size();
+    QueryMode queryMode = QueryMode::PACKED;
+    if (params.queryMode == "replicated") {
+        queryMode = QueryMode::REPLICATED;
+    } else if (params.queryMode == "seeded") {
+        queryMode = QueryMode::SEEDED;
+    } else if (params.queryMode == "auto") {
+        QueryCostModel model = calibrateQueryCost(ctx, serverDB, numThreads, params.bandwidth);
+        Ciphertext<DCRTPoly> probe = encryptPtxt(ctx, serverDB.ptOne);
+        queryMode = chooseQueryMode(model, k, wireSize(probe), ctx.sk != nullptr);
+    }
+
+    std::ofstream outFile;
+    if (!params.outPath.empty()) {
+        outFile.open(params.outPath, std::ios::app);
+        if (!outFile) {
+            throw std::runtime_error("Cannot open " + params.outPath);
+        }
+    }
+    std::ostream &os = params.outPath.empty() ? std::cout : outFile;
+    bool withHeader = params.outPath.empty() || outFile.tellp() == 0;
+
+    for (uint32_t rep = 0; rep < params.numReps; rep++) {
+        // Client
+        std::vector<int64_t> slots;
+        std::vector<Ciphertext<DCRTPoly>> extQuery;
+        std::vector<CtxtSeed> seeds;
+        std::string uploadBytes;
+        size_t querySize = 0;
+        double queryTime, extractTime;
+        if (queryMode == QueryMode::PACKED) {
+            t1 = std::chrono::high_resolution_clock::now();
+            Ciphertext<DCRTPoly> queryCtxt = params.isPSI
+                ? queryCompressTable(ctx, clientData, nullptr, &slots)
+                : queryCompressMulti(ctx, clientData);
+            encodeCtxt(uploadBytes, queryCtxt);
+            queryTime = elapsedSec(t1);
+            querySize = ctxtSize(queryCtxt);
+
+            // Data Owners
+            t1 = std::chrono::high_resolution_clock::now();
+            extQuery = queryExtract(ctx, queryCtxt, serverDB.maskPtxts);
+            extractTime = elapsedSec(t1);
+        } else {
+            bool isSeeded = (queryMode == QueryMode::SEEDED);
+            t1 = std::chrono::high_resolution_clock::now();
+            slots = params.isPSI
+                ? computeCuckooHashTableClient(clientData, ctx.ringDim, -1)
+                : packQueryMulti(ctx, clientData);
+            std::vector<Ciphertext<DCRTPoly>> replCtxts = queryReplicate(
+                ctx, slots, k, isSeeded ? &seeds : nullptr
+            );
+            for (uint32_t j = 0; j < k; j++) {
+                if (isSeeded) {
+                    encodeSeededCtxt(uploadBytes, replCtxts[j], seeds[j]);
+                } else {
+                    encodeCtxt(uploadBytes, replCtxts[j]);
+                }
+                querySize += ctxtSize(replCtxts[j]);
+            }
+            queryTime = elapsedSec(t1);
+
+            // Data Owners; a seeded query is expanded on arrival
+            t1 = std::chrono::high_resolution_clock::now();
+            if (isSeeded) {
+                size_t pos = 0;
+                for (uint32_t j = 0; j < k; j++) {
+                    extQuery.push_back(decodeSeededCtxt(ctx, uploadBytes, pos));
+                }
+            } else {
+                extQuery = replCtxts;
+            }
+            extractTime = elapsedSec(t1);
+        }
+
+        t1 = std::chrono::high_resolution_clock::now();
+        Ciphertext<DCRTPoly> vafOutput = compInterChunks(
+            ctx, serverDB, extQuery, arena, params.mode
+        );
+        DOPMTServerResponse response = makeServerResponse(
+            ctx, vafOutput, extQuery.size(), params.isPSI, serverDB.numPack
+        );
+        double evalTime = elapsedSec(t1);
+
+        // Every party replies with this response and a fresh mask
+        std::vector<DOPMTServerResponse> responses(params.numParties, response);
+        for (uint32_t i = 1; i < params.numParties; i++) {
+            Ciphertext<DCRTPoly> maskCtxt = makeRandCtxt(ctx);
+            responses[i].maskCtxt = ctx.cc->Compress(maskCtxt, 3);
+        }
+
+        // Leader; a tree of threads when a fan-out is set
+        AggTreePlan plan = makeAggTreePlan(params.numParties, 0, AggOp::SUM);
+        bool isTree = params.autoFanOut || params.fanOut > 0;
+        if (isTree) {
+            uint32_t numTowers = response.vafOutput->GetElements()[0].GetNumOfElements();
+            AggCostModel model = calibrateAggCost(ctx, response, numThreads, 0, 0);
+            plan = benchAggPlan(params, model, numTowers);
+        }
+        t1 = std::chrono::high_resolution_clock::now();
+        Ciphertext<DCRTPoly> aggCtxt = isTree
+            ? compAggLeader(ctx, responses, plan)
+            : compAggLeader(ctx, responses);
+        double aggTime = elapsedSec(t1);
+
+        t1 = std::chrono::high_resolution_clock::now();
+        std::vector<int64_t> retVec = benchDecrypt(ctx, shares, aggCtxt);
+        double decTime = elapsedSec(t1);
+
+        // Compare with the plaintext intersection
+        uint32_t numExpected, numFound, numWrong;
+        checkResult(params, ctx, retVec, slots, clientData, serverSet, numExpected, numFound, numWrong);
+
+        size_t responseSize = ctxtSize(response.vafOutput) + ctxtSize(response.maskCtxt);
+
+        BenchRecord record = {
+            {"protocol", params.isPSI ? "PSI" : "PMT"},
+            {"logNumItem", std::to_string(params.logNumItem)},
+            {"itemLen", std::to_string(params.itemLen)},
+            {"numClient", std::to_string(numClient)},
+            {"mode", std::to_string(params.mode)},
+            {"numRand", std::to_string(params.numRand)},
+            {"numThreads", std::to_string(numThreads)},
+            {"numParties", std::to_string(params.numParties)},
+            {"keyHolders", std::to_string(params.numKeyHolders)},
+            {"queryMode", queryModeName(queryMode)},
+            {"aggTree", describeAggTree(plan)},
+            {"rep", std::to_string(rep)},
+            {"depth", std::to_string(depth)},
+            {"numChunks", std::to_string(serverDB.payload.size())},
+            {"keygen", std::to_string(keygenTime)},
+            {"tableBuild", std::to_string(tableTime)},
+            {"dbEncrypt", std::to_string(dbTime)},
+            {"queryBuild", std::to_string(queryTime)},
+            {"extraction", std::to_string(extractTime)},
+            {"evaluation", std::to_string(evalTime)},
+            {"aggregation", std::to_string(aggTime)},
+            {"decrypt", std::to_string(decTime)},
+            {"querySizeMB", std::to_string((double)querySize / 1000000)},
+            {"uploadMB", std::to_string((double)uploadBytes.size() / 1000000)},
+            {"responseSizeMB", std::to_string((double)responseSize / 1000000)},
+            {"expected", std::to_string(numExpected)},
+            {"found", std::to_string(numFound)},
+            {"wrong", std::to_string(numWrong)},
+            {"correct", numWrong == 0 ? "true" : "false"}
+        };
+        emitRecord(os, record, params.format, withHeader && rep == 0);
+    }
+}
+
+void runDOPSICluster(const DOPSIBenchParams &params) {
+    if (params.numThreads > 0) {
+        omp_set_num_threads(params.numThreads);
+    }
+    uint32_t numParties = params.numParties;
+    uint32_t depth = benchDepth(params);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<PrivateKey<DCRTPoly>> shares;
+    FHECTX ctx = benchContext(params, depth, shares);
+    double keygenTime = elapsedSec(t1);
+
+    // Data; the server set is dealt round-robin to the owners
+    uint32_t numItem = 1 << params.logNumItem;
+    uint32_t numClient = params.isPSI ? params.numClient : params.numPack;
+    uint32_t numInter = std::min({params.numInter, numClient, numItem});
+    if (numItem < numParties) {
+        throw std::runtime_error("Every data owner needs at least one item");
+    }
+
+    std::vector<std::vector<int64_t>> serverData = genData(numItem, params.itemLen, 1<<16);
+    std::vector<std::vector<int64_t>> clientData = genData(numClient, params.itemLen, 1<<16);
+    for (uint32_t i = 0; i < numInter; i++) {
+        serverData[i * (numItem / numInter)] = clientData[i];
+    }
+    std::set<std::vector<int64_t>> serverSet(serverData.begin(), serverData.end());
+
+    std::vector<std::vector<std::vector<int64_t>>> shards(numParties);
+    for (uint32_t i = 0; i < numItem; i++) {
+        shards[i % numParties].push_back(serverData[i]);
+    }
+
+    // Aggregation tree; the root level is the leader
+    AggTreePlan plan = makeAggTreePlan(numParties, 0, AggOp::SUM);
+    if (params.autoFanOut || params.fanOut > 0) {
+        Ciphertext<DCRTPoly> r1 = makeRandCtxt(ctx), r2 = makeRandCtxt(ctx);
+        DOPMTServerResponse sample {ctx.cc->Compress(r1, 3), ctx.cc->Compress(r2, 3)};
+        // One process wake-up and connect per level
+        AggCostModel model = calibrateAggCost(ctx, sample, omp_get_max_threads(), params.bandwidth, 1e-3);
+        plan = benchAggPlan(params, model, 3);
+    }
+    uint32_t numLevels = plan.levels.size();
+
+    // Launch the leader, the tree nodes and the owners
+    raiseFdLimit(2 * numParties + 64);
+    std::string sockPrefix = "/tmp/dopsi_" + std::to_string(getpid());
+    std::string leaderPath = sockPrefix + "_leader.sock";
+    std::string ctxPath = sockPrefix + "_ctx.bin";
+    saveClusterContext(ctx, ctxPath);
+    std::vector<std::vector<std::string>> nodePaths(numLevels);
+    std::vector<std::vector<int>> nodeFds(numLevels);
+    std::vector<int> listenFds;
+    for (uint32_t l = 0; l < numLevels; l++) {
+        for (uint32_t n = 0; n < plan.levels[l].numNodes; n++) {
+            std::string path = (l + 1 == numLevels)
+                ? leaderPath
+                : sockPrefix + "_agg_" + std::to_string(l) + "_" + std::to_string(n) + ".sock";
+            nodePaths[l].push_back(path);
+            nodeFds[l].push_back(makeListenSocket(path, plan.levels[l].fanOut));
+            listenFds.push_back(nodeFds[l].back());
+        }
+    }
+    int leaderFds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, leaderFds) < 0) {
+        throw std::runtime_error("Cannot create a socket pair");
+    }
+
+    // Children of node n of level l
+    auto numChildren = [&](uint32_t l, uint32_t n) {
+        uint32_t numIn = (l == 0) ? numParties : plan.levels[l - 1].numNodes;
+        return std::min(plan.levels[l].fanOut, numIn - n * plan.levels[l].fanOut);
+    };
+    auto otherFds = [&](int keepFd) {
+        std::vector<int> fds = {leaderFds[0]};
+        for (int fd : listenFds) {
+            if (fd != keepFd) {
+                fds.push_back(fd);
+            }
+        }
+        return fds;
+    };
+
+    std::vector<pid_t> pids;
+    int listenFd = nodeFds[numLevels - 1][0];
+    pids.push_back(spawnLeader(
+        ctxPath, numParties, params.numReps, listenFd, leaderFds[1], otherFds(listenFd),
+        numChildren(numLevels - 1, 0)
+    ));
+    close(leaderFds[1]);
+    for (uint32_t l = 0; l + 1 < numLevels; l++) {
+        for (uint32_t n = 0; n < plan.levels[l].numNodes; n++) {
+            const std::string &parentPath = nodePaths[l + 1][n / plan.levels[l + 1].fanOut];
+            pids.push_back(spawnAggNode(
+                ctxPath, numChildren(l, n), params.numReps, plan.levels[l].numTowers,
+                nodeFds[l][n], parentPath, otherFds(nodeFds[l][n])
+            ));
+        }
+    }
+    for (int fd : listenFds) {
+        close(fd);
+    }
+
+    t1 = std::chrono::high_resolution_clock::now();
+    std::vector<int> ownerFds;
+    for (uint32_t p = 0; p < numParties; p++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            throw std::runtime_error("Cannot create a socket pair");
+        }
+        std::vector<int> closeFds = ownerFds;
+        closeFds.push_back(leaderFds[0]);
+        closeFds.push_back(fds[0]);
+
+        DOPSIOwnerConfig cfg = {
+            p, params.isPSI, params.itemLen, params.numPack, params.mode, params.numRand,
+            params.ownerThreads, params.numReps, params.alpha
+        };
+        const std::string &parentPath = nodePaths[0][p / plan.levels[0].fanOut];
+        pids.push_back(spawnDataOwner(ctxPath, cfg, shards[p], fds[1], closeFds, parentPath));
+        close(fds[1]);
+        ownerFds.push_back(fds[0]);
+    }
+    shards.clear();
+
+    double maxDBTime = 0;
+    for (int fd : ownerFds) {
+        std::string ready = recvFrame(fd);
+        size_t pos = 0;
+        maxDBTime = std::max(maxDBTime, getVal<double>(ready, pos));
+    }
+    double setupTime = elapsedSec(t1);
+
+    std::ofstream outFile;
+    if (!params.outPath.empty()) {
+        outFile.open(params.outPath, std::ios::app);
+        if (!outFile) {
+            throw std::runtime_error("Cannot open " + params.outPath);
+        }
+    }
+    std::ostream &os = params.outPath.empty() ? std::cout : outFile;
+    bool withHeader = params.outPath.empty() || outFile.tellp() == 0;
+
+    for (uint32_t rep = 0; rep < params.numReps; rep++) {
+        // Client
+        std::vector<int64_t> slots;
+        t1 = std::chrono::high_resolution_clock::now();
+        Ciphertext<DCRTPoly> queryCtxt = params.isPSI
+            ? queryCompressTable(ctx, clientData, nullptr, &slots)
+            : queryCompressMulti(ctx, clientData);
+        std::string queryBytes;
+        encodeCtxt(queryBytes, queryCtxt);
+        double queryTime = elapsedSec(t1);
+
+        for (int fd : ownerFds) {
+            sendFrame(fd, queryBytes);
+        }
+
+        Ciphertext<DCRTPoly> aggCtxt;
+        DOPSILeaderStats stats;
+        size_t resultSize = recvLeaderReply(ctx, leaderFds[0], aggCtxt, stats);
+
+        std::vector<int64_t> retVec = benchDecrypt(ctx, shares, aggCtxt);
+        double totalTime = elapsedSec(t1);
+
+        uint32_t numExpected, numFound, numWrong;
+        checkResult(params, ctx, retVec, slots, clientData, serverSet, numExpected, numFound, numWrong);
+
+        double minEval = stats.parties[0].evalTime, maxEval = 0, sumEval = 0;
+        for (auto &party : stats.parties) {
+            minEval = std::min(minEval, party.evalTime);
+            maxEval = std::max(maxEval, party.evalTime);
+            sumEval += party.evalTime;
+        }
+        size_t querySize = (queryBytes.size() + sizeof(uint64_t)) * numParties;
+
+        BenchRecord record = {
+            {"protocol", params.isPSI ? "PSI" : "PMT"},
+            {"logNumItem", std::to_string(params.logNumItem)},
+            {"itemLen", std::to_string(params.itemLen)},
+            {"numClient", std::to_string(numClient)},
+            {"mode", std::to_string(params.mode)},
+            {"numParties", std::to_string(numParties)},
+            {"keyHolders", std::to_string(params.numKeyHolders)},
+            {"ownerThreads", std::to_string(params.ownerThreads)},
+            {"aggTree", describeAggTree(plan)},
+            {"rep", std::to_string(rep)},
+            {"depth", std::to_string(depth)},
+            {"keygen", std::to_string(keygenTime)},
+            {"ownerSetup", std::to_string(setupTime)},
+            {"maxDBBuild", std::to_string(maxDBTime)},
+            {"queryBuild", std::to_string(queryTime)},
+            {"endToEnd", std::to_string(totalTime)},
+            {"minEval", std::to_string(minEval)},
+            {"avgEval", std::to_string(sumEval / numParties)},
+            {"maxEval", std::to_string(maxEval)},
+            {"leaderCPU", std::to_string(stats.cpuTime)},
+            {"leaderTail", std::to_string(stats.tailTime)},
+            {"queryBytes", std::to_string(querySize)},
+            {"responseBytes", std::to_string(stats.bytesIn)},
+            {"resultBytes", std::to_string(resultSize)},
+            {"expected", std::to_string(numExpected)},
+            {"found", std::to_string(numFound)},
+            {"wrong", std::to_string(numWrong)},
+            {"correct", numWrong == 0 ? "true" : "false"}
+        };
+        emitRecord(os, record, params.format, withHeader && rep == 0);
+    }
+
+    for (int fd : ownerFds) {
+        close(fd);
+    }
+    close(leaderFds[0]);
+    unlink(ctxPath.c_str());
+    for (auto &paths : nodePaths) {
+        for (auto &path : paths) {
+            unlink(path.c_str());
+        }
+    }
+
+    uint32_t numFailed = 0;
+    for (pid_t pid : pids) {
+        int status;
+        waitpid(pid, &status, 0);
+        numFailed += !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    if (numFailed > 0) {
+        throw std::runtime_error(std::to_string(numFailed) + " cluster processes failed");
+    }
+}
+
+
+// Flat leader against aggregation trees of threads, for the sums of DO-PSI
+// and the products of APSI, with 4, 16, ..., 2^logMaxParties parties
+void testAggTree(uint32_t logMaxParties) {
+    FHECTX ctx = initParams(65537, logMaxParties + 2, 60);
+    uint32_t numThreads = omp_get_max_threads();
+
+    for (uint32_t numParties = 4; numParties <= (1U << logMaxParties); numParties *= 4) {
+        // DO-PSI: sum of (isInter, mask) then one product
+        std::vector<DOPMTServerResponse> responses(numParties);
+        std::vector<int64_t> expSum(ctx.ringDim, 0), expMask(ctx.ringDim, 0);
+        for (auto &response : responses) {
+            std::vector<std::vector<int64_t>> msgs = genData(2, ctx.ringDim, 16);
+            for (uint32_t j = 0; j < ctx.ringDim; j++) {
+                expSum[j] += msgs[0][j];
+                expMask[j] += msgs[1][j];
+            }
+            Ciphertext<DCRTPoly> x = encryptPtxt(ctx, ctx.cc->MakePackedPlaintext(msgs[0]));
+            Ciphertext<DCRTPoly> y = encryptPtxt(ctx, ctx.cc->MakePackedPlaintext(msgs[1]));
+            response = DOPMTServerResponse {ctx.cc->Compress(x, 3), ctx.cc->Compress(y, 3)};
+        }
+        AggCostModel model = calibrateAggCost(ctx, responses[0], numThreads, 0, 0);
+
+        std::vector<std::pair<std::string, AggTreePlan>> sumPlans = {
+            {"flat", makeAggTreePlan(numParties, 0, AggOp::SUM)},
+            {"fan-out 4", makeAggTreePlan(numParties, 4, AggOp::SUM)},
+            {"auto", planAggTree(model, numParties, AggOp::SUM, 2, 3)}
+        };
+        for (auto &p : sumPlans) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            Ciphertext<DCRTPoly> ret = compAggLeader(ctx, responses, p.second);
+            double tdiff = elapsedSec(t1);
+
+            Plaintext retPtxt;
+            ctx.cc->Decrypt(ret, ctx.sk, &retPtxt);
+            std::vector<int64_t> retVec = retPtxt->GetPackedValue();
+            uint32_t numWrong = 0;
+            for (uint32_t j = 0; j < ctx.ringDim; j++) {
+                int64_t exp = (expSum[j] * expMask[j]) % ctx.modulus;
+                numWrong += (exp != ((retVec[j] % ctx.modulus) + ctx.modulus) % ctx.modulus);
+            }
+            std::cout << "Sum | Parties: " << numParties << " | " << p.first
+                      << " (" << describeAggTree(p.second) << ")"
+                      << " | Time: " << tdiff << "s | Wrong: " << numWrong << std::endl;
+        }
+
+        // APSI: product over the parties of every chunk
+        uint32_t numTowers = std::max<uint32_t>(3, ceilLog2(numParties));
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> chunks(numParties);
+        std::vector<int64_t> expProd(ctx.ringDim, 1);
+        for (auto &chunk : chunks) {
+            std::vector<int64_t> msg = genData(1, ctx.ringDim, 16)[0];
+            for (uint32_t j = 0; j < ctx.ringDim; j++) {
+                msg[j] += 1;
+                expProd[j] = (expProd[j] * msg[j]) % ctx.modulus;
+            }
+            Ciphertext<DCRTPoly> x = encryptPtxt(ctx, ctx.cc->MakePackedPlaintext(msg));
+            chunk = {ctx.cc->Compress(x, numTowers)};
+        }
+
+        std::vector<std::pair<std::string, AggTreePlan>> prodPlans = {
+            {"flat", makeAggTreePlan(numParties, 0, AggOp::PRODUCT)},
+            {"fan-out 4", makeAggTreePlan(numParties, 4, AggOp::PRODUCT)},
+            {"auto", planAggTree(model, numParties, AggOp::PRODUCT, 1, numTowers)}
+        };
+        for (auto &p : prodPlans) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            std::vector<Ciphertext<DCRTPoly>> ret = runAggTree(ctx.cc, p.second, AggOp::PRODUCT, chunks);
+            double tdiff = elapsedSec(t1);
+
+            Plaintext retPtxt;
+            ctx.cc->Decrypt(ret[0], ctx.sk, &retPtxt);
+            std::vector<int64_t> retVec = retPtxt->GetPackedValue();
+            uint32_t numWrong = 0;
+            for (uint32_t j = 0; j < ctx.ringDim; j++) {
+                numWrong += (expProd[j] != ((retVec[j] % ctx.modulus) + ctx.modulus) % ctx.modulus);
+            }
+            std::cout << "Product | Parties: " << numParties << " | " << p.first
+                      << " (" << describeAggTree(p.second) << ")"
+                      << " | Time: " << tdiff << "s | Wrong: " << numWrong << std::endl;
+        }
+    }
+}
@@ -3,8 +3,55 @@
 
 #include "server.h"
 #include "client.h"
+#include "cluster.h"
+#include <string>
 
 void testDOPMT(uint32_t logNumItem);
 void testDOPSI(uint32_t logNumItem);
+void testHashTableBuild(uint32_t logNumItem);
+void testCuckooInsert(uint32_t logNumItem);
+void testPermHashing(uint32_t logNumItem);
+void testDBReuse(uint32_t logNumItem);
+void testWireFormat(uint32_t logNumItem);
+void testThresholdDecrypt(uint32_t logMaxHolders);
+void testMultiPMT(uint32_t logNumItem);
+void testQueryReplication(uint32_t logNumItem);
+void testAggTree(uint32_t logMaxParties);
+
+// Knobs of the benchmark driver; see DOPSI/main.cpp for the flags
+struct DOPSIBenchParams {
+    bool isPSI = true;
+    uint32_t logNumItem = 16;
+    uint32_t itemLen = 8;       // 16-bit words per item
+    uint32_t numClient = 2048;  // PSI only
+    uint32_t numPack = 1;       // PMT only; client items packed in one query
+    uint32_t numInter = 16;     // client items planted in the server set
+    uint32_t mode = 1;          // 0: exact NPC, 1: probabilistic NPC
+    uint32_t numRand = DOPSI_NUM_RAND;
+    uint32_t numThreads = 0;    // 0: OpenMP default
+    uint32_t numReps = 1;
+    uint32_t numParties = 1;
+    uint32_t numKeyHolders = 0; // 0: trusted KeyGen, otherwise threshold keys
+    bool cluster = false;       // one process per data owner
+    uint32_t ownerThreads = 1;  // OpenMP threads per owner process
+    std::string queryMode = "packed"; // packed, replicated, seeded or auto
+    uint32_t bandwidth = 100;   // link bandwidth in MB/s, for the cost models
+    uint32_t fanOut = 0;        // aggregation tree fan-out; 0: flat leader
+    bool autoFanOut = false;    // fan-out and compression from the cost model
+    uint32_t depth = 0;         // 0: computed from the parameters
+    uint32_t scalingMod = 60;
+    int64_t alpha = 3;
+    std::string format = "text"; // text, csv or json
+    std::string outPath = "";    // empty: stdout
+};
+
+// Times every phase, checks the result against the plaintext intersection
+// and emits one record per repetition
+void runDOPSIBench(const DOPSIBenchParams &params);
+
+// Launches numParties data owners and a leader that talk over Unix-domain
+// sockets; reports end-to-end latency, per-party compute, bytes on the wire
+// and leader CPU time
+void runDOPSICluster(const DOPSIBenchParams &params);
 
 #endif
\ No newline at end of file
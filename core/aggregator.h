@@ -0,0 +1,150 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include "openfhe.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <omp.h>
+
+using namespace lbcrypto;
+
+// Streaming leader aggregation: computes (sum_i isInter_i) * (sum_i mask_i)
+// while responses arrive one at a time from concurrent producers.
+// Each response is folded into one of a few sharded running sums, so the
+// leader keeps O(numShards) ciphertexts regardless of the party count.
+// The producer delivering the last response merges the shards and performs
+// the single multiplication; finalize() waits for that result.
+// With isPartial, the multiplication is skipped and finalizeSums() returns
+// the two sums, for intermediate nodes of an aggregation tree (aggtree.h).
+class StreamingAggregator {
+public:
+    StreamingAggregator(
+        CryptoContext<DCRTPoly> cc,
+        uint32_t numParties,
+        uint32_t numShards = 0,
+        bool isPartial = false
+    ) : cc(cc), numParties(numParties), isPartial(isPartial), arrived(0), nextShard(0), isDone(false) {
+        if (numParties == 0) {
+            throw std::runtime_error("Aggregation needs at least one party");
+        }
+        if (numShards == 0) {
+            numShards = omp_get_max_threads();
+        }
+        this->numShards = std::min(numShards, numParties);
+        shards.reset(new Shard[this->numShards]);
+    }
+
+    // Thread-safe; returns true for the call that completed the aggregation.
+    bool add(
+        const Ciphertext<DCRTPoly> &isInter,
+        const Ciphertext<DCRTPoly> &mask
+    ) {
+        // Take the first free shard, starting from a rotating position
+        uint32_t start = nextShard.fetch_add(1, std::memory_order_relaxed) % numShards;
+        Shard *shard = nullptr;
+        for (uint32_t i = 0; i < numShards; i++) {
+            Shard &cand = shards[(start + i) % numShards];
+            if (cand.lock.try_lock()) {
+                shard = &cand;
+                break;
+            }
+        }
+        if (shard == nullptr) {
+            shard = &shards[start];
+            shard->lock.lock();
+        }
+
+        if (!shard->isInter) {
+            shard->isInter = isInter->Clone();
+            shard->mask = mask->Clone();
+        } else {
+            cc->EvalAddInPlace(shard->isInter, isInter);
+            cc->EvalAddInPlace(shard->mask, mask);
+        }
+        shard->lock.unlock();
+
+        uint32_t numArrived = arrived.fetch_add(1) + 1;
+        if (numArrived > numParties) {
+            throw std::runtime_error("More responses than parties");
+        }
+        if (numArrived < numParties) {
+            return false;
+        }
+
+        // Last arrival: every other add has released its shard already
+        Ciphertext<DCRTPoly> isInterAgg, maskAgg;
+        for (uint32_t i = 0; i < numShards; i++) {
+            if (!shards[i].isInter) {
+                continue;
+            }
+            if (!isInterAgg) {
+                isInterAgg = shards[i].isInter;
+                maskAgg = shards[i].mask;
+            } else {
+                cc->EvalAddInPlace(isInterAgg, shards[i].isInter);
+                cc->EvalAddInPlace(maskAgg, shards[i].mask);
+            }
+            shards[i].isInter = nullptr;
+            shards[i].mask = nullptr;
+        }
+        Ciphertext<DCRTPoly> ret = isPartial ? nullptr : cc->EvalMult(isInterAgg, maskAgg);
+
+        {
+            std::lock_guard<std::mutex> guard(resultLock);
+            result = ret;
+            sumInter = isInterAgg;
+            sumMask = maskAgg;
+            isDone = true;
+        }
+        resultReady.notify_all();
+        return true;
+    }
+
+    // Blocks until every party has been added.
+    Ciphertext<DCRTPoly> finalize() {
+        std::unique_lock<std::mutex> guard(resultLock);
+        resultReady.wait(guard, [this] { return isDone; });
+        if (isPartial) {
+            throw std::runtime_error("Partial aggregation has no product; use finalizeSums");
+        }
+        return result;
+    }
+
+    // Blocks until every party has been added; returns (sum isInter, sum mask)
+    std::pair<Ciphertext<DCRTPoly>, Ciphertext<DCRTPoly>> finalizeSums() {
+        std::unique_lock<std::mutex> guard(resultLock);
+        resultReady.wait(guard, [this] { return isDone; });
+        return std::make_pair(sumInter, sumMask);
+    }
+
+    uint32_t getNumArrived() const {
+        return std::min<uint32_t>(arrived.load(), numParties);
+    }
+
+private:
+    struct Shard {
+        std::mutex lock;
+        Ciphertext<DCRTPoly> isInter;
+        Ciphertext<DCRTPoly> mask;
+    };
+
+    CryptoContext<DCRTPoly> cc;
+    uint32_t numParties;
+    bool isPartial;
+    uint32_t numShards;
+    std::unique_ptr<Shard[]> shards;
+
+    std::atomic<uint32_t> arrived;
+    std::atomic<uint32_t> nextShard;
+
+    std::mutex resultLock;
+    std::condition_variable resultReady;
+    bool isDone;
+    Ciphertext<DCRTPoly> result;
+    Ciphertext<DCRTPoly> sumInter;
+    Ciphertext<DCRTPoly> sumMask;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef AGGTREE_H
+#define AGGTREE_H
+
+#include "openfhe.h"
+#include <cmath>
+#include <omp.h>
+
+using namespace lbcrypto;
+
+// Hierarchical aggregation: the parties are the leaves, and every node of
+// level l combines up to fanOut partials of level l-1 (the leaves for l = 0)
+// into one partial for its parent. Partials are vectors of ciphertexts that
+// are combined element-wise, by sums (DO-PSI) or products (APSI).
+// A single level with fanOut = numParties is the flat single-leader topology.
+
+enum class AggOp {
+    SUM,
+    PRODUCT
+};
+
+struct AggTreeLevel {
+    uint32_t numNodes;
+    uint32_t fanOut;       // children per node; the last node may have fewer
+    uint32_t numTowers;    // Compress target of the forwarded partials; 0 keeps them
+};
+
+struct AggTreePlan {
+    std::vector<AggTreeLevel> levels;   // leaves to root; the root is last
+    double estTime;                     // planAggTree only
+};
+
+// Per-tower costs of one ciphertext operation, and the links between nodes
+struct AggCostModel {
+    double addTime;
+    double multTime;
+    double compressTime;
+    double towerBytes;     // bytes of one tower of one ciphertext on the wire
+    double bandwidth;      // inbound bytes per second of a node; 0 for shared memory
+    double hopLatency;     // seconds per level, e.g. process wake-up and connect
+    uint32_t numThreads;   // workers shared by the nodes of a level
+};
+
+inline uint32_t ceilLog2(uint64_t x) {
+    uint32_t ret = 0;
+    while ((1ULL << ret) < x) {
+        ret++;
+    }
+    return ret;
+}
+
+// Tree with the given fan-out; product partials are compressed at every level
+// to the towers of their remaining depth, like compInterPtxt does for the
+// parties, and the root to finalTowers. Sums are not compressed.
+inline AggTreePlan makeAggTreePlan(
+    uint32_t numParties,
+    uint32_t fanOut,
+    AggOp op,
+    uint32_t finalTowers = 3
+) {
+    if (numParties == 0) {
+        throw std::runtime_error("Aggregation needs at least one party");
+    }
+    if (fanOut < 2 || fanOut > numParties) {
+        fanOut = std::max<uint32_t>(numParties, 2);
+    }
+    AggTreePlan plan;
+    plan.estTime = 0;
+    uint32_t numPartials = numParties;
+    do {
+        uint32_t numNodes = (numPartials + fanOut - 1) / fanOut;
+        uint32_t numTowers = 0;
+        if (op == AggOp::PRODUCT) {
+            numTowers = (numNodes == 1) ? finalTowers : std::max(finalTowers, ceilLog2(numNodes));
+        }
+        plan.levels.push_back(AggTreeLevel {numNodes, std::min(fanOut, numPartials), numTowers});
+        numPartials = numNodes;
+    } while (numPartials > 1);
+    return plan;
+}
+
+// Critical path of the plan: nodes of one level run concurrently
+inline double estimateAggTree(
+    const AggCostModel &model,
+    const AggTreePlan &plan,
+    AggOp op,
+    uint32_t numElems,
+    uint32_t towersIn
+) {
+    double total = 0;
+    double numWorkers = std::max<uint32_t>(model.numThreads, 1);
+    uint32_t towers = towersIn;
+    for (auto &level : plan.levels) {
+        double opTime = ((op == AggOp::SUM) ? model.addTime : model.multTime) * towers;
+        double work = (double)level.numNodes * (level.fanOut - 1) * numElems * opTime;
+        double span = ceilLog2(level.fanOut) * opTime;
+        double t = std::max(work / numWorkers, span) + model.hopLatency;
+        if (model.bandwidth > 0) {
+            t += (double)level.fanOut * numElems * towers * model.towerBytes / model.bandwidth;
+        }
+        if (level.numTowers > 0 && level.numTowers < towers) {
+            double compWork = (double)level.numNodes * numElems * model.compressTime * towers;
+            t += std::max(compWork / numWorkers, model.compressTime * towers);
+            towers = level.numTowers;
+        }
+        total += t;
+    }
+    return total;
+}
+
+// Fan-out (powers of two, and the flat topology) and per-level compression
+// with the smallest estimated time. A level below the root is compressed
+// only when it pays for itself in the levels above.
+inline AggTreePlan planAggTree(
+    const AggCostModel &model,
+    uint32_t numParties,
+    AggOp op,
+    uint32_t numElems,
+    uint32_t towersIn,
+    uint32_t finalTowers = 3
+) {
+    AggTreePlan best = makeAggTreePlan(numParties, numParties, op, finalTowers);
+    best.estTime = estimateAggTree(model, best, op, numElems, towersIn);
+
+    for (uint32_t fanOut = 2; fanOut < numParties; fanOut *= 2) {
+        AggTreePlan plan = makeAggTreePlan(numParties, fanOut, op, finalTowers);
+        plan.estTime = estimateAggTree(model, plan, op, numElems, towersIn);
+        for (uint32_t l = 0; l + 1 < plan.levels.size(); l++) {
+            if (plan.levels[l].numTowers == 0) {
+                continue;
+            }
+            AggTreePlan cand = plan;
+            cand.levels[l].numTowers = 0;
+            cand.estTime = estimateAggTree(model, cand, op, numElems, towersIn);
+            if (cand.estTime < plan.estTime) {
+                plan = cand;
+            }
+        }
+        if (plan.estTime < best.estTime) {
+            best = plan;
+        }
+    }
+    return best;
+}
+
+// Runs the plan in this process; the nodes of a level run in parallel.
+// leaves[i] is the partial of party i; returns the root partial.
+inline std::vector<Ciphertext<DCRTPoly>> runAggTree(
+    const CryptoContext<DCRTPoly> &cc,
+    const AggTreePlan &plan,
+    AggOp op,
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> partials
+) {
+    if (partials.empty()) {
+        throw std::runtime_error("Aggregation needs at least one party");
+    }
+    uint32_t numElems = partials[0].size();
+    for (auto &level : plan.levels) {
+        uint32_t numChildren = partials.size();
+        if (level.numNodes != (numChildren + level.fanOut - 1) / level.fanOut) {
+            throw std::runtime_error("Aggregation plan does not match the number of parties");
+        }
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> next(
+            level.numNodes, std::vector<Ciphertext<DCRTPoly>>(numElems)
+        );
+
+        #pragma omp parallel for collapse(2) schedule(dynamic)
+        for (uint32_t node = 0; node < level.numNodes; node++) {
+            for (uint32_t e = 0; e < numElems; e++) {
+                uint32_t first = node * level.fanOut;
+                uint32_t last = std::min(first + level.fanOut, numChildren);
+                std::vector<Ciphertext<DCRTPoly>> children;
+                for (uint32_t c = first; c < last; c++) {
+                    children.push_back(partials[c][e]);
+                }
+
+                Ciphertext<DCRTPoly> out;
+                if (children.size() == 1) {
+                    out = children[0];
+                } else if (op == AggOp::SUM) {
+                    out = cc->EvalAddMany(children);
+                } else {
+                    out = cc->EvalMultMany(children);
+                }
+                if (level.numTowers > 0) {
+                    out = cc->Compress(out, level.numTowers);
+                }
+                next[node][e] = out;
+            }
+        }
+        partials = std::move(next);
+    }
+    return partials[0];
+}
+
+inline std::string describeAggTree(const AggTreePlan &plan) {
+    std::string ret;
+    for (auto &level : plan.levels) {
+        ret += (ret.empty() ? "" : " > ") + std::to_string(level.numNodes) + "x" + std::to_string(level.fanOut);
+        if (level.numTowers > 0) {
+            ret += "/" + std::to_string(level.numTowers);
+        }
+    }
+    return ret;
+}
+
+#endif
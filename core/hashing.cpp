@@ -1,169 +1,347 @@
 #include "hashing.h"
+#include <cstring>
+#include <random>
 
-uint64_t computeHash(
-    std::vector<int64_t> input, 
-    uint32_t salt = 42
+// Hashing Engine
+namespace {
+
+HashType _hashType = HashType::SHA256;
+uint64_t _sipKey[2] = {0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+
+// One SHA-256 context per thread; re-initialized instead of re-allocated.
+struct SHA256Ctx {
+    EVP_MD_CTX* ctx;
+    const EVP_MD* md;
+    SHA256Ctx(): ctx(EVP_MD_CTX_new()), md(EVP_sha256()) {}
+    ~SHA256Ctx() { EVP_MD_CTX_free(ctx); }
+};
+
+uint64_t computeHashSHA256(
+    const int64_t *input,
+    uint32_t len,
+    uint32_t salt
 ) {
+    thread_local SHA256Ctx sha256;
     unsigned char hash[SHA256_DIGEST_LENGTH] = {0};
 
-    // Use EVP (Recommended for OpenSSL 3.x)
-    EVP_MD_CTX* sha256 = EVP_MD_CTX_new();
-    EVP_DigestInit_ex(sha256, EVP_sha256(), nullptr);
-    EVP_DigestUpdate(sha256, &salt, sizeof(salt));
+    EVP_DigestInit_ex(sha256.ctx, sha256.md, nullptr);
+    EVP_DigestUpdate(sha256.ctx, &salt, sizeof(salt));
+    EVP_DigestUpdate(sha256.ctx, input, sizeof(int64_t) * len);
+    EVP_DigestFinal_ex(sha256.ctx, hash, nullptr);
 
-    for (uint64_t num : input) {
-        EVP_DigestUpdate(sha256, &num, sizeof(num));
-    }
+    uint64_t ret;
+    std::memcpy(&ret, hash, sizeof(ret));
+    return ret;
+}
 
-    EVP_DigestFinal_ex(sha256, hash, nullptr);
-    EVP_MD_CTX_free(sha256);  // Free the context
+// SipHash-2-4 over 64-bit words; the salt is folded into the key.
+inline uint64_t rotl64(uint64_t x, uint32_t b) {
+    return (x << b) | (x >> (64 - b));
+}
 
-    uint64_t* result_ptr = reinterpret_cast<uint64_t*>(hash);
-    return *result_ptr;
+inline void sipRound(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3) {
+    v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32);
+    v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32);
 }
 
-std::vector<std::vector<int64_t>> computeHashTable(
-    std::vector<std::vector<int64_t>> inputVec,
-    uint32_t ringDim,
-    uint32_t maxBin,
-    int64_t dummyVal
+uint64_t computeHashSip(
+    const int64_t *input,
+    uint32_t len,
+    uint64_t k0,
+    uint64_t k1
 ) {
-    // Assume that the input vector is already pre-processed well.
-    uint32_t dimElem = inputVec[0].size();
-    uint32_t numBins = ringDim / dimElem;
-    std::vector<std::vector<int64_t>> retTable(ringDim);
-    std::vector<uint32_t> currItems(ringDim, 0);
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint64_t m = (uint64_t)input[i];
+        v3 ^= m;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
 
-    std::cout << "Max Bin: " << maxBin << std::endl;
+    // Message length is always a multiple of 8 bytes
+    uint64_t b = ((uint64_t)(len * sizeof(int64_t)) & 0xff) << 56;
+    v3 ^= b;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= b;
 
-    for (auto& innerVec: retTable) {
-        innerVec.resize(maxBin, dummyVal);
-    }        
+    v2 ^= 0xff;
+    for (uint32_t i = 0; i < 4; i++) {
+        sipRound(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
 
-    for (uint32_t i = 0; i < inputVec.size(); i++) {
-        uint64_t ret = computeHash(inputVec[i], 42) % numBins;
+} // namespace
 
-        // Place values with Jumps!
-        for (uint32_t j = 0; j < dimElem; j++) {
-            uint32_t currIdx = ret + numBins * j;
-            
-            retTable[currIdx][currItems[currIdx]] = inputVec[i][j];
-            currItems[currIdx]++;
-            if (currItems[currIdx] > maxBin) {
-                throw std::runtime_error("Too many items in a bin");
-            }
-        }
-    }
+void setHashType(
+    HashType type,
+    uint64_t k0,
+    uint64_t k1
+) {
+    _hashType = type;
+    _sipKey[0] = k0;
+    _sipKey[1] = k1;
+}
 
-    uint32_t actualMaxBin = *std::max_element(currItems.begin(), currItems.end());
+HashType getHashType() {
+    return _hashType;
+}
 
-    // Trim the table
-    for (auto& innerVec: retTable) {
-        innerVec.resize(actualMaxBin);
-    }        
+uint64_t computeHash(
+    const int64_t *input,
+    uint32_t len,
+    uint32_t salt
+) {
+    if (_hashType == HashType::SIPHASH) {
+        return computeHashSip(
+            input, len, _sipKey[0] ^ (0x9e3779b97f4a7c15ULL * (salt + 1)), _sipKey[1]
+        );
+    }
+    return computeHashSHA256(input, len, salt);
+}
 
-    std::cout << "Actual Max Bin: " << actualMaxBin << std::endl;
-    return retTable;
+uint64_t computeHash(
+    const std::vector<int64_t> &input, 
+    uint32_t salt = 42
+) {
+    return computeHash(input.data(), input.size(), salt);
 }
 
-// Cuckoo Hashing
+void computeHashBatch(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    const std::vector<uint32_t> &salts,
+    std::vector<uint64_t> &out
+) {
+    int64_t numItems = inputVec.size();
+    uint32_t numSalts = salts.size();
+    out.resize(numItems * numSalts);
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < numItems; i++) {
+        for (uint32_t j = 0; j < numSalts; j++) {
+            out[i * numSalts + j] = computeHash(inputVec[i], salts[j]);
+        }
+    }
+}
 
-// A single bin entry
-struct BinEntry {
-    std::vector<int64_t> value;
-    int32_t loc; // which hash function index
-    bool isEmpty;
-    BinEntry(std::vector<int64_t> v = std::vector<int64_t>(42, -1), int32_t l=-1): value(v), loc(l), isEmpty(true) {}
-};
+// Bins of all items w.r.t. the given salts
+std::vector<uint32_t> computeBinPositions(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    const std::vector<uint32_t> &salts,
+    uint32_t numBins
+) {
+    std::vector<uint64_t> hashVals;
+    computeHashBatch(inputVec, salts, hashVals);
+
+    std::vector<uint32_t> pos(hashVals.size());
+    #pragma omp parallel for
+    for (uint64_t i = 0; i < hashVals.size(); i++) {
+        pos[i] = hashVals[i] % numBins;
+    }
+    return pos;
+}
 
-// Insert with recursive cuckoo hashing
-bool Insert(
-    std::vector<BinEntry>& bins,
-    std::vector<int64_t> w,
-    int32_t i,
-    uint32_t m,                 // number of bins
-    uint32_t h,                 // number of hash functions
-    uint32_t depthLimit=10    // recursion limit
+SimpleHashTable computeHashTable(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    uint32_t ringDim,
+    uint32_t maxBin,
+    int64_t dummyVal
 ) {
-    if (depthLimit == 0) return false; // fail if too deep
+    // Assume that the input vector is already pre-processed well.
+    uint32_t dimElem = inputVec[0].size();
+    uint32_t numBins = ringDim / dimElem;
 
-    // location function = hash with salt=i
-    uint32_t pos = computeHash(w, i) % m;
+    std::cout << "Max Bin: " << maxBin << std::endl;
 
-    // swap (w,i) with current entry
-    BinEntry tmp = bins[pos];
-    bins[pos] = BinEntry(w, i);
-    bins[pos].isEmpty = false;
+    std::vector<uint32_t> pos = computeBinPositions(inputVec, {SIMPLE_HASH_SALT}, numBins);
 
-    // if displaced item is empty, done
-    if (tmp.isEmpty) {
-        return true;
-    }
+    SimpleHashTable table = buildSimpleHashTable(
+        pos, inputVec.size(), 1, numBins, dimElem, maxBin, dummyVal, true,
+        [&](uint64_t i, uint32_t, uint32_t k) { return inputVec[i][k]; }
+    );
 
-    // otherwise, recurse with displaced item, but pick a new hash function j != tmp.loc
-    for (uint32_t j = 0; j < h; j++) {
-        if (j == (uint32_t)tmp.loc) continue;
-        if (Insert(bins, tmp.value, j, m, h, depthLimit-1)) {
-            return true;
-        }
-    }
-    return false;
+    std::cout << "Actual Max Bin: " << table.actualMaxBin << std::endl;
+    return table;
 }
 
-// Receiver side: insert Y into cuckoo table
-std::vector<BinEntry> cuckooInsertReceiver(
-    const std::vector<std::vector<int64_t>>& Y,
-    uint32_t m,   // number of bins
-    uint32_t h    // number of hash functions
+// Cuckoo Hashing
+// Iterative random-walk insertion over a flat table of item indices.
+// pos[i * h + j] is the bin of item i under the j-th hash function.
+CuckooTable cuckooInsert(
+    const std::vector<uint32_t> &pos,
+    uint32_t numItems,
+    uint32_t m,
+    uint32_t h,
+    uint32_t maxEvictions,
+    uint32_t stashSize
 ) {
-    std::vector<BinEntry> bins(m, BinEntry());
+    if (h < 2) {
+        throw std::runtime_error("Cuckoo hashing requires at least two hash functions");
+    }
+
+    CuckooTable table;
+    table.bins.assign(m, -1);
+    table.hashIdx.assign(m, 0);
+    table.stats = CuckooStats {numItems, m, h, 0, 0, 0};
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<uint32_t> distAll(0, h - 1);
+    std::uniform_int_distribution<uint32_t> dist(0, h - 2);
 
-    for (auto& y : Y) {
+    for (uint32_t i = 0; i < numItems; i++) {
+        int32_t curr = i;
+        uint32_t prevLoc = h;
+        uint32_t numEvictions = 0;
         bool ok = false;
-        for (uint32_t i = 0; i < h; i++) {
-            if (Insert(bins, y, i, m, h)) {
+
+        while (true) {
+            const uint32_t *currPos = &pos[(uint64_t)curr * h];
+
+            // Prefer an empty candidate bin
+            uint32_t loc = h;
+            for (uint32_t j = 0; j < h; j++) {
+                if (table.bins[currPos[j]] < 0) {
+                    loc = j;
+                    break;
+                }
+            }
+            if (loc < h) {
+                table.bins[currPos[loc]] = curr;
+                table.hashIdx[currPos[loc]] = loc;
                 ok = true;
                 break;
             }
+            if (numEvictions == maxEvictions) {
+                break;
+            }
+
+            // Random walk: evict from a random bin other than the one we came from
+            if (prevLoc == h) {
+                loc = distAll(gen);
+            } else {
+                loc = dist(gen);
+                loc += (loc >= prevLoc);
+            }
+            uint32_t bin = currPos[loc];
+            int32_t evicted = table.bins[bin];
+            prevLoc = table.hashIdx[bin];
+            table.bins[bin] = curr;
+            table.hashIdx[bin] = loc;
+            curr = evicted;
+            numEvictions++;
         }
+
+        table.stats.totalEvictions += numEvictions;
+        table.stats.maxEvictionChain = std::max(table.stats.maxEvictionChain, numEvictions);
+
         if (!ok) {
-            std::cerr << "Insertion failed for " << y << std::endl;
-            throw std::runtime_error("Cuckoo hashing failed");
+            // The homeless item may differ from the one being inserted;
+            // reporting is left to the caller
+            if (table.stash.size() == stashSize) {
+                throw std::runtime_error(
+                    "Cuckoo hashing failed for item " + std::to_string(curr)
+                    + " (stash size " + std::to_string(stashSize) + ")"
+                );
+            }
+            table.stash.push_back(curr);
         }
     }
-    return bins;
+    table.stats.stashUsed = table.stash.size();
+    return table;
 }
 
 std::vector<int64_t> computeCuckooHashTableClient(
-    std::vector<std::vector<int64_t>> &inputVec,
+    const std::vector<std::vector<int64_t>> &inputVec,
     uint32_t ringDim,
-    int64_t dummyVal
+    int64_t dummyVal,
+    uint32_t h,
+    std::vector<std::vector<int64_t>> *stashItems,
+    CuckooStats *stats,
+    std::vector<int32_t> *binItems
 ) {
     uint32_t dimElem = inputVec[0].size();
     uint32_t numBins = ringDim / dimElem;
+    uint32_t numItems = inputVec.size();
+
+    // Locations of every item w.r.t. every hash function
+    std::vector<uint32_t> salts(h);
+    for (uint32_t j = 0; j < h; j++) {
+        salts[j] = j;
+    }
+    std::vector<uint32_t> pos = computeBinPositions(inputVec, salts, numBins);
 
-    std::vector<BinEntry> hashBins = cuckooInsertReceiver(
-        inputVec, numBins, 3
+    CuckooTable table = cuckooInsert(
+        pos, numItems, numBins, h, CUCKOO_MAX_EVICTIONS,
+        stashItems == nullptr ? 0 : CUCKOO_STASH_SIZE
     );
 
     // Interpret Bins
     std::vector<int64_t> ret(ringDim, dummyVal);
  
     for (uint32_t i = 0; i < numBins; i++) {
-        auto currBin = hashBins[i];
-        if (currBin.isEmpty) {
+        int32_t idx = table.bins[i];
+        if (idx < 0) {
             continue;
-        } else {
-            for (uint32_t j = 0; j < dimElem; j++) {
-                ret[i + numBins * j] = currBin.value[j];
-            }
         }
+        for (uint32_t j = 0; j < dimElem; j++) {
+            ret[i + numBins * j] = inputVec[idx][j];
+        }
+    }
+
+    // Stashed items should be queried separately by the caller
+    if (stashItems != nullptr) {
+        stashItems->clear();
+        for (uint32_t idx : table.stash) {
+            stashItems->push_back(inputVec[idx]);
+        }
+    }
+    if (stats != nullptr) {
+        *stats = table.stats;
+    }
+    if (binItems != nullptr) {
+        *binItems = table.bins;
     }
     return ret;
 }
 
-std::vector<std::vector<int64_t>> computeCuckooHashTableServer(
-    std::vector<std::vector<int64_t>> inputVec,
+// Failure probability of a cuckoo table build, measured over numTrials random sets.
+double estimateCuckooFailProb(
+    uint32_t numItems,
+    uint32_t m,
+    uint32_t h,
+    uint32_t stashSize,
+    uint32_t numTrials
+) {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<uint32_t> dist(0, m - 1);
+
+    uint32_t numFails = 0;
+    std::vector<uint32_t> pos((uint64_t)numItems * h);
+    for (uint32_t t = 0; t < numTrials; t++) {
+        for (auto &val : pos) {
+            val = dist(gen);
+        }
+        try {
+            cuckooInsert(pos, numItems, m, h, CUCKOO_MAX_EVICTIONS, stashSize);
+        } catch (const std::runtime_error &) {
+            numFails++;
+        }
+    }
+    return (double)numFails / numTrials;
+}
+
+SimpleHashTable computeCuckooHashTableServer(
+    const std::vector<std::vector<int64_t>> &inputVec,
     uint32_t ringDim,
     uint32_t maxBin,
     int64_t dummyVal,
@@ -172,41 +350,258 @@ std::vector<std::vector<int64_t>> computeCuckooHashTableServer(
     // Assume that the input vector is already pre-processed well.
     uint32_t dimElem = inputVec[0].size();
     uint32_t numBins = ringDim / dimElem;
-    std::vector<std::vector<int64_t>> retTable(ringDim);
-    std::vector<uint32_t> currItems(ringDim, 0);
 
     std::cout << "Max Bin: " << maxBin << std::endl;    
 
+    // Every item goes to all of its h locations
+    std::vector<uint32_t> salts(h);
+    for (uint32_t j = 0; j < h; j++) {
+        salts[j] = j;
+    }
+    std::vector<uint32_t> pos = computeBinPositions(inputVec, salts, numBins);
 
-    for (auto& innerVec: retTable) {
-        innerVec.resize(maxBin, dummyVal);
-    }        
+    SimpleHashTable table = buildSimpleHashTable(
+        pos, inputVec.size(), h, numBins, dimElem, maxBin, dummyVal, false,
+        [&](uint64_t i, uint32_t, uint32_t k) { return inputVec[i][k]; }
+    );
 
-    for (uint32_t i = 0; i < inputVec.size(); i++) {
+    std::cout << "Actual Max Bin: " << table.actualMaxBin << std::endl;
+    return table;
+}
 
-        for (uint32_t j = 0; j < h; j++) {
-            uint64_t ret = computeHash(inputVec[i], j) % numBins;
+// Permutation-based Hashing
+namespace {
 
-            // Place values with Jumps!
-            for (uint32_t k = 0; k < dimElem; k++) {
-                uint32_t currIdx = ret + numBins * k;
-                
-                retTable[currIdx][currItems[currIdx]] = inputVec[i][k];
-                currItems[currIdx]++;
-                if (currItems[currIdx] > maxBin) {
-                    throw std::runtime_error("Too many items in a bin");
-                }
-            }
+uint64_t lowMask(uint32_t len) {
+    return (len >= 64) ? ~0ULL : ((1ULL << len) - 1);
+}
+
+// Bits [pos, pos + len) of a little-endian array of wordBits-bit words; len <= 64
+uint64_t readBits(
+    const int64_t *words,
+    uint32_t wordBits,
+    uint32_t pos,
+    uint32_t len
+) {
+    uint64_t ret = 0;
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t w = (pos + done) / wordBits;
+        uint32_t off = (pos + done) % wordBits;
+        uint32_t take = std::min(len - done, wordBits - off);
+        ret |= (((uint64_t)words[w] >> off) & lowMask(take)) << done;
+        done += take;
+    }
+    return ret;
+}
+
+// ORs val into bits [pos, pos + len); the destination should be zeroed
+void writeBits(
+    int64_t *words,
+    uint32_t wordBits,
+    uint32_t pos,
+    uint32_t len,
+    uint64_t val
+) {
+    uint32_t done = 0;
+    while (done < len) {
+        uint32_t w = (pos + done) / wordBits;
+        uint32_t off = (pos + done) % wordBits;
+        uint32_t take = std::min(len - done, wordBits - off);
+        words[w] |= (int64_t)(((val >> done) & lowMask(take)) << off);
+        done += take;
+    }
+}
+
+// Copies bits [pos, pos + len) of src to the start of dst
+void copyBits(
+    const int64_t *src,
+    int64_t *dst,
+    uint32_t wordBits,
+    uint32_t pos,
+    uint32_t len
+) {
+    for (uint32_t done = 0; done < len; done += 64) {
+        uint32_t take = std::min(len - done, 64U);
+        writeBits(dst, wordBits, done, take, readBits(src, wordBits, pos + done, take));
+    }
+}
+
+// k-th stored word of the remainder (xR || j)
+int64_t permHashRemainderWord(
+    const PermHashParams &perm,
+    const int64_t *item,
+    uint32_t j,
+    uint32_t k
+) {
+    uint32_t xRBits = perm.itemBits - perm.logBins;
+    uint32_t start = k * perm.wordBits;
+    // Padding words of the power-of-two layout
+    if (start >= perm.remBits) {
+        return 0;
+    }
+    uint32_t end = std::min(start + perm.wordBits, perm.remBits);
+
+    uint64_t ret = 0;
+    if (start < xRBits) {
+        ret = readBits(item, perm.wordBits, perm.logBins + start, std::min(end, xRBits) - start);
+    }
+    if (end > xRBits) {
+        uint32_t jStart = std::max(start, xRBits);
+        ret |= (((uint64_t)j >> (jStart - xRBits)) & lowMask(end - jStart)) << (jStart - start);
+    }
+    return ret;
+}
+
+} // namespace
+
+PermHashParams makePermHashParams(
+    uint32_t numBins,
+    uint32_t itemBits,
+    uint32_t wordBits,
+    uint32_t h
+) {
+    if (wordBits == 0 || wordBits > 63) {
+        throw std::runtime_error("Word size should be in [1, 63] bits");
+    }
+    uint32_t logBins = std::log2(numBins);
+    if (logBins > itemBits) {
+        throw std::runtime_error("Items are shorter than the bin index");
+    }
+    uint32_t idxBits = std::ceil(std::log2(h));
+    uint32_t remBits = itemBits - logBins + idxBits;
+    uint32_t remWords = std::max(1U, (remBits + wordBits - 1) / wordBits);
+
+    return PermHashParams {
+        numBins, logBins, itemBits, wordBits, h, idxBits, remBits, remWords
+    };
+}
+
+PermHashParams choosePermHashParams(
+    uint32_t ringDim,
+    uint32_t itemBits,
+    uint32_t wordBits,
+    uint32_t h
+) {
+    for (uint32_t words = 1; words < ringDim; words *= 2) {
+        PermHashParams perm = makePermHashParams(ringDim / words, itemBits, wordBits, h);
+        if (perm.remWords <= words) {
+            // Pad with zero words to fill the slots
+            perm.remWords = words;
+            return perm;
         }
     }
+    throw std::runtime_error("Items are too long for the ring dimension");
+}
+
+std::vector<uint32_t> computeBinPositionsPerm(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    const PermHashParams &perm
+) {
+    uint64_t numItems = inputVec.size();
+    uint32_t xRBits = perm.itemBits - perm.logBins;
+    uint32_t xRWords = std::max(1U, (xRBits + perm.wordBits - 1) / perm.wordBits);
+
+    // Split items; xR is hashed and xL is added to the hash
+    std::vector<std::vector<int64_t>> xRVec(numItems);
+    std::vector<uint64_t> xLVec(numItems);
+    #pragma omp parallel for
+    for (uint64_t i = 0; i < numItems; i++) {
+        const int64_t *item = inputVec[i].data();
+        xLVec[i] = readBits(item, perm.wordBits, 0, perm.logBins);
+        xRVec[i].assign(xRWords, 0);
+        copyBits(item, xRVec[i].data(), perm.wordBits, perm.logBins, xRBits);
+    }
+
+    std::vector<uint32_t> salts(perm.h);
+    for (uint32_t j = 0; j < perm.h; j++) {
+        salts[j] = j;
+    }
+    std::vector<uint64_t> hashVals;
+    computeHashBatch(xRVec, salts, hashVals);
+
+    std::vector<uint32_t> pos(hashVals.size());
+    #pragma omp parallel for
+    for (uint64_t e = 0; e < hashVals.size(); e++) {
+        pos[e] = (xLVec[e / perm.h] + hashVals[e] % perm.numBins) % perm.numBins;
+    }
+    return pos;
+}
+
+void permHashRemainder(
+    const PermHashParams &perm,
+    const std::vector<int64_t> &item,
+    uint32_t j,
+    int64_t *out
+) {
+    for (uint32_t k = 0; k < perm.remWords; k++) {
+        out[k] = permHashRemainderWord(perm, item.data(), j, k);
+    }
+}
 
-    uint32_t actualMaxBin = *std::max_element(currItems.begin(), currItems.end());
+std::vector<int64_t> computeCuckooHashTableClientPerm(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    uint32_t ringDim,
+    int64_t dummyVal,
+    const PermHashParams &perm,
+    std::vector<std::vector<int64_t>> *stashItems,
+    CuckooStats *stats
+) {
+    uint32_t numBins = perm.numBins;
+    uint32_t numItems = inputVec.size();
 
-    // Trim the table
-    for (auto& innerVec: retTable) {
-        innerVec.resize(maxBin);
-    }        
+    std::vector<uint32_t> pos = computeBinPositionsPerm(inputVec, perm);
 
-    std::cout << "Actual Max Bin: " << actualMaxBin << std::endl;
-    return retTable;
-}
\ No newline at end of file
+    CuckooTable table = cuckooInsert(
+        pos, numItems, numBins, perm.h, CUCKOO_MAX_EVICTIONS,
+        stashItems == nullptr ? 0 : CUCKOO_STASH_SIZE
+    );
+
+    // Interpret Bins; store remainders only
+    std::vector<int64_t> ret(ringDim, dummyVal);
+    std::vector<int64_t> rem(perm.remWords);
+
+    for (uint32_t i = 0; i < numBins; i++) {
+        int32_t idx = table.bins[i];
+        if (idx < 0) {
+            continue;
+        }
+        permHashRemainder(perm, inputVec[idx], table.hashIdx[i], rem.data());
+        for (uint32_t j = 0; j < perm.remWords; j++) {
+            ret[i + numBins * j] = rem[j];
+        }
+    }
+
+    // Stashed items are kept in full
+    if (stashItems != nullptr) {
+        stashItems->clear();
+        for (uint32_t idx : table.stash) {
+            stashItems->push_back(inputVec[idx]);
+        }
+    }
+    if (stats != nullptr) {
+        *stats = table.stats;
+    }
+    return ret;
+}
+
+SimpleHashTable computeCuckooHashTableServerPerm(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    uint32_t maxBin,
+    int64_t dummyVal,
+    const PermHashParams &perm
+) {
+    std::cout << "Max Bin: " << maxBin << std::endl;
+
+    std::vector<uint32_t> pos = computeBinPositionsPerm(inputVec, perm);
+
+    SimpleHashTable table = buildSimpleHashTable(
+        pos, inputVec.size(), perm.h, perm.numBins, perm.remWords, maxBin, dummyVal, false,
+        [&](uint64_t i, uint32_t j, uint32_t k) {
+            return permHashRemainderWord(perm, inputVec[i].data(), j, k);
+        }
+    );
+
+    std::cout << "Actual Max Bin: " << table.actualMaxBin << std::endl;
+    return table;
+}
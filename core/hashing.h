@@ -11,31 +11,283 @@
 #include <algorithm>
 #include <openssl/evp.h>
 #include <openssl/sha.h>
+#include <omp.h>
+
+// Hash function used for locating items in hash tables.
+// SHA256 is the default; SIPHASH is a fast keyed hash for non-adversarial benchmarks.
+enum class HashType {
+    SHA256,
+    SIPHASH
+};
+
+void setHashType(
+    HashType type,
+    uint64_t k0 = 0x0706050403020100ULL,
+    uint64_t k1 = 0x0f0e0d0c0b0a0908ULL
+);
+
+HashType getHashType();
 
 uint64_t computeHash(
-    std::vector<int64_t> input, 
+    const int64_t *input,
+    uint32_t len,
     uint32_t salt
 );
 
-std::vector<std::vector<int64_t>> computeHashTable(
-    std::vector<std::vector<int64_t>> inputVec,
+uint64_t computeHash(
+    const std::vector<int64_t> &input, 
+    uint32_t salt
+);
+
+// out[i * salts.size() + j] = computeHash(inputVec[i], salts[j])
+void computeHashBatch(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    const std::vector<uint32_t> &salts,
+    std::vector<uint64_t> &out
+);
+
+// Simple hashing table in a structure-of-arrays layout.
+// Word k of the c-th item in bin b is stored at data[(k * maxBin + c) * numBins + b],
+// so the slots (b + numBins * t) for items c..c+dimElem-1 of word k are contiguous.
+struct SimpleHashTable {
+    uint32_t numBins;
+    uint32_t dimElem;
+    uint32_t maxBin;
+    uint32_t actualMaxBin;
+    int64_t dummyVal;
+    std::vector<int64_t> data;
+
+    // c-th entry of slot row r = b + numBins * k (the row-per-slot view)
+    int64_t at(uint32_t r, uint32_t c) const {
+        uint32_t k = r / numBins;
+        uint32_t b = r % numBins;
+        return data[((uint64_t)k * maxBin + c) * numBins + b];
+    }
+
+    // Copies the slot vector of items c..c+len/numBins-1 of word k, padded with dummies
+    void readSlots(uint32_t k, uint32_t c, int64_t *out, uint32_t len) const {
+        uint64_t avail = (c < maxBin) ? (uint64_t)(maxBin - c) * numBins : 0;
+        uint64_t n = std::min<uint64_t>(len, avail);
+        const int64_t *src = data.data() + ((uint64_t)k * maxBin + c) * numBins;
+        std::copy(src, src + n, out);
+        std::fill(out + n, out + len, dummyVal);
+    }
+};
+
+// Two-pass parallel build: the (item, hash) pairs are split into fixed chunks;
+// per-chunk bin counts are prefix-summed into offsets, then every chunk is
+// scattered in input order. Chunks are shared out with omp for, so a smaller
+// team than requested still covers all of them.
+// pos[i * h + j] is the bin of item i under the j-th hash; getWord(i, j, k) is the k-th word
+// stored for item i when placed by the j-th hash.
+// maxBin = 0 leaves the load uncapped; trim shrinks the table to the actual max load.
+template <typename GetWord>
+SimpleHashTable buildSimpleHashTable(
+    const std::vector<uint32_t> &pos,
+    uint64_t numItems,
+    uint32_t h,
+    uint32_t numBins,
+    uint32_t dimElem,
+    uint32_t maxBin,
+    int64_t dummyVal,
+    bool trim,
+    GetWord getWord
+) {
+    uint64_t numEntries = numItems * h;
+    uint32_t numChunks = omp_get_max_threads();
+    std::vector<uint32_t> offsets((uint64_t)numChunks * numBins, 0);
+
+    // Pass 1: Count
+    #pragma omp parallel for schedule(static, 1)
+    for (uint32_t t = 0; t < numChunks; t++) {
+        uint64_t begin = numEntries * t / numChunks;
+        uint64_t end = numEntries * (t + 1) / numChunks;
+        uint32_t *cnt = &offsets[(uint64_t)t * numBins];
+        for (uint64_t e = begin; e < end; e++) {
+            cnt[pos[e]]++;
+        }
+    }
+
+    // Prefix Sum over chunks for each bin
+    uint32_t actualMaxBin = 0;
+    for (uint32_t b = 0; b < numBins; b++) {
+        uint32_t run = 0;
+        for (uint32_t t = 0; t < numChunks; t++) {
+            uint32_t cnt = offsets[(uint64_t)t * numBins + b];
+            offsets[(uint64_t)t * numBins + b] = run;
+            run += cnt;
+        }
+        actualMaxBin = std::max(actualMaxBin, run);
+    }
+
+    if (maxBin != 0 && actualMaxBin > maxBin) {
+        throw std::runtime_error("Too many items in a bin");
+    }
+    uint32_t width = (trim || maxBin == 0) ? actualMaxBin : maxBin;
+
+    SimpleHashTable table {
+        numBins, dimElem, width, actualMaxBin, dummyVal, {}
+    };
+    table.data.resize((uint64_t)dimElem * width * numBins);
+    #pragma omp parallel for
+    for (uint64_t i = 0; i < table.data.size(); i++) {
+        table.data[i] = dummyVal;
+    }
+
+    // Pass 2: Scatter
+    #pragma omp parallel for schedule(static, 1)
+    for (uint32_t t = 0; t < numChunks; t++) {
+        uint64_t begin = numEntries * t / numChunks;
+        uint64_t end = numEntries * (t + 1) / numChunks;
+        uint32_t *cursor = &offsets[(uint64_t)t * numBins];
+        for (uint64_t e = begin; e < end; e++) {
+            uint64_t i = e / h;
+            uint32_t j = e % h;
+            uint32_t b = pos[e];
+            uint32_t c = cursor[b]++;
+            for (uint32_t k = 0; k < dimElem; k++) {
+                table.data[((uint64_t)k * width + c) * numBins + b] = getWord(i, j, k);
+            }
+        }
+    }
+    return table;
+}
+
+// pos[i * salts.size() + j] = bin of the i-th item under the j-th salt
+std::vector<uint32_t> computeBinPositions(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    const std::vector<uint32_t> &salts,
+    uint32_t numBins
+);
+
+// Salt of the single hash function of computeHashTable (APSI)
+#define SIMPLE_HASH_SALT 42
+
+SimpleHashTable computeHashTable(
+    const std::vector<std::vector<int64_t>> &inputVec,
     uint32_t ringDim,
     uint32_t maxBin,
     int64_t dummyVal
 );
 
+// Cuckoo Hashing
+#define CUCKOO_MAX_EVICTIONS 512
+#define CUCKOO_STASH_SIZE 4
+
+struct CuckooStats {
+    uint32_t numItems;
+    uint32_t numBins;
+    uint32_t h;
+    uint32_t stashUsed;
+    uint64_t totalEvictions;
+    uint32_t maxEvictionChain;
+};
+
+// bins[b] is the index of the item placed in bin b, or -1 if empty.
+struct CuckooTable {
+    std::vector<int32_t> bins;
+    std::vector<uint8_t> hashIdx;
+    std::vector<uint32_t> stash;
+    CuckooStats stats;
+};
+
+CuckooTable cuckooInsert(
+    const std::vector<uint32_t> &pos,
+    uint32_t numItems,
+    uint32_t m,
+    uint32_t h,
+    uint32_t maxEvictions,
+    uint32_t stashSize
+);
+
+double estimateCuckooFailProb(
+    uint32_t numItems,
+    uint32_t m,
+    uint32_t h,
+    uint32_t stashSize,
+    uint32_t numTrials
+);
+
+// Without stashItems, a non-empty stash is treated as a failure.
+// binItems receives the index of the item placed in every bin, -1 if empty.
 std::vector<int64_t> computeCuckooHashTableClient(
-    std::vector<std::vector<int64_t>> &inputVec,
+    const std::vector<std::vector<int64_t>> &inputVec,
     uint32_t ringDim,
-    int64_t dummyVal
+    int64_t dummyVal,
+    uint32_t h = 3,
+    std::vector<std::vector<int64_t>> *stashItems = nullptr,
+    CuckooStats *stats = nullptr,
+    std::vector<int32_t> *binItems = nullptr
 );
 
-std::vector<std::vector<int64_t>> computeCuckooHashTableServer(
-    std::vector<std::vector<int64_t>> inputVec,
+SimpleHashTable computeCuckooHashTableServer(
+    const std::vector<std::vector<int64_t>> &inputVec,
     uint32_t ringDim,
     uint32_t maxBin,
     int64_t dummyVal,
     uint32_t h
 );
 
-#endif
\ No newline at end of file
+// Permutation-based Hashing
+// An item is a bit string of itemBits bits, packed little-endian into words of wordBits bits.
+// The low logBins bits (xL) are absorbed by the bin index
+//      bin_j = (xL + H_j(xR)) mod numBins,
+// so only the remainder xR and the hash index j are stored in the bin.
+struct PermHashParams {
+    uint32_t numBins;
+    uint32_t logBins;
+    uint32_t itemBits;
+    uint32_t wordBits;
+    uint32_t h;
+    uint32_t idxBits;
+    uint32_t remBits;
+    uint32_t remWords;
+};
+
+PermHashParams makePermHashParams(
+    uint32_t numBins,
+    uint32_t itemBits,
+    uint32_t wordBits,
+    uint32_t h = 3
+);
+
+// Fewest stored words (a power of two, for the strided slot layout) s.t.
+// the remainder fits into them with ringDim / words bins
+PermHashParams choosePermHashParams(
+    uint32_t ringDim,
+    uint32_t itemBits,
+    uint32_t wordBits,
+    uint32_t h = 3
+);
+
+// Bin of every item under every hash function; pos[i * h + j]
+std::vector<uint32_t> computeBinPositionsPerm(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    const PermHashParams &perm
+);
+
+// Stored words (xR || j) of an item placed by the j-th hash
+void permHashRemainder(
+    const PermHashParams &perm,
+    const std::vector<int64_t> &item,
+    uint32_t j,
+    int64_t *out
+);
+
+std::vector<int64_t> computeCuckooHashTableClientPerm(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    uint32_t ringDim,
+    int64_t dummyVal,
+    const PermHashParams &perm,
+    std::vector<std::vector<int64_t>> *stashItems = nullptr,
+    CuckooStats *stats = nullptr
+);
+
+SimpleHashTable computeCuckooHashTableServerPerm(
+    const std::vector<std::vector<int64_t>> &inputVec,
+    uint32_t maxBin,
+    int64_t dummyVal,
+    const PermHashParams &perm
+);
+
+#endif
@@ -0,0 +1,117 @@
+#include "seeded.h"
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+CtxtSeed makeSeed() {
+    CtxtSeed seed;
+    if (RAND_bytes(seed.data(), SEED_BYTES) != 1) {
+        throw std::runtime_error("Cannot sample a ciphertext seed");
+    }
+    return seed;
+}
+
+namespace {
+
+// AES-128-CTR keystream; counter block = (tower index || 0), so the towers
+// draw from disjoint streams.
+struct SeedStream {
+    EVP_CIPHER_CTX* ctx;
+    SeedStream(const CtxtSeed &seed, uint32_t tower): ctx(EVP_CIPHER_CTX_new()) {
+        uint8_t iv[16] = {0};
+        std::memcpy(iv, &tower, sizeof(tower));
+        if (ctx == nullptr ||
+            EVP_EncryptInit_ex(ctx, EVP_aes_128_ctr(), nullptr, seed.data(), iv) != 1) {
+            EVP_CIPHER_CTX_free(ctx);
+            throw std::runtime_error("Cannot initialize the seed expansion");
+        }
+    }
+    ~SeedStream() { EVP_CIPHER_CTX_free(ctx); }
+
+    void fill(std::vector<uint64_t> &out) {
+        std::vector<uint8_t> zeros(out.size() * sizeof(uint64_t), 0);
+        int len = 0;
+        EVP_EncryptUpdate(
+            ctx, reinterpret_cast<uint8_t *>(out.data()), &len,
+            zeros.data(), zeros.size()
+        );
+    }
+};
+
+} // namespace
+
+DCRTPoly expandSeed(
+    const std::shared_ptr<DCRTPoly::Params> &params,
+    const CtxtSeed &seed
+) {
+    DCRTPoly ret(params, Format::EVALUATION, true);
+    uint32_t numTowers = params->GetParams().size();
+    uint32_t ringDim = params->GetRingDimension();
+
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < numTowers; i++) {
+        NativeInteger q = params->GetParams()[i]->GetModulus();
+        uint64_t qVal = q.ConvertToInt();
+        uint32_t width = q.GetMSB();
+        uint64_t mask = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+
+        // Rejection sampling; accepts with prob. > 1/2 per word
+        SeedStream stream(seed, i);
+        std::vector<uint64_t> words(ringDim);
+        NativePoly &tower = ret.GetElementAtIndex(i);
+        uint32_t j = 0;
+        while (j < ringDim) {
+            stream.fill(words);
+            for (uint32_t w = 0; w < ringDim && j < ringDim; w++) {
+                uint64_t val = words[w] & mask;
+                if (val < qVal) {
+                    tower[j++] = NativeInteger(val);
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+Ciphertext<DCRTPoly> encryptSeeded(
+    FHECTX &ctx,
+    Plaintext ptxt,
+    const CtxtSeed &seed
+) {
+    if (ctx.sk == nullptr) {
+        throw std::runtime_error("Seeded encryption needs the secret key");
+    }
+    // (c0, c1) = (-c1*s + e + m, c1); replacing c1 by a keeps c0 + c1*s
+    Ciphertext<DCRTPoly> ctxt = ctx.cc->Encrypt(ptxt, ctx.sk);
+    std::vector<DCRTPoly> &elems = ctxt->GetElements();
+    DCRTPoly a = expandSeed(elems[1].GetParams(), seed);
+    elems[0] += (elems[1] - a) * ctx.sk->GetPrivateElement();
+    elems[1] = std::move(a);
+    return ctxt;
+}
+
+void encodeSeededCtxt(
+    std::string &buf,
+    const Ciphertext<DCRTPoly> &ctxt,
+    const CtxtSeed &seed
+) {
+    if (ctxt->GetElements().size() != 2) {
+        throw std::runtime_error("Only fresh ciphertexts can be seeded");
+    }
+    buf.append(reinterpret_cast<const char *>(seed.data()), SEED_BYTES);
+    encodeCtxt(buf, ctxt, 1);
+}
+
+Ciphertext<DCRTPoly> decodeSeededCtxt(
+    FHECTX &ctx,
+    const std::string &buf,
+    size_t &pos
+) {
+    CtxtSeed seed = getVal<CtxtSeed>(buf, pos);
+    Ciphertext<DCRTPoly> ctxt = decodeCtxt(ctx.cc, buf, pos);
+    std::vector<DCRTPoly> &elems = ctxt->GetElements();
+    if (elems.size() != 1 || elems[0].GetFormat() != Format::EVALUATION) {
+        throw std::runtime_error("Malformed seeded ciphertext");
+    }
+    elems.push_back(expandSeed(elems[0].GetParams(), seed));
+    return ctxt;
+}
@@ -0,0 +1,44 @@
+#ifndef SEEDED_H
+#define SEEDED_H
+
+#include "utils.h"
+#include "wire.h"
+#include <array>
+
+// Seeded symmetric ciphertexts: the second component a is expanded from a
+// short seed with AES-128-CTR, so that only c0 and the seed are uploaded.
+// Encryption needs the secret key.
+
+#define SEED_BYTES 16
+
+typedef std::array<uint8_t, SEED_BYTES> CtxtSeed;
+
+CtxtSeed makeSeed();
+
+// Uniform element in evaluation format; tower i uses its own counter block
+DCRTPoly expandSeed(
+    const std::shared_ptr<DCRTPoly::Params> &params,
+    const CtxtSeed &seed
+);
+
+// Symmetric encryption whose a-component is expandSeed(seed)
+Ciphertext<DCRTPoly> encryptSeeded(
+    FHECTX &ctx,
+    Plaintext ptxt,
+    const CtxtSeed &seed
+);
+
+// Wire format: the seed followed by c0 (core/wire.h)
+void encodeSeededCtxt(
+    std::string &buf,
+    const Ciphertext<DCRTPoly> &ctxt,
+    const CtxtSeed &seed
+);
+
+Ciphertext<DCRTPoly> decodeSeededCtxt(
+    FHECTX &ctx,
+    const std::string &buf,
+    size_t &pos
+);
+
+#endif
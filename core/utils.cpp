@@ -1,6 +1,8 @@
 #include "utils.h"
 
-FHECTX initParams (
+namespace {
+
+CryptoContext<DCRTPoly> makeContext (
     uint32_t modulus,
     uint32_t depth,
     uint32_t scalingMod
@@ -17,20 +19,35 @@ FHECTX initParams (
     cc->Enable(ADVANCEDSHE);
     cc->Enable(MULTIPARTY);
 
-    KeyPair<DCRTPoly> keys = cc->KeyGen();
-    cc->EvalMultKeyGen(keys.secretKey);
+    std::cout << params << std::endl;
+    std::cout << "CTXT MODULUS: " 
+              << std::log2(cc->GetModulus().ConvertToDouble())
+              << "bits" << std::endl;
+    return cc;
+}
 
+std::vector<int32_t> makeRotIdx(CryptoContext<DCRTPoly> &cc) {
     std::vector<int32_t> rotIdx;
 
     for (uint32_t i = 1; i < cc->GetRingDimension(); i*=2) {
         rotIdx.push_back(i);
     }
-    cc->EvalRotateKeyGen(keys.secretKey, rotIdx);
+    return rotIdx;
+}
+
+} // namespace
+
+FHECTX initParams (
+    uint32_t modulus,
+    uint32_t depth,
+    uint32_t scalingMod
+) {
+    CryptoContext<DCRTPoly> cc = makeContext(modulus, depth, scalingMod);
+
+    KeyPair<DCRTPoly> keys = cc->KeyGen();
+    cc->EvalMultKeyGen(keys.secretKey);
+    cc->EvalRotateKeyGen(keys.secretKey, makeRotIdx(cc));
 
-    std::cout << params << std::endl;
-    std::cout << "CTXT MODULUS: " 
-              << std::log2(cc->GetModulus().ConvertToDouble())
-              << "bits" << std::endl;
     return FHECTX {
         cc,
         keys.publicKey,
@@ -40,6 +57,101 @@ FHECTX initParams (
     };
 }
 
+FHECTX initThresholdParams (
+    uint32_t modulus,
+    uint32_t depth,
+    uint32_t scalingMod,
+    uint32_t numHolders,
+    std::vector<PrivateKey<DCRTPoly>> &shares
+) {
+    if (numHolders == 0) {
+        throw std::runtime_error("Threshold setup needs at least one key holder");
+    }
+    CryptoContext<DCRTPoly> cc = makeContext(modulus, depth, scalingMod);
+    std::vector<int32_t> rotIdx = makeRotIdx(cc);
+
+    // Every holder extends the public key of the previous one
+    std::vector<KeyPair<DCRTPoly>> keys(numHolders);
+    keys[0] = cc->KeyGen();
+    for (uint32_t i = 1; i < numHolders; i++) {
+        keys[i] = cc->MultipartyKeyGen(keys[i-1].publicKey);
+    }
+    std::string jointTag = keys[numHolders-1].publicKey->GetKeyTag();
+
+    // Relinearization key: sum of the s_i * s_i shares, then s_i * (sum s_j)
+    EvalKey<DCRTPoly> multKey = cc->KeySwitchGen(keys[0].secretKey, keys[0].secretKey);
+    EvalKey<DCRTPoly> multKeySum = multKey;
+    for (uint32_t i = 1; i < numHolders; i++) {
+        EvalKey<DCRTPoly> _tmp = cc->MultiKeySwitchGen(keys[i].secretKey, keys[i].secretKey, multKey);
+        multKeySum = cc->MultiAddEvalKeys(multKeySum, _tmp, keys[i].publicKey->GetKeyTag());
+    }
+    EvalKey<DCRTPoly> multKeyJoint = cc->MultiMultEvalKey(keys[0].secretKey, multKeySum, jointTag);
+    for (uint32_t i = 1; i < numHolders; i++) {
+        EvalKey<DCRTPoly> _tmp = cc->MultiMultEvalKey(keys[i].secretKey, multKeySum, jointTag);
+        multKeyJoint = cc->MultiAddEvalMultKeys(multKeyJoint, _tmp, jointTag);
+    }
+    cc->InsertEvalMultKey({multKeyJoint});
+
+    // Rotation keys
+    cc->EvalAtIndexKeyGen(keys[0].secretKey, rotIdx);
+    auto rotKeys = std::make_shared<std::map<uint32_t, EvalKey<DCRTPoly>>>(
+        cc->GetEvalAutomorphismKeyMap(keys[0].secretKey->GetKeyTag())
+    );
+    auto rotKeySum = rotKeys;
+    for (uint32_t i = 1; i < numHolders; i++) {
+        auto _tmp = cc->MultiEvalAtIndexKeyGen(
+            keys[i].secretKey, rotKeys, rotIdx, keys[i].publicKey->GetKeyTag()
+        );
+        rotKeySum = cc->MultiAddEvalAutomorphismKeys(rotKeySum, _tmp, keys[i].publicKey->GetKeyTag());
+    }
+    cc->InsertEvalAutomorphismKey(rotKeySum);
+
+    shares.resize(numHolders);
+    for (uint32_t i = 0; i < numHolders; i++) {
+        shares[i] = keys[i].secretKey;
+    }
+
+    // No single party holds the secret key
+    return FHECTX {
+        cc,
+        keys[numHolders-1].publicKey,
+        nullptr,
+        cc->GetRingDimension(),
+        modulus
+    };
+}
+
+Plaintext thresholdDecrypt (
+    FHECTX &ctx,
+    const std::vector<PrivateKey<DCRTPoly>> &shares,
+    const Ciphertext<DCRTPoly> &ctxt
+) {
+    uint32_t numHolders = shares.size();
+    std::vector<Ciphertext<DCRTPoly>> partials(numHolders);
+
+    // Partial decryptions are independent; holder 0 takes the lead role
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < numHolders; i++) {
+        partials[i] = (i == 0)
+            ? ctx.cc->MultipartyDecryptLead({ctxt}, shares[i])[0]
+            : ctx.cc->MultipartyDecryptMain({ctxt}, shares[i])[0];
+    }
+
+    Plaintext ret;
+    ctx.cc->MultipartyDecryptFusion(partials, &ret);
+    return ret;
+}
+
+Ciphertext<DCRTPoly> encryptPtxt (
+    FHECTX &ctx,
+    Plaintext ptxt
+) {
+    if (ctx.sk != nullptr) {
+        return ctx.cc->Encrypt(ptxt, ctx.sk);
+    }
+    return ctx.cc->Encrypt(ptxt, ctx.pk);
+}
+
 size_t ctxtSize(Ciphertext<DCRTPoly>& ctxt) {
     size_t size = 0;
     for (auto& element : ctxt->GetElements()) {
@@ -126,44 +238,72 @@ Ciphertext<DCRTPoly> makeRandCtxt (
         msgVec[i] = dist(gen);
     }
     Plaintext ptxt = ctx.cc->MakePackedPlaintext(msgVec);
-    return ctx.cc->Encrypt(ptxt, ctx.sk);
+    return encryptPtxt(ctx, ptxt);
 }
 
 
-// Bin Size = 4096; lambda=40
-// Refer to the fomula in CLR17
-
-std::vector<int64_t> _table_1024 = {
-    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,113,185,314,552,1001,1862,3528,6785,13190,25847
-};
-
-std::vector<int64_t> _table_2048 = {
-    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,113,185,314,552,1001,1862,3528,6785,13190,25847
-};
+// Max bin load for hashing numItems * h balls into numBins bins,
+// following the balls-into-bins bound in CLR17:
+// numBins * Pr[Bin(numItems * h, 1/numBins) > maxBin] <= 2^-lambda
 
-std::vector<int64_t> _table_4096 = {
-    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,74,114,186,315,554,1004,1865,3533,6792,13199
-};
+// log2 Pr[Bin(n, p) > bound]
+static double logBinomTail(
+    uint64_t n,
+    double p,
+    uint64_t bound
+) {
+    if (bound >= n) {
+        return -INFINITY;
+    }
+    // First term of the tail, then the ratio recurrence of the pmf
+    double i = bound + 1;
+    double logFirst = std::lgamma(n + 1.0) - std::lgamma(i + 1.0) - std::lgamma(n - i + 1.0)
+                    + i * std::log(p) + (n - i) * std::log1p(-p);
+    double sum = 1.0, term = 1.0;
+    for (uint64_t j = bound + 1; j < n; j++) {
+        term *= (double)(n - j) / (j + 1) * p / (1 - p);
+        sum += term;
+        if (term < sum * 1e-17) {
+            break;
+        }
+    }
+    return (logFirst + std::log(sum)) / std::log(2.0);
+}
 
-uint32_t getMaxBins(
+uint32_t computeMaxBinLoad(
     uint32_t numBins,
-    uint32_t logN
+    uint64_t numItems,
+    uint32_t h,
+    uint32_t lambda
 ) {
-    uint32_t ret = 0;
+    static std::map<std::tuple<uint32_t, uint64_t, uint32_t, uint32_t>, uint32_t> cache;
+    static std::mutex cacheMutex;
 
-    switch (numBins) {
-        default:
-            break;
-        case 1024:
-            ret = _table_1024[logN];
-            break;
-        case 2048:
-            ret = _table_2048[logN];
-            break;
-        case 4096:            
-            ret = _table_4096[logN];
-            break;
-    };
+    auto key = std::make_tuple(numBins, numItems, h, lambda);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
 
-    return ret;
-}
\ No newline at end of file
+    uint64_t numBalls = numItems * h;
+    double p = 1.0 / numBins;
+    double target = -(double)lambda - std::log2((double)numBins);
+
+    // Binary search for the smallest bound over the mean load
+    uint64_t lo = numBalls / numBins, hi = numBalls;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (logBinomTail(numBalls, p, mid) <= target) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache[key] = lo;
+    return lo;
+}
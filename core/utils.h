@@ -2,6 +2,10 @@
 #define UTILS_H
 
 #include "openfhe.h"
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
 using namespace lbcrypto;
 
 struct FHECTX {
@@ -18,6 +22,30 @@ FHECTX initParams (
     uint32_t scalingMod
 );
 
+// Threshold setup among numHolders key holders (MultipartyKeyGen). The
+// returned context carries the joint public key and no secret key; shares
+// receives the secret key share of every holder.
+FHECTX initThresholdParams (
+    uint32_t modulus,
+    uint32_t depth,
+    uint32_t scalingMod,
+    uint32_t numHolders,
+    std::vector<PrivateKey<DCRTPoly>> &shares
+);
+
+// Joint decryption; the partial decryptions run concurrently
+Plaintext thresholdDecrypt (
+    FHECTX &ctx,
+    const std::vector<PrivateKey<DCRTPoly>> &shares,
+    const Ciphertext<DCRTPoly> &ctxt
+);
+
+// Secret-key encryption when ctx holds the secret key, public-key otherwise
+Ciphertext<DCRTPoly> encryptPtxt (
+    FHECTX &ctx,
+    Plaintext ptxt
+);
+
 size_t ctxtSize(Ciphertext<DCRTPoly>& ctxt);
 
 std::vector<std::vector<int64_t>> genData(
@@ -48,9 +76,13 @@ Ciphertext<DCRTPoly> ctxtRotAddStride(
     uint32_t stride
 );
 
-uint32_t getMaxBins(
+// Smallest max bin load that is exceeded with prob. at most 2^-lambda
+// when numItems items are inserted with h hash functions; memoized.
+uint32_t computeMaxBinLoad(
     uint32_t numBins,
-    uint32_t logN
+    uint64_t numItems,
+    uint32_t h = 3,
+    uint32_t lambda = 40
 );
 
 #endif
@@ -1,4 +1,5 @@
 #include "vaf.h"
+#include <random>
 
 Ciphertext<DCRTPoly> ctxtMulByConstant(
     const Ciphertext<DCRTPoly> &x,
@@ -24,21 +25,30 @@ void ctxtMulByConstantInPlace(
 
 
 // VAF for p=2^16 + 1
-Ciphertext<DCRTPoly> compVAF16(
+void compVAF16InPlace(
     FHECTX &ctx,
     Ciphertext<DCRTPoly> &x,
     Plaintext ptOne
 ) {
-    auto ret = x->Clone();
     for (uint32_t i = 0; i < 16; i++) {
-        ctx.cc->EvalSquareInPlace(ret);
+        ctx.cc->EvalSquareInPlace(x);
     }
-    ctx.cc->EvalNegateInPlace(ret);
-    ctx.cc->EvalAddInPlace(ret, ptOne);
+    ctx.cc->EvalNegateInPlace(x);
+    ctx.cc->EvalAddInPlace(x, ptOne);
+}
+
+Ciphertext<DCRTPoly> compVAF16(
+    FHECTX &ctx,
+    Ciphertext<DCRTPoly> &x,
+    Plaintext ptOne
+) {
+    auto ret = x->Clone();
+    compVAF16InPlace(ctx, ret, ptOne);
     return ret;
 }
 
 // NPC
+// Handles in x are only permuted, never aliased, so x can be a reusable buffer.
 Ciphertext<DCRTPoly> compExactNPM(
     FHECTX &ctx,
     std::vector<Ciphertext<DCRTPoly>> &x,
@@ -58,10 +68,11 @@ Ciphertext<DCRTPoly> compExactNPM(
         }
         // Subtract
         for (uint32_t i = 0; i < k/2; i++) {
-            x[i] = ctx.cc->EvalSub(x[2*i], x[2*i+1]);
+            ctx.cc->EvalSubInPlace(x[2*i], x[2*i+1]);
+            std::swap(x[i], x[2*i]);
         }        
         if (isOdd) {
-            x[k/2] = x[k];
+            std::swap(x[k/2], x[k-1]);
         }
         k >>=1;
         k += isOdd;
@@ -70,40 +81,54 @@ Ciphertext<DCRTPoly> compExactNPM(
 }
 
 // Subroutine for Prob NPC
-Ciphertext<DCRTPoly> randWSum(
+// out = sum_i r_i * x[i] for random r_i; x is left untouched, tmp is a work buffer.
+void randWSum(
     FHECTX &ctx,
-    std::vector<Ciphertext<DCRTPoly>> &x
+    const std::vector<Ciphertext<DCRTPoly>> &x,
+    Ciphertext<DCRTPoly> &out,
+    Ciphertext<DCRTPoly> &tmp
 ) {
     uint32_t numCtxts = x.size();
 
     // Randomness
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    thread_local std::mt19937 gen(std::random_device{}());
     std::uniform_int_distribution<int64_t> dist(1, ctx.modulus - 1);
 
-    int64_t randNum;
-
-    // std::vector<Ciphertext<DCRTPoly>> y(x.size());
-
-    for (uint32_t i = 0; i < numCtxts; i++) {
-        randNum = dist(gen);
-        ctxtMulByConstantInPlace(x[i], randNum);
+    *out = *x[0];
+    ctxtMulByConstantInPlace(out, dist(gen));
+    for (uint32_t i = 1; i < numCtxts; i++) {
+        *tmp = *x[i];
+        ctxtMulByConstantInPlace(tmp, dist(gen));
+        ctx.cc->EvalAddInPlace(out, tmp);
     }
-    return ctx.cc->EvalAddMany(x);
 }
 
 // ProbNPC
+// The random combinations are written into the preallocated randCtxt.
+Ciphertext<DCRTPoly> compProbNPM (
+    FHECTX &ctx,
+    const std::vector<Ciphertext<DCRTPoly>> &x,
+    int32_t alpha,
+    std::vector<Ciphertext<DCRTPoly>> &randCtxt,
+    Ciphertext<DCRTPoly> &tmp
+) {
+    // Probabilistic Reduction
+    for (uint32_t i = 0; i < randCtxt.size(); i++) {
+        randWSum(ctx, x, randCtxt[i], tmp);
+    }
+    return compExactNPM(ctx, randCtxt, alpha);
+}
+
 Ciphertext<DCRTPoly> compProbNPM (
     FHECTX &ctx,
     std::vector<Ciphertext<DCRTPoly>> &x,
     int32_t alpha,
     uint32_t numRand
 ) {
-    // Probabilistic Reduction
     std::vector<Ciphertext<DCRTPoly>> randCtxt(numRand);
-
     for (uint32_t i = 0; i < numRand; i++) {
-        randCtxt[i] = randWSum(ctx, x);
+        randCtxt[i] = x[0]->Clone();
     }
-    return compExactNPM(ctx, randCtxt, alpha);
-}
\ No newline at end of file
+    Ciphertext<DCRTPoly> tmp = x[0]->Clone();
+    return compProbNPM(ctx, x, alpha, randCtxt, tmp);
+}
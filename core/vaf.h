@@ -3,18 +3,34 @@
 
 #include "utils.h"
 
+void compVAF16InPlace(
+    FHECTX &ctx,
+    Ciphertext<DCRTPoly> &x,
+    Plaintext ptOne
+);
+
 Ciphertext<DCRTPoly> compVAF16(
     FHECTX &ctx,
     Ciphertext<DCRTPoly> &x,
     Plaintext ptOne
 );
 
+// Overwrites x; the result shares its handle with x[0].
 Ciphertext<DCRTPoly> compExactNPM(
     FHECTX &ctx,
     std::vector<Ciphertext<DCRTPoly>> &x,
     int32_t alpha
 );
 
+// Keeps x; the result shares its handle with randCtxt[0].
+Ciphertext<DCRTPoly> compProbNPM(
+    FHECTX &ctx,
+    const std::vector<Ciphertext<DCRTPoly>> &x,
+    int32_t alpha,
+    std::vector<Ciphertext<DCRTPoly>> &randCtxt,
+    Ciphertext<DCRTPoly> &tmp
+);
+
 Ciphertext<DCRTPoly> compProbNPM(
     FHECTX &ctx,
     std::vector<Ciphertext<DCRTPoly>> &x,
@@ -0,0 +1,273 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "openfhe.h"
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+// Compact wire format for ciphertexts.
+// Each RNS tower is bit-packed to the width of its modulus, and only the
+// towers left after Compress are written. Layout of one ciphertext:
+//   u8 version, u8 numElems, u8 numTowers, u8 format, u8 encoding,
+//   u32 ringDim, u32 level, u32 noiseScaleDeg, u32 slots, bytes keyTag,
+//   u8 width per tower, then the packed towers of every element in order.
+// Header-only, so that every protocol library can use it.
+
+#define WIRE_VERSION 1
+
+// Plain values and length-prefixed byte strings
+template <typename T>
+void putVal(std::string &buf, const T &val) {
+    buf.append(reinterpret_cast<const char *>(&val), sizeof(T));
+}
+
+template <typename T>
+T getVal(const std::string &buf, size_t &pos) {
+    if (pos + sizeof(T) > buf.size()) {
+        throw std::runtime_error("Truncated frame");
+    }
+    T val;
+    std::memcpy(&val, buf.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return val;
+}
+
+inline void putBytes(std::string &buf, const std::string &bytes) {
+    putVal<uint64_t>(buf, bytes.size());
+    buf.append(bytes);
+}
+
+inline std::string getBytes(const std::string &buf, size_t &pos) {
+    uint64_t len = getVal<uint64_t>(buf, pos);
+    if (pos + len > buf.size()) {
+        throw std::runtime_error("Truncated frame");
+    }
+    std::string ret = buf.substr(pos, len);
+    pos += len;
+    return ret;
+}
+
+// Bit packing of one tower; values are written LSB first
+inline size_t packedTowerSize(uint32_t ringDim, uint32_t width) {
+    return ((size_t)ringDim * width + 7) / 8;
+}
+
+inline void packTower(const NativePoly &poly, uint32_t ringDim, uint32_t width, uint8_t *out) {
+    unsigned __int128 acc = 0;
+    uint32_t numBits = 0;
+    for (uint32_t j = 0; j < ringDim; j++) {
+        acc |= (unsigned __int128)poly[j].ConvertToInt() << numBits;
+        numBits += width;
+        if (numBits >= 64) {
+            uint64_t word = (uint64_t)acc;
+            std::memcpy(out, &word, 8);
+            out += 8;
+            acc >>= 64;
+            numBits -= 64;
+        }
+    }
+    for (; numBits > 0; numBits -= std::min<uint32_t>(numBits, 8)) {
+        *out++ = (uint8_t)acc;
+        acc >>= 8;
+    }
+}
+
+// Decodes straight into the tower of the ciphertext; no staging buffer
+inline void unpackTower(const uint8_t *in, uint32_t ringDim, uint32_t width, NativePoly &poly) {
+    const uint8_t *end = in + packedTowerSize(ringDim, width);
+    uint64_t mask = (width == 64) ? ~0ULL : ((1ULL << width) - 1);
+    unsigned __int128 acc = 0;
+    uint32_t numBits = 0;
+    for (uint32_t j = 0; j < ringDim; j++) {
+        if (numBits < width) {
+            if (end - in >= 8) {
+                uint64_t word;
+                std::memcpy(&word, in, 8);
+                in += 8;
+                acc |= (unsigned __int128)word << numBits;
+                numBits += 64;
+            } else {
+                while (numBits < width && in < end) {
+                    acc |= (unsigned __int128)(*in++) << numBits;
+                    numBits += 8;
+                }
+            }
+        }
+        poly[j] = NativeInteger((uint64_t)acc & mask);
+        acc >>= width;
+        numBits -= width;
+    }
+}
+
+// Element parameters with the first numTowers moduli, shared across decodes.
+// Keyed on the cyclotomic order, moduli and roots of unity rather than on the
+// context, whose address a later context may reuse.
+inline std::shared_ptr<DCRTPoly::Params> wireTowerParams(
+    const CryptoContext<DCRTPoly> &cc,
+    uint32_t numTowers
+) {
+    static std::mutex cacheLock;
+    static std::map<std::vector<uint64_t>, std::shared_ptr<DCRTPoly::Params>> cache;
+
+    auto fullParams = cc->GetCryptoParameters()->GetElementParams();
+    uint32_t numFull = fullParams->GetParams().size();
+    if (numTowers == 0 || numTowers > numFull) {
+        throw std::runtime_error("Invalid number of towers in the wire format");
+    }
+    std::vector<uint64_t> key = {fullParams->GetCyclotomicOrder(), numTowers};
+    for (auto &tower : fullParams->GetParams()) {
+        key.push_back(tower->GetModulus().ConvertToInt());
+        key.push_back(tower->GetRootOfUnity().ConvertToInt());
+    }
+
+    std::lock_guard<std::mutex> guard(cacheLock);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    // Same path as Compress, so the parameters compare equal
+    DCRTPoly tmp(fullParams, Format::EVALUATION, true);
+    tmp.DropLastElements(numFull - numTowers);
+    cache[key] = tmp.GetParams();
+    return cache[key];
+}
+
+inline size_t wireSize(const Ciphertext<DCRTPoly> &ctxt) {
+    const std::vector<DCRTPoly> &elems = ctxt->GetElements();
+    const std::vector<NativePoly> &towers = elems[0].GetAllElements();
+    uint32_t ringDim = elems[0].GetRingDimension();
+
+    size_t size = 5 + 4 * 4 + 8 + ctxt->GetKeyTag().size() + towers.size();
+    for (auto &tower : towers) {
+        size += elems.size() * packedTowerSize(ringDim, tower.GetModulus().GetMSB());
+    }
+    return size;
+}
+
+// numElems > 0 writes only the first numElems elements (seeded ciphertexts)
+inline void encodeCtxt(std::string &buf, const Ciphertext<DCRTPoly> &ctxt, uint32_t numElems = 0) {
+    const std::vector<DCRTPoly> &elems = ctxt->GetElements();
+    if (numElems == 0 || numElems > elems.size()) {
+        numElems = elems.size();
+    }
+    uint32_t numTowers = elems[0].GetNumOfElements();
+    uint32_t ringDim = elems[0].GetRingDimension();
+
+    putVal<uint8_t>(buf, WIRE_VERSION);
+    putVal<uint8_t>(buf, numElems);
+    putVal<uint8_t>(buf, numTowers);
+    putVal<uint8_t>(buf, elems[0].GetFormat() == Format::EVALUATION);
+    putVal<uint8_t>(buf, ctxt->GetEncodingType());
+    putVal<uint32_t>(buf, ringDim);
+    putVal<uint32_t>(buf, ctxt->GetLevel());
+    putVal<uint32_t>(buf, ctxt->GetNoiseScaleDeg());
+    putVal<uint32_t>(buf, ctxt->GetSlots());
+    putBytes(buf, ctxt->GetKeyTag());
+
+    std::vector<uint32_t> widths(numTowers);
+    std::vector<size_t> offsets(numTowers + 1, 0);
+    for (uint32_t i = 0; i < numTowers; i++) {
+        widths[i] = elems[0].GetAllElements()[i].GetModulus().GetMSB();
+        offsets[i + 1] = offsets[i] + packedTowerSize(ringDim, widths[i]);
+        putVal<uint8_t>(buf, widths[i]);
+    }
+
+    size_t base = buf.size();
+    buf.resize(base + numElems * offsets[numTowers]);
+    uint8_t *out = reinterpret_cast<uint8_t *>(&buf[base]);
+
+    #pragma omp parallel for collapse(2)
+    for (uint32_t e = 0; e < numElems; e++) {
+        for (uint32_t i = 0; i < numTowers; i++) {
+            packTower(
+                elems[e].GetAllElements()[i], ringDim, widths[i],
+                out + e * offsets[numTowers] + offsets[i]
+            );
+        }
+    }
+}
+
+inline Ciphertext<DCRTPoly> decodeCtxt(
+    const CryptoContext<DCRTPoly> &cc,
+    const std::string &buf,
+    size_t &pos
+) {
+    if (getVal<uint8_t>(buf, pos) != WIRE_VERSION) {
+        throw std::runtime_error("Unknown wire format version");
+    }
+    uint32_t numElems = getVal<uint8_t>(buf, pos);
+    uint32_t numTowers = getVal<uint8_t>(buf, pos);
+    Format format = getVal<uint8_t>(buf, pos) ? Format::EVALUATION : Format::COEFFICIENT;
+    PlaintextEncodings encoding = (PlaintextEncodings)getVal<uint8_t>(buf, pos);
+    uint32_t ringDim = getVal<uint32_t>(buf, pos);
+    uint32_t level = getVal<uint32_t>(buf, pos);
+    uint32_t noiseScaleDeg = getVal<uint32_t>(buf, pos);
+    uint32_t slots = getVal<uint32_t>(buf, pos);
+    std::string keyTag = getBytes(buf, pos);
+
+    if (ringDim != cc->GetRingDimension()) {
+        throw std::runtime_error("Ring dimension does not match the crypto context");
+    }
+    std::shared_ptr<DCRTPoly::Params> params = wireTowerParams(cc, numTowers);
+
+    std::vector<uint32_t> widths(numTowers);
+    std::vector<size_t> offsets(numTowers + 1, 0);
+    for (uint32_t i = 0; i < numTowers; i++) {
+        widths[i] = getVal<uint8_t>(buf, pos);
+        if (widths[i] != params->GetParams()[i]->GetModulus().GetMSB()) {
+            throw std::runtime_error("Tower moduli do not match the crypto context");
+        }
+        offsets[i + 1] = offsets[i] + packedTowerSize(ringDim, widths[i]);
+    }
+    if (pos + numElems * offsets[numTowers] > buf.size()) {
+        throw std::runtime_error("Truncated frame");
+    }
+
+    std::vector<DCRTPoly> elems(numElems, DCRTPoly(params, format, true));
+    const uint8_t *in = reinterpret_cast<const uint8_t *>(buf.data() + pos);
+
+    #pragma omp parallel for collapse(2)
+    for (uint32_t e = 0; e < numElems; e++) {
+        for (uint32_t i = 0; i < numTowers; i++) {
+            unpackTower(
+                in + e * offsets[numTowers] + offsets[i], ringDim, widths[i],
+                elems[e].GetElementAtIndex(i)
+            );
+        }
+    }
+    pos += numElems * offsets[numTowers];
+
+    Ciphertext<DCRTPoly> ctxt = std::make_shared<CiphertextImpl<DCRTPoly>>(cc, keyTag, encoding);
+    ctxt->SetElements(std::move(elems));
+    ctxt->SetLevel(level);
+    ctxt->SetNoiseScaleDeg(noiseScaleDeg);
+    ctxt->SetSlots(slots);
+    return ctxt;
+}
+
+inline void encodeCtxts(std::string &buf, const std::vector<Ciphertext<DCRTPoly>> &ctxts) {
+    putVal<uint32_t>(buf, ctxts.size());
+    for (auto &ctxt : ctxts) {
+        encodeCtxt(buf, ctxt);
+    }
+}
+
+inline std::vector<Ciphertext<DCRTPoly>> decodeCtxts(
+    const CryptoContext<DCRTPoly> &cc,
+    const std::string &buf,
+    size_t &pos
+) {
+    std::vector<Ciphertext<DCRTPoly>> ctxts(getVal<uint32_t>(buf, pos));
+    for (auto &ctxt : ctxts) {
+        ctxt = decodeCtxt(cc, buf, pos);
+    }
+    return ctxts;
+}
+
+#endif
@@ -79,6 +79,15 @@ public:
         return cc->MakePackedPlaintext(vals);
     }
 
+    // Packed and moved to the evaluation (NTT) domain of the full modulus
+    // chain, the form EvalMult works in; products with it skip the forward
+    // NTT. Meant for plaintexts that are only multiplied.
+    Plaintext packingEval(const std::vector<int64_t>& vals) {
+        Plaintext pt = cc->MakePackedPlaintext(vals);
+        pt->SetFormat(Format::EVALUATION);
+        return pt;
+    }
+
     Ciphertext<DCRTPoly> encrypt(const Plaintext& pt) {
         return cc->Encrypt(keyPair.publicKey, pt);
     }
@@ -148,6 +157,10 @@ public:
         return cc->Compress(ct, level);
     }
 
+    CryptoContext<DCRTPoly> getCryptoContext() const {
+        return cc;
+    }
+
     // (Optional) Rescale or compress if needed – not shown here
     // ...
 
@@ -4,6 +4,7 @@
 #include "HE.h"
 #include <openfhe.h>
 #include "core.h"
+#include "../core/aggtree.h"
 
 using namespace lbcrypto;
 
@@ -129,9 +130,20 @@ ResponseServer compProbInterDBHybrid (
     Ciphertext<DCRTPoly> queryCtxt
 );
 
+// Compact wire format of a response (core/wire.h)
+void encodeResponse(std::string &buf, const ResponseServer &response);
+ResponseServer decodeResponse(HE &bfv, const std::string &buf, size_t &pos);
+
+Ciphertext<DCRTPoly> compAggResponses(
+    HE &bfv,
+    const std::vector<ResponseServer> &responses
+);
+
+// Aggregation tree with an AggOp::SUM plan (core/aggtree.h)
 Ciphertext<DCRTPoly> compAggResponses(
     HE &bfv,
-    std::vector<ResponseServer> responses
+    const std::vector<ResponseServer> &responses,
+    const AggTreePlan &plan
 );
 
 Ciphertext<DCRTPoly> sumOverSlots(
@@ -22,16 +22,31 @@ PEPSIQuery encryptClientData (
 }
 
 
+void encodePEPSIQuery(std::string &buf, const PEPSIQuery &query) {
+    putVal<uint32_t>(buf, query.numCtxt);
+    putVal<uint32_t>(buf, query.kVal);
+    encodeCtxts(buf, query.payload);
+}
+
+PEPSIQuery decodePEPSIQuery(HE &bfv, const std::string &buf, size_t &pos) {
+    PEPSIQuery query;
+    query.numCtxt = getVal<uint32_t>(buf, pos);
+    query.kVal = getVal<uint32_t>(buf, pos);
+    query.payload = decodeCtxts(bfv.getCryptoContext(), buf, pos);
+    return query;
+}
+
 PEPSIQuery encryptClientDataPSI (
     HE &bfv,
     std::vector<int64_t> data,
     uint32_t numCtxt,
-    uint32_t kVal
+    uint32_t kVal,
+    const PermHashParams *perm
 ) {
 
-    std::vector<int64_t> hashTable = computeCuckooHashTableClientPEPSI(
-        data, bfv.ringDim, bfv.ringDim / 4096, -1
-    );
+    std::vector<int64_t> hashTable = (perm == nullptr)
+        ? computeCuckooHashTableClientPEPSI(data, bfv.ringDim, bfv.ringDim / 4096, -1)
+        : computeCuckooHashTableClientPEPSIPerm(data, bfv.ringDim, bfv.ringDim / 4096, -1, *perm);
 
     // Expand w.r.t. codewords
     std::vector<std::vector<int64_t>> msgVecs(numCtxt);
@@ -28,6 +28,21 @@ std::vector<std::vector<uint64_t>> chooseTable(uint64_t n) {
     return ret;
 }
 
+uint32_t minCWLength(
+    uint32_t numBits,
+    uint32_t HW
+) {
+    uint32_t len = HW;
+    // log2 C(len, HW)
+    auto logChoose = [HW](uint32_t n) {
+        return (std::lgamma(n + 1.0) - std::lgamma(HW + 1.0) - std::lgamma(n - HW + 1.0)) / std::log(2.0);
+    };
+    while (logChoose(len) < numBits) {
+        len++;
+    }
+    return len;
+}
+
 // Codeword Mapping
 // Perfect Encoding
 std::vector<int64_t> getCW(
@@ -83,14 +98,26 @@ std::vector<int64_t> getCWTable(
 }
 
 
+std::vector<Plaintext> makeEQConsts(
+    HE &bfv,
+    uint32_t kVal
+) {
+    std::vector<Plaintext> ret(kVal);
+    for (uint32_t i = 0; i < kVal; i++) {
+        std::vector<int64_t> ptNum(bfv.ringDim, i);
+        ret[i] = bfv.packing(ptNum);
+    }
+    return ret;
+}
+
 // Arith-CW-EQ
 Ciphertext<DCRTPoly> arithCWEQ(
     HE &bfv,
-    std::vector<Ciphertext<DCRTPoly>> ctxt1,
+    const std::vector<Ciphertext<DCRTPoly>> &ctxt1,
     // std::vector<Plaintext> ctxt2,
-    std::vector<Ciphertext<DCRTPoly>> ctxt2,
-    Plaintext ptDiv,
-    uint32_t kVal
+    const std::vector<Ciphertext<DCRTPoly>> &ctxt2,
+    const Plaintext &ptDiv,
+    const std::vector<Plaintext> &ptConsts
 ) {
     uint32_t numCtxt = ctxt1.size();
 
@@ -108,13 +135,12 @@ Ciphertext<DCRTPoly> arithCWEQ(
 
     // Evaluate Equality Circuit
     // 1/k! * prod(x-i)
+    uint32_t kVal = ptConsts.size();
     retVec.resize(kVal); 
 
     // Step 1. Prepare the inner term
     for (uint32_t i = 0; i < kVal; i++) {
-        std::vector<int64_t> ptNum(bfv.ringDim, i);
-        Plaintext _tmp = bfv.packing(ptNum);
-        retVec[i] = bfv.sub(_tmp, ret);
+        retVec[i] = bfv.sub(ptConsts[i], ret);
     }
 
     // Step 2. Multiply ALL!
@@ -129,11 +155,11 @@ Ciphertext<DCRTPoly> arithCWEQ(
 
 Ciphertext<DCRTPoly> arithCWEQPtxt(
     HE &bfv,
-    std::vector<Ciphertext<DCRTPoly>> ctxt,
+    const std::vector<Ciphertext<DCRTPoly>> &ctxt,
     // std::vector<Plaintext> ctxt2,
-    std::vector<Plaintext> ptxt,
-    Plaintext ptDiv,
-    uint32_t kVal
+    const std::vector<Plaintext> &ptxt,
+    const Plaintext &ptDiv,
+    const std::vector<Plaintext> &ptConsts
 ) {
     uint32_t numCtxt = ctxt.size();
 
@@ -151,13 +177,12 @@ Ciphertext<DCRTPoly> arithCWEQPtxt(
 
     // Evaluate Equality Circuit
     // 1/k! * prod(x-i)
+    uint32_t kVal = ptConsts.size();
     retVec.resize(kVal); 
 
     // Step 1. Prepare the inner term
     for (uint32_t i = 0; i < kVal; i++) {
-        std::vector<int64_t> ptNum(bfv.ringDim, i);
-        Plaintext _tmp = bfv.packing(ptNum);
-        retVec[i] = bfv.sub(_tmp, ret);
+        retVec[i] = bfv.sub(ptConsts[i], ret);
     }
 
     // Step 2. Multiply ALL!
@@ -20,7 +20,8 @@ void printUsage() {
               << " -bitlen <int>"
               << " -HW <int>"
               << " -isEncrypted <bool>"
-              << " -isPSI <bool>" << "\n\n";
+              << " -isPSI <bool>"
+              << " [-perm <bool>]" << "\n\n";
             //   << " -allowIntersection <0 or 1>\n\n"
             //   << "Example:\n"
             //   << "  ./main -numItem 30 -lenData 2 -numPack 4 -numAgg 10 -alpha 5 -interType (CI or CPI or CIH or CPIH) -allowIntersection 1 \n\n";
@@ -95,6 +96,16 @@ int main(int argc, char* argv[]) {
     }
     bool isPSI = (args["-isPSI"] == "1");
 
+    // Parse perm (optional; permutation-based hashing for PSI)
+    bool usePerm = false;
+    if (args.find("-perm") != args.end()) {
+        if (args["-perm"] != "0" && args["-perm"] != "1") {
+            std::cerr << "Error: perm must be either 0 (false) or 1 (true).\n";
+            return 1;
+        }
+        usePerm = (args["-perm"] == "1");
+    }
+
     // 3. Print final values
     std::cout << "Running testFullProtocol with:\n"
               << "  numItem     = " << numItem << "\n"
@@ -102,12 +113,17 @@ int main(int argc, char* argv[]) {
               << "  HW          = " << HW << "\n"
               << "  isEncrypted = " << isEncrypted << "\n"
               << "  isPSI = " << isPSI << "\n"
+              << "  perm = " << usePerm << "\n"
             //   << "  alpha     = " << alpha << "\n"
             //   << "  interType = " << interType << "\n"
             //   << "  allowIntersection = " << (allowIntersection ? "true" : "false") << "\n";
               << "\n";
 
-    if (isPSI) {
+    if (isPSI && usePerm) {
+        testPEPSIProtocolPSIPerm(
+            numItem, bitlen, HW, isEncrypted
+        );
+    } else if (isPSI) {
         testPEPSIProtocolPSI(
             numItem, bitlen, HW, isEncrypted
         );
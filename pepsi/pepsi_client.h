@@ -3,6 +3,8 @@
 
 #include <openfhe.h>
 #include "HE.h"
+#include "pepsi_hashing.h"
+#include "../core/wire.h"
 
 using namespace lbcrypto;
 
@@ -12,6 +14,10 @@ typedef struct _PEPSIQuery {
     uint32_t kVal;
 } PEPSIQuery;
 
+// Compact wire format of a query (core/wire.h)
+void encodePEPSIQuery(std::string &buf, const PEPSIQuery &query);
+PEPSIQuery decodePEPSIQuery(HE &bfv, const std::string &buf, size_t &pos);
+
 PEPSIQuery encryptClientData(
     HE &bfv,
     uint64_t data,
@@ -23,7 +29,8 @@ PEPSIQuery encryptClientDataPSI (
     HE &bfv,
     std::vector<int64_t> data,
     uint32_t numCtxt,
-    uint32_t kVal
+    uint32_t kVal,
+    const PermHashParams *perm = nullptr
 );
 
 bool checkIntResult (
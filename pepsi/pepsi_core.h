@@ -11,6 +11,12 @@ using namespace lbcrypto;
 
 std::vector<std::vector<uint64_t>> chooseTable(uint64_t n);
 
+// Smallest codeword length with C(len, HW) >= 2^numBits
+uint32_t minCWLength(
+    uint32_t numBits,
+    uint32_t HW
+);
+
 std::vector<int64_t> getCW(
     uint64_t data,
     uint32_t numCtxt,
@@ -18,21 +24,28 @@ std::vector<int64_t> getCW(
 );
 
 
+// Constant plaintexts 0..kVal-1 of the equality circuit; built once per
+// query and shared by every chunk
+std::vector<Plaintext> makeEQConsts(
+    HE &bfv,
+    uint32_t kVal
+);
+
 Ciphertext<DCRTPoly> arithCWEQ(
     HE &bfv,
-    std::vector<Ciphertext<DCRTPoly>> ctxt1,
+    const std::vector<Ciphertext<DCRTPoly>> &ctxt1,
     // std::vector<Plaintext> ctxt2,
-    std::vector<Ciphertext<DCRTPoly>> ctxt2,    
-    Plaintext ptDiv,
-    uint32_t kVal
+    const std::vector<Ciphertext<DCRTPoly>> &ctxt2,
+    const Plaintext &ptDiv,
+    const std::vector<Plaintext> &ptConsts
 );
 
 Ciphertext<DCRTPoly> arithCWEQPtxt(
     HE &bfv,
-    std::vector<Ciphertext<DCRTPoly>> ctxt,
-    std::vector<Plaintext> ptxt,
-    Plaintext ptDiv,
-    uint32_t kVal
+    const std::vector<Ciphertext<DCRTPoly>> &ctxt,
+    const std::vector<Plaintext> &ptxt,
+    const Plaintext &ptDiv,
+    const std::vector<Plaintext> &ptConsts
 );
 
 std::vector<int64_t> getCWTable(
@@ -1,122 +1,70 @@
 #include "pepsi_hashing.h"
 
+// Single-word items; identical to computeHash over a length-1 vector.
 uint64_t computeHashPEPSI(
     int64_t input, 
     uint32_t salt = 42
 ) {
-    unsigned char hash[SHA256_DIGEST_LENGTH] = {0};
-
-    // Use EVP (Recommended for OpenSSL 3.x)
-    EVP_MD_CTX* sha256 = EVP_MD_CTX_new();
-    EVP_DigestInit_ex(sha256, EVP_sha256(), nullptr);
-    EVP_DigestUpdate(sha256, &salt, sizeof(salt));
-    EVP_DigestUpdate(sha256, &input, sizeof(input));
-
-    EVP_DigestFinal_ex(sha256, hash, nullptr);
-    EVP_MD_CTX_free(sha256);  // Free the context
-
-    uint64_t* result_ptr = reinterpret_cast<uint64_t*>(hash);
-    return *result_ptr;
+    return computeHash(&input, 1, salt);
 }
 
 // Cuckoo Hashing
-
-// A single bin entry
-struct BinEntry {
-    int64_t value;
-    int32_t loc; // which hash function index
-    bool isEmpty;
-    BinEntry(uint64_t v = -1, int32_t l=-1): value(v), loc(l), isEmpty(true) {}
-};
-
-// Insert with recursive cuckoo hashing
-bool Insert(
-    std::vector<BinEntry>& bins,
-    int64_t w,
-    int32_t i,
-    uint32_t m,                 // number of bins
-    uint32_t h,                 // number of hash functions
-    uint32_t depthLimit=10    // recursion limit
-) {
-    if (depthLimit == 0) return false; // fail if too deep
-
-    // location function = hash with salt=i
-    uint32_t pos = computeHashPEPSI(w, i) % m;
-
-    // swap (w,i) with current entry
-    BinEntry tmp = bins[pos];
-    bins[pos] = BinEntry(w, i);
-    bins[pos].isEmpty = false;
-
-    // if displaced item is empty, done
-    if (tmp.isEmpty) {
-        return true;
-    }
-
-    // otherwise, recurse with displaced item, but pick a new hash function j != tmp.loc
-    for (uint32_t j = 0; j < h; j++) {
-        if (j == (uint32_t)tmp.loc) continue;
-        if (Insert(bins, tmp.value, j, m, h, depthLimit-1)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-// Receiver side: insert Y into cuckoo table
-std::vector<BinEntry> cuckooInsertReceiver(
-    const std::vector<int64_t>& Y,
-    uint32_t m,   // number of bins
-    uint32_t h    // number of hash functions
-) {
-    std::vector<BinEntry> bins(m, BinEntry());
-
-    for (auto& y : Y) {
-        bool ok = false;
-        for (uint32_t i = 0; i < h; i++) {
-            if (Insert(bins, y, i, m, h)) {
-                ok = true;
-                break;
-            }
-        }
-        if (!ok) {
-            std::cerr << "Insertion failed for " << y << std::endl;
-            throw std::runtime_error("Cuckoo hashing failed");
-        }
-    }
-    return bins;
-}
-
 std::vector<int64_t> computeCuckooHashTableClientPEPSI(
-    std::vector<int64_t> &inputVec,
+    const std::vector<int64_t> &inputVec,
     uint32_t ringDim,
     uint32_t dimElem,
-    int64_t dummyVal
+    int64_t dummyVal,
+    uint32_t h,
+    std::vector<int64_t> *stashItems,
+    CuckooStats *stats
 ) {
     uint32_t numBins = ringDim / dimElem;
+    uint32_t numItems = inputVec.size();
 
-    std::vector<BinEntry> hashBins = cuckooInsertReceiver(
-        inputVec, numBins, 3
+    // Locations of every item w.r.t. every hash function
+    std::vector<uint32_t> pos((uint64_t)numItems * h);
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < numItems; i++) {
+        for (uint32_t j = 0; j < h; j++) {
+            pos[(uint64_t)i * h + j] = computeHashPEPSI(inputVec[i], j) % numBins;
+        }
+    }
+
+    CuckooTable table = cuckooInsert(
+        pos, numItems, numBins, h, CUCKOO_MAX_EVICTIONS,
+        stashItems == nullptr ? 0 : CUCKOO_STASH_SIZE
     );
 
     // Interpret Bins; Just Copy Values
     std::vector<int64_t> ret(ringDim, dummyVal);
  
     for (uint32_t i = 0; i < numBins; i++) {
-        auto currBin = hashBins[i];
-        if (currBin.isEmpty) {
+        int32_t idx = table.bins[i];
+        if (idx < 0) {
             continue;
-        } else {
-            for (uint32_t j = 0; j < dimElem; j++) {
-                ret[i + numBins * j] = currBin.value;
-            }
+        }
+        for (uint32_t j = 0; j < dimElem; j++) {
+            ret[i + numBins * j] = inputVec[idx];
         }
     }
+
+    // Stashed items should be queried separately by the caller
+    if (stashItems != nullptr) {
+        stashItems->clear();
+        for (uint32_t idx : table.stash) {
+            stashItems->push_back(inputVec[idx]);
+        }
+    }
+    if (stats != nullptr) {
+        *stats = table.stats;
+    }
     return ret;
 }
 
-std::vector<std::vector<int64_t>> computeCuckooHashTableServerPEPSI(
-    std::vector<int64_t> inputVec,
+// Items are single words, so the table has one word per entry;
+// dimElem only determines the number of bins.
+SimpleHashTable computeCuckooHashTableServerPEPSI(
+    const std::vector<int64_t> &inputVec,
     uint32_t ringDim,
     uint32_t maxBin,
     uint32_t dimElem,
@@ -125,34 +73,82 @@ std::vector<std::vector<int64_t>> computeCuckooHashTableServerPEPSI(
 ) {
     // Assume that the input vector is already pre-processed well.
     uint32_t numBins = ringDim / dimElem;
-    std::vector<std::vector<int64_t>> retTable(ringDim);
-    std::vector<uint32_t> currItems(ringDim, 0);
+    uint32_t numItems = inputVec.size();
 
     std::cout << "Max Bin: " << maxBin << std::endl;    
 
-    for (auto& innerVec: retTable) {
-        innerVec.resize(maxBin, dummyVal);
-    }        
+    std::vector<uint32_t> pos((uint64_t)numItems * h);
+    #pragma omp parallel for
+    for (uint32_t i = 0; i < numItems; i++) {
+        for (uint32_t j = 0; j < h; j++) {
+            pos[(uint64_t)i * h + j] = computeHashPEPSI(inputVec[i], j) % numBins;
+        }
+    }
+
+    SimpleHashTable table = buildSimpleHashTable(
+        pos, numItems, h, numBins, 1, maxBin, dummyVal, false,
+        [&](uint64_t i, uint32_t, uint32_t) { return inputVec[i]; }
+    );
 
+    std::cout << "Actual Max Bin: " << table.actualMaxBin << std::endl;
+    return table;
+}
+
+std::vector<int64_t> computeCuckooHashTableClientPEPSIPerm(
+    const std::vector<int64_t> &inputVec,
+    uint32_t ringDim,
+    uint32_t dimElem,
+    int64_t dummyVal,
+    const PermHashParams &perm,
+    std::vector<int64_t> *stashItems,
+    CuckooStats *stats
+) {
+    uint32_t numBins = ringDim / dimElem;
+    if (perm.numBins != numBins || perm.remWords != 1) {
+        throw std::runtime_error("Invalid parameters for permutation-based hashing");
+    }
+
+    std::vector<std::vector<int64_t>> items(inputVec.size());
     for (uint32_t i = 0; i < inputVec.size(); i++) {
+        items[i] = {inputVec[i]};
+    }
 
-        for (uint32_t j = 0; j < h; j++) {
-            uint64_t ret = computeHashPEPSI(inputVec[i], j) % numBins;
-            retTable[ret][currItems[ret]] = inputVec[i];
-            currItems[ret]++;
-            if (currItems[ret] > maxBin) {
-                throw std::runtime_error("Too many items in a bin");
-            }            
+    std::vector<std::vector<int64_t>> stash;
+    std::vector<int64_t> slots = computeCuckooHashTableClientPerm(
+        items, numBins, dummyVal, perm,
+        stashItems == nullptr ? nullptr : &stash, stats
+    );
+
+    // Replicate remainders
+    std::vector<int64_t> ret(ringDim, dummyVal);
+    for (uint32_t i = 0; i < numBins; i++) {
+        for (uint32_t j = 0; j < dimElem; j++) {
+            ret[i + numBins * j] = slots[i];
         }
     }
 
-    uint32_t actualMaxBin = *std::max_element(currItems.begin(), currItems.end());
+    if (stashItems != nullptr) {
+        stashItems->clear();
+        for (auto &item : stash) {
+            stashItems->push_back(item[0]);
+        }
+    }
+    return ret;
+}
 
-    // Trim the table
-    for (auto& innerVec: retTable) {
-        innerVec.resize(maxBin);
-    }        
+SimpleHashTable computeCuckooHashTableServerPEPSIPerm(
+    const std::vector<int64_t> &inputVec,
+    uint32_t maxBin,
+    int64_t dummyVal,
+    const PermHashParams &perm
+) {
+    if (perm.remWords != 1) {
+        throw std::runtime_error("Invalid parameters for permutation-based hashing");
+    }
 
-    std::cout << "Actual Max Bin: " << actualMaxBin << std::endl;
-    return retTable;
-}
\ No newline at end of file
+    std::vector<std::vector<int64_t>> items(inputVec.size());
+    for (uint32_t i = 0; i < inputVec.size(); i++) {
+        items[i] = {inputVec[i]};
+    }
+    return computeCuckooHashTableServerPerm(items, maxBin, dummyVal, perm);
+}
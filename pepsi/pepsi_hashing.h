@@ -11,16 +11,21 @@
 #include <openssl/sha.h>
 
 #include "../core/utils.h"
+#include "../core/hashing.h"
 
+// Without stashItems, a non-empty stash is treated as a failure.
 std::vector<int64_t> computeCuckooHashTableClientPEPSI(
-    std::vector<int64_t> &inputVec,
+    const std::vector<int64_t> &inputVec,
     uint32_t ringDim,
     uint32_t dimElem,
-    int64_t dummyVal
+    int64_t dummyVal,
+    uint32_t h = 3,
+    std::vector<int64_t> *stashItems = nullptr,
+    CuckooStats *stats = nullptr
 );
 
-std::vector<std::vector<int64_t>> computeCuckooHashTableServerPEPSI(
-    std::vector<int64_t> inputVec,
+SimpleHashTable computeCuckooHashTableServerPEPSI(
+    const std::vector<int64_t> &inputVec,
     uint32_t ringDim,
     uint32_t maxBin,
     uint32_t dimElem,
@@ -28,4 +33,23 @@ std::vector<std::vector<int64_t>> computeCuckooHashTableServerPEPSI(
     uint32_t h
 );
 
+// Permutation-based hashing; perm.numBins should be ringDim / dimElem.
+// Bins hold the remainders (xR || j), which need fewer bits than the items.
+std::vector<int64_t> computeCuckooHashTableClientPEPSIPerm(
+    const std::vector<int64_t> &inputVec,
+    uint32_t ringDim,
+    uint32_t dimElem,
+    int64_t dummyVal,
+    const PermHashParams &perm,
+    std::vector<int64_t> *stashItems = nullptr,
+    CuckooStats *stats = nullptr
+);
+
+SimpleHashTable computeCuckooHashTableServerPEPSIPerm(
+    const std::vector<int64_t> &inputVec,
+    uint32_t maxBin,
+    int64_t dummyVal,
+    const PermHashParams &perm
+);
+
 #endif 
\ No newline at end of file
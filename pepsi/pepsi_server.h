@@ -2,6 +2,7 @@
 #define PEPSI_SERVER
 
 #include <openfhe.h>
+#include <memory>
 #include <vector>
 #include "pepsi_client.h"
 
@@ -44,18 +45,34 @@ PEPSIDB constructPEPSIDB (
     bool isEncrypted
 );
 
+// With perm, bins hold remainders and numCtxt can be reduced accordingly; it must be
+// at least minCWLength(perm->remBits + 1, kVal) so that the dummy 2^remBits is encodable.
 PEPSIDB constructPEPSIDBPSI (
     HE &bfv,
     std::vector<int64_t> dataVec,
     uint32_t numCtxt,
     uint32_t kVal,   
-    bool isEncrypted
+    bool isEncrypted,
+    const PermHashParams *perm = nullptr
+);
+
+// A loaded DB is shared read-only by every query thread; the handle keeps
+// it alive while a query runs
+typedef std::shared_ptr<const PEPSIDB> PEPSIDBHandle;
+
+PEPSIDBHandle shareDB(PEPSIDB &&DB);
+
+// Reads the query and the DB without copying them
+ResponsePEPSIServer compPEPSIInter(
+    HE &bfv,
+    const PEPSIQuery &query,
+    const PEPSIDB &DB
 );
 
 ResponsePEPSIServer compPEPSIInter(
     HE &bfv,
-    PEPSIQuery query,
-    PEPSIDB DB
+    const PEPSIQuery &query,
+    const PEPSIDBHandle &DB
 );
 
 
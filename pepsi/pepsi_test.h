@@ -22,5 +22,11 @@ void testPEPSIProtocolPSI(
   bool isEncrypted
 );
 
+void testPEPSIProtocolPSIPerm(
+  uint32_t numItem,
+  uint32_t bitlen,
+  uint32_t HW,
+  bool isEncrypted
+);
 
 #endif
\ No newline at end of file
@@ -75,43 +75,41 @@ PEPSIDB constructPEPSIDBPSI (
     std::vector<int64_t> dataVec,
     uint32_t numCtxt,
     uint32_t kVal,   
-    bool isEncrypted
+    bool isEncrypted,
+    const PermHashParams *perm
 ) {
     // uint32_t numData = dataVec.size();
     // std::vector<std::vector<int64_t>> cwVec(numData);
 
     // std::vector<std::vector<uint64_t>> table = chooseTable(numCtxt);
 
-    uint32_t maxBins = getMaxBins(4096, (int)std::log2(dataVec.size()));
+    uint32_t maxBins = computeMaxBinLoad(4096, dataVec.size(), 3);
     uint32_t dimElem = bfv.ringDim / 4096;
 
-    std::vector<std::vector<int64_t>> hashTable = computeCuckooHashTableServerPEPSI(
-        dataVec, bfv.ringDim, maxBins, dimElem, 42, 3
-    );
+    // Remainders span [0, 2^remBits), so empty slots of the permutation path
+    // take the first value past them; the codewords must cover it
+    int64_t dummyVal = (perm == nullptr) ? 42 : ((int64_t)1 << perm->remBits);
+    if (perm != nullptr && numCtxt < minCWLength(perm->remBits + 1, kVal)) {
+        throw std::runtime_error("Codeword too short for the permutation remainders and the dummy");
+    }
+
+    SimpleHashTable hashTable = (perm == nullptr)
+        ? computeCuckooHashTableServerPEPSI(dataVec, bfv.ringDim, maxBins, dimElem, dummyVal, 3)
+        : computeCuckooHashTableServerPEPSIPerm(dataVec, maxBins, dummyVal, *perm);
 
     // Reshape Table First
+    // Slot (b + 4096 * t) of block i holds the (i * dimElem + t)-th item in bin b,
+    // matching the replicated layout of the client query.
     uint32_t numTotalBlocks = (maxBins / dimElem) + (maxBins % dimElem != 0);
 
     std::vector<std::vector<int64_t>> reHashTable(numTotalBlocks);
-    for (auto &val : reHashTable) {
-        val.resize(bfv.ringDim, 42);
-    }
-
 
     #pragma omp parallel for 
     for (uint32_t i = 0; i < numTotalBlocks; i++) {
-        uint32_t offset = i * dimElem;
-        for (uint32_t j = 0; j < bfv.ringDim; j++) {
-            uint32_t rowIdx = j % 4096;
-            uint32_t colIdx = j / 4096;
-            if (offset + colIdx < maxBins) {
-                reHashTable[i][j] = hashTable[offset + colIdx][rowIdx];
-            }
-        }
+        reHashTable[i].resize(bfv.ringDim);
+        hashTable.readSlots(0, i * dimElem, reHashTable[i].data(), bfv.ringDim);
     }
 
-
-
     // MAke DB Chunks
     std::vector<PEPSIChunk> chunks(numTotalBlocks);   
     std::vector<PEPSIPtxtChunk> ptchunks(numTotalBlocks);   
@@ -123,7 +121,7 @@ PEPSIDB constructPEPSIDBPSI (
         std::vector<std::vector<int64_t>> msgVecs(numCtxt);
 
         for (auto &val : msgVecs) {
-            val.resize(bfv.ringDim, 42);
+            val.resize(bfv.ringDim, dummyVal);
         }
 
         // #pragma omp parallel for shared(table)
@@ -135,8 +133,6 @@ PEPSIDB constructPEPSIDBPSI (
             }
         }
 
-        std::cout << "YAY" << std::endl;
-
         // Make Ciphertexts
         std::vector<Ciphertext<DCRTPoly>> payload(numCtxt);
         std::vector<Plaintext> ptpayload(numCtxt);
@@ -173,20 +169,25 @@ PEPSIDB constructPEPSIDBPSI (
 
 
 
+PEPSIDBHandle shareDB(PEPSIDB &&DB) {
+    return std::make_shared<const PEPSIDB>(std::move(DB));
+}
+
 ResponsePEPSIServer compPEPSIInter(
     HE &bfv,
-    PEPSIQuery query,
-    PEPSIDB DB
+    const PEPSIQuery &query,
+    const PEPSIDB &DB
 ) {     
     uint32_t numChunks = DB.numChunks;
     std::vector<Ciphertext<DCRTPoly>> retVec(numChunks);
+    std::vector<Plaintext> ptConsts = makeEQConsts(bfv, DB.kVal);
 
     if (DB.isEncrypted) {
         #pragma omp parallel for
         for (uint32_t i = 0; i < numChunks; i++) {
             retVec[i] = arithCWEQ(
                 bfv, query.payload, DB.chunks[i].payload, 
-                DB.ptDiv, DB.kVal
+                DB.ptDiv, ptConsts
             );
         }
     } else {
@@ -194,7 +195,7 @@ ResponsePEPSIServer compPEPSIInter(
         for (uint32_t i = 0; i < numChunks; i++) {
             retVec[i] = arithCWEQPtxt(
                 bfv, query.payload, DB.ptxtChunks[i].payload, 
-                DB.ptDiv, DB.kVal
+                DB.ptDiv, ptConsts
             );
         }
     }
@@ -211,4 +212,13 @@ ResponsePEPSIServer compPEPSIInter(
 
     // Done!
     return ResponsePEPSIServer { ret, maskVal };
-}
\ No newline at end of file
+}
+
+ResponsePEPSIServer compPEPSIInter(
+    HE &bfv,
+    const PEPSIQuery &query,
+    const PEPSIDBHandle &DB
+) {
+    PEPSIDBHandle hold = DB;
+    return compPEPSIInter(bfv, query, *hold);
+}
@@ -113,4 +113,53 @@ void testPEPSIProtocolPSI(
     auto ret = checkIntResult(bfv, interResCtxt.isInter);
     std::cout << "Inter Result: " << ret << std::endl;
     std::cout << "OpenFHE Query Size: " << (double)(querySize) / 1000000 << "MB" << std::endl;
-}
\ No newline at end of file
+}
+
+// PSI with and without permutation-based hashing.
+// Bins absorb log2(4096) bits of each item, so a shorter codeword suffices.
+void testPEPSIProtocolPSIPerm(
+  uint32_t numItem,
+  uint32_t bitlen,
+  uint32_t HW,
+  bool isEncrypted
+) {
+    std::cout << "TEST START!" << std::endl;
+
+    // Items are encoded in a single word; genDataPEPSI draws 24-bit items
+    uint32_t itemBits = 24;
+    PermHashParams perm = makePermHashParams(4096, itemBits, 63, 3);
+    // One more bit for the dummy of empty bins, 2^remBits
+    uint32_t permBitlen = minCWLength(perm.remBits + 1, HW);
+
+    std::cout << "Item Bits: " << itemBits << " -> Stored Bits: " << perm.remBits << std::endl;
+    std::cout << "Bitlen: " << bitlen << " -> " << permBitlen << std::endl;
+
+    HE bfv("BFV", 65537, (int)(std::log2(HW))+isEncrypted);
+    std::vector<int64_t> msgVec = genDataPEPSI(1<<numItem);
+    std::vector<int64_t> queryVec = genDataPEPSI(2048);
+
+    std::vector<std::pair<std::string, const PermHashParams *>> modes = {
+        {"Full Items", nullptr},
+        {"Permutation", &perm}
+    };
+
+    for (auto &mode : modes) {
+        uint32_t currBitlen = (mode.second == nullptr) ? bitlen : permBitlen;
+
+        PEPSIDB serverDB = constructPEPSIDBPSI(
+          bfv, msgVec, currBitlen, HW, isEncrypted, mode.second
+        );
+        PEPSIQuery query = encryptClientDataPSI(bfv, queryVec, currBitlen, HW, mode.second);
+        size_t querySize = ctxtSize(query.payload[0]) * query.numCtxt;
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+        ResponsePEPSIServer interResCtxt = compPEPSIInter(bfv, query, serverDB);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        double timeSec = std::chrono::duration<double>(t2 - t1).count();
+
+        std::cout << "[" << mode.first << "]"
+                  << " Bitlen: " << currBitlen
+                  << " | Query Size: " << (double)(querySize) / 1000000 << "MB"
+                  << " | Intersection Time: " << timeSec << "s" << std::endl;
+    }
+}
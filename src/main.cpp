@@ -129,6 +129,7 @@ int main(int argc, char* argv[]) {
 
     // Main Function for Measuring Aggregation Time
     // testAggCheck(1024);
+    // testStreamingAgg(1024);
 
     // Main Protocol for the Single Server
     testFullProtocol(numItem, lenData, numPack, numAgg, alpha, interType, allowIntersection);
@@ -5,6 +5,8 @@
 #include "HE.h"
 #include "core.h"
 #include "params.h"
+#include "../core/aggregator.h"
+#include "../core/wire.h"
 
 
 using namespace lbcrypto;
@@ -635,27 +637,43 @@ ResponseServer compProbInterDBHybrid (
 }
 
 
+void encodeResponse(std::string &buf, const ResponseServer &response) {
+    encodeCtxt(buf, response.isInter);
+    encodeCtxt(buf, response.maskVal);
+}
+
+ResponseServer decodeResponse(HE &bfv, const std::string &buf, size_t &pos) {
+    Ciphertext<DCRTPoly> isInter = decodeCtxt(bfv.getCryptoContext(), buf, pos);
+    Ciphertext<DCRTPoly> maskVal = decodeCtxt(bfv.getCryptoContext(), buf, pos);
+    return ResponseServer {isInter, maskVal};
+}
+
 // Operation by the leader sender
 Ciphertext<DCRTPoly> compAggResponses(
     HE &bfv,
-    std::vector<ResponseServer> responses
+    const std::vector<ResponseServer> &responses
 ) {
     uint32_t numServers = responses.size();
+    StreamingAggregator agg(bfv.getCryptoContext(), numServers);
 
-    std::vector<Ciphertext<DCRTPoly>> isInters(numServers);
-    std::vector<Ciphertext<DCRTPoly>> maskVals(numServers);
-
-    // Read Responeses 
+    // Fold each response into the running sums; the last one triggers
+    // the final multiplication
     #pragma omp parallel for
     for (uint32_t i = 0; i < numServers; i++) {
-        isInters[i] = responses[i].isInter;
-        maskVals[i] = responses[i].maskVal;
+        agg.add(responses[i].isInter, responses[i].maskVal);
     }
+    return agg.finalize();
+}
 
-    // Additive Aggregation
-    Ciphertext<DCRTPoly> isInter = bfv.addmany(isInters);
-    Ciphertext<DCRTPoly> maskVal = bfv.addmany(maskVals);
-
-    // Final Multiplication
-    return bfv.mult(isInter, maskVal);
+Ciphertext<DCRTPoly> compAggResponses(
+    HE &bfv,
+    const std::vector<ResponseServer> &responses,
+    const AggTreePlan &plan
+) {
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> leaves(responses.size());
+    for (uint32_t i = 0; i < responses.size(); i++) {
+        leaves[i] = {responses[i].isInter, responses[i].maskVal};
+    }
+    std::vector<Ciphertext<DCRTPoly>> sums = runAggTree(bfv.getCryptoContext(), plan, AggOp::SUM, leaves);
+    return bfv.mult(sums[0], sums[1]);
 }
\ No newline at end of file
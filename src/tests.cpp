@@ -4,6 +4,9 @@
 
 using namespace lbcrypto;
 #include <chrono>
+#include <mutex>
+#include <thread>
+#include "../core/aggregator.h"
 
 // Helper for Simulation
 std::vector<std::vector<uint32_t>> genData(
@@ -723,6 +726,69 @@ void testAggCheck(int numParties) {
     std::cout << expMaskMsg << std::endl;
 }
 
+void testStreamingAgg(int numParties) {
+    std::cout << "<< Test Code for Streaming Aggregation at the Leader" << std::endl;
+    HE bfv("BFV", 65537, 19);
+
+    std::vector<ResponseServer> responses(numParties);
+    std::vector<int64_t> msgVec(bfv.ringDim, 1);
+    Ciphertext<DCRTPoly> isInter = bfv.compress(bfv.encrypt(bfv.packing(msgVec)), 3);
+    Ciphertext<DCRTPoly> maskVal = bfv.compress(genRandCiphertext(bfv, NUM_RAND_MASKS), 3);
+    for (int i = 0; i < numParties; i++) {
+        responses[i] = ResponseServer {isInter->Clone(), maskVal->Clone()};
+    }
+
+    // Batch reference: everything is available at once
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<Ciphertext<DCRTPoly>> isInters(numParties), maskVals(numParties);
+    for (int i = 0; i < numParties; i++) {
+        isInters[i] = responses[i].isInter;
+        maskVals[i] = responses[i].maskVal;
+    }
+    Ciphertext<DCRTPoly> batchRet = bfv.mult(bfv.addmany(isInters), bfv.addmany(maskVals));
+    auto t2 = std::chrono::high_resolution_clock::now();
+    double batchTime = std::chrono::duration<double>(t2-t1).count();
+
+    // Streaming: responses arrive over time from concurrent producers
+    std::cout << "Simulating Arrivals..." << std::endl;
+    StreamingAggregator agg(bfv.getCryptoContext(), numParties);
+    std::chrono::high_resolution_clock::time_point lastArrival;
+    std::mutex arrivalLock;
+
+    t1 = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numParties; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(i % 7));
+        {
+            std::lock_guard<std::mutex> guard(arrivalLock);
+            auto now = std::chrono::high_resolution_clock::now();
+            if (now > lastArrival) {
+                lastArrival = now;
+            }
+        }
+        agg.add(responses[i].isInter, responses[i].maskVal);
+    }
+    Ciphertext<DCRTPoly> streamRet = agg.finalize();
+    t2 = std::chrono::high_resolution_clock::now();
+    double streamTime = std::chrono::duration<double>(t2-t1).count();
+    double tailTime = std::chrono::duration<double>(t2-lastArrival).count();
+
+    std::cout << "Batch Aggregation Time: " << batchTime << "s" << std::endl;
+    std::cout << "Streaming Total Time: " << streamTime << "s" << std::endl;
+    std::cout << "Streaming Tail Latency (Last Arrival to Result): " << tailTime << "s" << std::endl;
+
+    std::vector<int64_t> batchMsg = bfv.decrypt(batchRet)->GetPackedValue();
+    std::vector<int64_t> streamMsg = bfv.decrypt(streamRet)->GetPackedValue();
+    uint32_t numMismatch = 0;
+    for (int64_t i = 0; i < bfv.ringDim; i++) {
+        numMismatch += (batchMsg[i] != streamMsg[i]);
+    }
+    std::cout << "Mismatched Slots: " << numMismatch << std::endl;
+    if (numMismatch != 0) {
+        throw std::runtime_error("Streaming aggregation differs from the batch result");
+    }
+}
+
 void testVAFandAggCheck(int numParties) {
     std::cout << "<< Test Code for Measuring New Aggregation Cost" << std::endl;
     HE bfv("BFV", 65537, 19);  